@@ -3,6 +3,9 @@
 #include "IBPlatform.h"
 #include "IBLogging.h"
 
+#include <stdio.h>
+#include <string.h>
+
 /*
 ## Virtual Memory And Paging
 Let's talk about virtual memory and paging
@@ -172,12 +175,55 @@ and larger blocks together.
 Finally, for large memory allocations, we use memory mapping. This simply allocates a large chunk
 of memory pages for a large allocation and is largely handled by the operating system.
 
+Mapping and unmapping memory is expensive. Every new mapping has to be page faulted in again
+and every unmap has to flush our TLB entries. As a result, freed mappings are kept in a small cache
+and handed back to allocations of the same power of 2 size class.
+The cache is bounded by the budget and block count in our AllocatorPolicy, the oldest blocks are unmapped first.
+
+Mappings larger than AllocatorPolicy::LargePageThreshold will try to use large pages (2MB on x64).
+Large pages need far fewer TLB entries for the same amount of memory but they are always committed
+and require the "Lock pages in memory" privilege. If they aren't available, we silently use regular pages.
+
+### Retaining memory
+Committing and decommitting memory pages are syscalls and a freshly committed page
+has to be zero filled by the operating system the first time it's touched.
+If we decommitted a page as soon as it was empty, a workload allocating and freeing around
+a page boundary every frame would pay for both every time.
+
+Instead, we keep track of which pages are committed and only commit pages that aren't.
+- The slab allocator has 2 more bitmaps in its header, one for committed pages and one for empty committed pages.
+- The buddy allocator keeps a bitmap of committed pages for every buddy chunk.
+
+When memory is freed, we keep it committed as long as we're within the budgets of our AllocatorPolicy.
+(RetainedSlabPageCount empty pages per size class and RetainedBuddyMemory per buddy chunk)
+Empty slab pages past our budget are decommitted immediately.
+Every buddy chunk keeps a running count of the pages its free blocks keep committed, our frees never have to walk our free list.
+Past our budget, our least recently freed buddy blocks are decommitted first, or left to our trim thread if it's running.
+
+Our background trim thread, if TrimIntervalMilliseconds is set, only trims what's past our budgets.
+Our budgeted memory is only returned to the operating system when we call trimMemory explicitly.
+
+### Reallocation
+memoryReallocate tries very hard to avoid copying our memory.
+
+- A slab slot can't grow, but if our new size still fits in our slot, we simply keep it.
+- A buddy block can grow in place if it is the left buddy and its right buddy is free.
+  We absorb our buddy and become our parent block, repeating until we're large enough.
+  [16,0][16,1] -> [32,0]
+  Shrinking splits our block and returns the right halves to the free list.
+- A memory mapping can grow in place if we reserved address space past its end.
+  Blocks that grow into the large range reserve twice their size to leave room for the next growth.
+
+If none of these work, we fall back to allocate, copy and free.
+
 */
 
 namespace
 {
     void *const MemoryLock = reinterpret_cast<void *>(0x01);
 
+    IB::AllocatorPolicy Policy;
+
     // Small Memory Allocations
 
     constexpr size_t SmallMemoryBoundary = 512;
@@ -193,11 +239,43 @@ namespace
         alignas(64) uint32_t LockedPages[LockPageCount] = {};
         void *Header = nullptr;
         void *MemoryPages = nullptr;
+        uint32_t RetainedPageCount = 0; // Empty pages that we've kept committed
     };
 
+    // Our header is made of a bitmap per header page with a bit for every memory page.
+    constexpr uint32_t FullPagesBitmap = 0;
+    constexpr uint32_t CommittedPagesBitmap = 1;
+    constexpr uint32_t EmptyPagesBitmap = 2; // Committed pages with all their slots cleared.
+    constexpr uint32_t HeaderPageCount = 3;
+
+    uint64_t *getHeaderBitmap(PageTable const &table, uint32_t bitmap)
+    {
+        uintptr_t header = reinterpret_cast<uintptr_t>(table.Header);
+        return reinterpret_cast<uint64_t *>(header + IB::memoryPageSize() * bitmap);
+    }
+
     PageTable SmallMemoryPageTables[SmallMemoryBoundary] = {};
     const size_t SmallMemoryRange = IB::memoryPageSize() * 8 * IB::memoryPageSize();
 
+    size_t alignedBlockSize(size_t size, size_t alignment)
+    {
+        size_t blockSize = size;
+        if (size != alignment && size % alignment != 0)
+        {
+            if (size > alignment)
+            {
+                blockSize = ((size / alignment) + 1) * alignment;
+            }
+            else
+            {
+                blockSize = alignment;
+            }
+        }
+        // By this point, if blockSize is larger than size, then we have internal fragmentation.
+        // TODO: Log internal fragmentation
+        return blockSize;
+    }
+
     bool areAllSlotsSet(void *memory, uint64_t bitCount)
     {
         bool fullyAllocated = true;
@@ -290,16 +368,45 @@ namespace
         *memoryIter &= ~(1ull << (index % 64));
     }
 
+    uint64_t pageBitmapSize(uint64_t blockCount)
+    {
+        return blockCount / 8 + (blockCount % 8 > 0 ? 1 : 0);
+    }
+
+    // Our first slot is aligned to our block size, returns the furthest our first slot can be from the start of our page.
+    uint64_t maxFirstSlotOffset(size_t blockSize, uint64_t blockCount)
+    {
+        uint64_t bitmapSize = pageBitmapSize(blockCount);
+        // Our pages are page aligned, power of 2 block sizes always get the same padding.
+        // Other block sizes depend on our page's address, assume our worst padding.
+        if ((blockSize & (blockSize - 1)) == 0)
+        {
+            return (bitmapSize + blockSize - 1) / blockSize * blockSize;
+        }
+        return bitmapSize + blockSize - 1;
+    }
+
+    uint64_t pageBlockCount(size_t blockSize)
+    {
+        uint64_t blockCount = (IB::memoryPageSize() * 8) / (1 + blockSize * 8);
+        // Our alignment padding can push our last blocks past the end of our page.
+        while (maxFirstSlotOffset(blockSize, blockCount) + blockCount * blockSize > IB::memoryPageSize())
+        {
+            blockCount--;
+        }
+        return blockCount;
+    }
+
     void *getPageSlot(void *page, size_t blockSize, uint64_t blockCount, uint64_t slotIndex)
     {
         uintptr_t pageIter = reinterpret_cast<uintptr_t>(page);
-        pageIter += blockCount / 8 + (blockCount % 8 > 0 ? 1 : 0);
+        pageIter += pageBitmapSize(blockCount);
 
         // Make sure we're aligned
         uintptr_t firstSlot = pageIter + ((pageIter % blockSize) > 0 ? (blockSize - pageIter % blockSize) : 0);
         pageIter = firstSlot + slotIndex * blockSize;
 
-        IB_ASSERT(pageIter < reinterpret_cast<uintptr_t>(page) + IB::memoryPageSize(), "Our address is further than our allocated memory! How come?");
+        IB_ASSERT(pageIter + blockSize <= reinterpret_cast<uintptr_t>(page) + IB::memoryPageSize(), "Our address is further than our allocated memory! How come?");
         return reinterpret_cast<void *>(pageIter);
     }
 
@@ -313,8 +420,8 @@ namespace
             // Other threads should know to wait until the value is truly set now.
             if (IB::atomicCompareExchange(&SmallMemoryPageTables[tableIndex].MemoryPages, nullptr, MemoryLock) == nullptr)
             {
-                SmallMemoryPageTables[tableIndex].Header = IB::reserveMemoryPages(1);
-                IB::commitMemoryPages(SmallMemoryPageTables[tableIndex].Header, 1);
+                SmallMemoryPageTables[tableIndex].Header = IB::reserveMemoryPages(HeaderPageCount);
+                IB::commitMemoryPages(SmallMemoryPageTables[tableIndex].Header, HeaderPageCount);
 
                 void *memoryPages = IB::reserveMemoryPages(IB::memoryPageSize() * 8);
                 // Assure our writes are globally visible before we allow access to our memory pages.
@@ -340,7 +447,11 @@ namespace
 
             uint64_t pageCount = (IB::memoryPageSize() * 8);
             uint64_t pageIndex = findClearedSlot(offsetHeader + slotOffset / 64, pageCount - slotOffset) + slotOffset;
-            IB_ASSERT(pageIndex != NoSlot || slotOffset != 0, "Failed to find a slot. We're out of memory."); // We're out of memory pages for this size class! Improve this algorithm to support the use case.
+            if (pageIndex == NoSlot && slotOffset == 0)
+            {
+                // We're out of memory pages for this size class! Let our caller decide how to handle it.
+                return nullptr;
+            }
 
             lockIndex = pageIndex % LockPageCount;
             if (IB::atomicCompareExchange(&SmallMemoryPageTables[tableIndex].LockedPages[lockIndex], 0, 1) == 0)
@@ -363,13 +474,27 @@ namespace
             uintptr_t pageAddress = reinterpret_cast<uintptr_t>(SmallMemoryPageTables[tableIndex].MemoryPages);
             pageAddress = pageAddress + IB::memoryPageSize() * lockedPageIndex;
             page = reinterpret_cast<void *>(pageAddress);
-            IB::commitMemoryPages(page, 1);
+
+            // Only commit our page if we haven't kept it around, we want to avoid a syscall on every allocation.
+            uint64_t pageBit = 1ull << (lockedPageIndex % 64);
+            uint64_t *committedPages = getHeaderBitmap(SmallMemoryPageTables[tableIndex], CommittedPagesBitmap) + lockedPageIndex / 64;
+            uint64_t *emptyPages = getHeaderBitmap(SmallMemoryPageTables[tableIndex], EmptyPagesBitmap) + lockedPageIndex / 64;
+            if ((IB::volatileLoad(committedPages) & pageBit) == 0)
+            {
+                IB::commitMemoryPages(page, 1);
+                // Other pages share our 64 bits but not our lock, our bits have to be set atomically.
+                IB::atomicOr(committedPages, pageBit);
+            }
+            else if ((IB::atomicAnd(emptyPages, ~pageBit) & pageBit) != 0)
+            {
+                IB::atomicDecrement(&SmallMemoryPageTables[tableIndex].RetainedPageCount);
+            }
         }
 
         // Find our memory address
         void *memory;
         {
-            uint64_t blockCount = (IB::memoryPageSize() * 8) / (1 + blockSize * 8);
+            uint64_t blockCount = pageBlockCount(blockSize);
             uint64_t freeSlot = findClearedSlot(reinterpret_cast<uint64_t *>(page), blockCount);
             IB_ASSERT(freeSlot != NoSlot, "Failed to find a slot but our page said it had a free slot!"); // Our page's "fully allocated" bit was cleared, how come we have no space?
 
@@ -393,7 +518,8 @@ namespace
         return memory;
     }
 
-    bool freeSmallMemory(void *memory)
+    // Returns the size class index that owns our memory or UINT32_MAX if it isn't small memory.
+    uint32_t findSmallMemoryTable(void *memory)
     {
         uint32_t memoryPageIndex = UINT32_MAX;
         for (uint32_t i = 0; i < SmallMemoryBoundary; i++)
@@ -409,10 +535,17 @@ namespace
             }
         }
 
+        return memoryPageIndex;
+    }
+
+    bool freeSmallMemory(void *memory, size_t *freedSize)
+    {
+        uint32_t memoryPageIndex = findSmallMemoryTable(memory);
         if (memoryPageIndex != UINT32_MAX)
         {
             size_t blockSize = memoryPageIndex + 1;
-            uint64_t blockCount = (IB::memoryPageSize() * 8) / (1 + blockSize * 8);
+            *freedSize = blockSize;
+            uint64_t blockCount = pageBlockCount(blockSize);
 
             uintptr_t memoryAddress = reinterpret_cast<uintptr_t>(memory);
             uintptr_t pageStart = reinterpret_cast<uintptr_t>(SmallMemoryPageTables[memoryPageIndex].MemoryPages);
@@ -433,7 +566,19 @@ namespace
             clearSlot(page, indexInPage);
             if (areAllSlotsClear(page, blockCount))
             {
-                IB::decommitMemoryPages(page, 1);
+                // Keep a few empty pages committed, a workload oscillating around a page boundary
+                // would otherwise commit and decommit our page on every allocation.
+                uint64_t pageBit = 1ull << (pageIndex % 64);
+                if (IB::atomicIncrement(&SmallMemoryPageTables[memoryPageIndex].RetainedPageCount) <= Policy.RetainedSlabPageCount)
+                {
+                    IB::atomicOr(getHeaderBitmap(SmallMemoryPageTables[memoryPageIndex], EmptyPagesBitmap) + pageIndex / 64, pageBit);
+                }
+                else
+                {
+                    IB::atomicDecrement(&SmallMemoryPageTables[memoryPageIndex].RetainedPageCount);
+                    IB::decommitMemoryPages(page, 1);
+                    IB::atomicAnd(getHeaderBitmap(SmallMemoryPageTables[memoryPageIndex], CommittedPagesBitmap) + pageIndex / 64, ~pageBit);
+                }
             }
 
             clearSlot(SmallMemoryPageTables[memoryPageIndex].Header, pageIndex);
@@ -444,6 +589,56 @@ namespace
         return memoryPageIndex != UINT32_MAX;
     }
 
+    // Decommits the empty pages that we've kept around until every size class retains at most retainedPageCount of them.
+    void trimSmallMemory(uint32_t retainedPageCount)
+    {
+        uint64_t pageCount = IB::memoryPageSize() * 8;
+        for (uint32_t tableIndex = 0; tableIndex < SmallMemoryBoundary; tableIndex++)
+        {
+            PageTable &table = SmallMemoryPageTables[tableIndex];
+            void *memoryPages = IB::volatileLoad(&table.MemoryPages);
+            if (memoryPages == nullptr || memoryPages == MemoryLock)
+            {
+                continue;
+            }
+            IB::threadAcquire(); // Acquire our header
+
+            uint64_t *emptyPages = getHeaderBitmap(table, EmptyPagesBitmap);
+            uint64_t *committedPages = getHeaderBitmap(table, CommittedPagesBitmap);
+            for (uint64_t i = 0; i < pageCount / 64 && IB::volatileLoad(&table.RetainedPageCount) > retainedPageCount; i++)
+            {
+                uint64_t emptyBits = IB::volatileLoad(&emptyPages[i]);
+                while (emptyBits != 0 && IB::volatileLoad(&table.RetainedPageCount) > retainedPageCount)
+                {
+                    uint64_t bitIndex = firstClearedBitIndex(~emptyBits);
+                    uint64_t pageBit = 1ull << bitIndex;
+                    emptyBits &= ~pageBit;
+
+                    uint64_t pageIndex = i * 64 + bitIndex;
+                    uint32_t lockIndex = pageIndex % LockPageCount;
+                    while (IB::atomicCompareExchange(&table.LockedPages[lockIndex], 0, 1) != 0)
+                    {
+                        // Busy loop until we get our lock
+                    }
+                    IB::threadAcquire();
+
+                    // An allocation might have claimed our page before we got our lock.
+                    if ((IB::atomicAnd(&emptyPages[i], ~pageBit) & pageBit) != 0)
+                    {
+                        IB::atomicDecrement(&table.RetainedPageCount);
+
+                        uintptr_t pageAddress = reinterpret_cast<uintptr_t>(memoryPages) + IB::memoryPageSize() * pageIndex;
+                        IB::decommitMemoryPages(reinterpret_cast<void *>(pageAddress), 1);
+                        IB::atomicAnd(&committedPages[i], ~pageBit);
+                    }
+
+                    IB::threadRelease();
+                    table.LockedPages[lockIndex] = 0;
+                }
+            }
+        }
+    }
+
     // Medium Memory Allocations
 
     uint8_t logBase2(size_t value)
@@ -462,6 +657,7 @@ namespace
     constexpr size_t SmallestBuddyBlockSize = SmallMemoryBoundary * 2;
     constexpr size_t BuddyChunkSize = MaxBuddyBlockCount * SmallestBuddyBlockSize;
     constexpr size_t MediumMemoryBoundary = MaxBuddyBlockCount * SmallestBuddyBlockSize / 2; // We don't want to be able to allocate a whole buddy chunk.
+    constexpr size_t MaxBuddyChunkPageCount = BuddyChunkSize / 4096; // Assumes pages of at least 4kb
     constexpr uint32_t BuddyChunkCount = 1024;                                               // arbitrary. Is roughly 4GB with MaxBuddyBlockCount of 4096 and SmallestBuddyChunkSize of 1024
 
     struct BuddyBlock
@@ -474,9 +670,14 @@ namespace
     {
         void *MemoryPages = nullptr;
         BuddyBlock AllocatedBlocks[MaxBuddyBlockCount];
+        uint32_t AllocatedSizes[MaxBuddyBlockCount]; // Requested size of each allocated block, only these bytes are committed.
         BuddyBlock FreeBlocks[MaxBuddyBlockCount];
+        uint32_t FreeOrders[MaxBuddyBlockCount]; // When each free block was freed, our oldest retained blocks are decommitted first.
+        uint64_t CommittedPages[MaxBuddyChunkPageCount / 64];
         uint32_t AllocatedBlockCount = 0;
         uint32_t FreeBlockCount = 0;
+        uint32_t NextFreeOrder = 0;
+        uint32_t RetainedPageCount = 0; // Committed pages held by our free blocks, kept up to date as our free list changes.
         uint32_t Locked = 0;
     };
     BuddyChunk *BuddyChunks = nullptr;
@@ -497,12 +698,88 @@ namespace
         return layer;
     }
 
+    // Returns the range of pages covered by our memory.
+    void getBuddyPageRange(BuddyChunk const *chunk, uintptr_t memoryAddress, size_t size, uint32_t *firstPage, uint32_t *pageCount)
+    {
+        uintptr_t offsetFromStart = memoryAddress - reinterpret_cast<uintptr_t>(chunk->MemoryPages);
+        *firstPage = static_cast<uint32_t>(offsetFromStart / IB::memoryPageSize());
+        *pageCount = static_cast<uint32_t>((offsetFromStart + size - 1) / IB::memoryPageSize()) - *firstPage + 1;
+    }
+
+    uint32_t countCommittedBuddyPages(BuddyChunk const *chunk, uint32_t firstPage, uint32_t pageCount)
+    {
+        // Count a word of our bitmap at a time.
+        uint32_t committedPageCount = 0;
+        uint32_t endPage = firstPage + pageCount;
+        for (uint32_t page = firstPage; page < endPage;)
+        {
+            uint32_t bitIndex = page % 64;
+            uint32_t bitCount = 64 - bitIndex < endPage - page ? 64 - bitIndex : endPage - page;
+            uint64_t mask = bitCount == 64 ? UINT64_MAX : ((1ull << bitCount) - 1) << bitIndex;
+            committedPageCount += IB::popCount(chunk->CommittedPages[page / 64] & mask);
+            page += bitCount;
+        }
+        return committedPageCount;
+    }
+
+    // Blocks smaller than a page share their page with their neighbours, only larger blocks retain their pages.
+    uint32_t retainedBuddyPageCount(BuddyChunk const *chunk, BuddyBlock block)
+    {
+        if (block.Layer < getLayerFromSize(IB::memoryPageSize()))
+        {
+            return 0;
+        }
+
+        size_t blockSize = getSizeFromLayer(block.Layer);
+        uint32_t firstPage = static_cast<uint32_t>(blockSize * block.Index / IB::memoryPageSize());
+        return countCommittedBuddyPages(chunk, firstPage, static_cast<uint32_t>(blockSize / IB::memoryPageSize()));
+    }
+
+    // Expects the chunk to be locked.
+    void addFreeBuddyBlock(BuddyChunk *chunk, BuddyBlock block)
+    {
+        chunk->FreeBlocks[chunk->FreeBlockCount] = block;
+        chunk->FreeOrders[chunk->FreeBlockCount] = chunk->NextFreeOrder++;
+        chunk->FreeBlockCount++;
+        chunk->RetainedPageCount += retainedBuddyPageCount(chunk, block);
+    }
+
+    // Expects the chunk to be locked.
+    // Swaps our last free block into our index.
+    void removeFreeBuddyBlock(BuddyChunk *chunk, uint32_t freeIndex)
+    {
+        chunk->RetainedPageCount -= retainedBuddyPageCount(chunk, chunk->FreeBlocks[freeIndex]);
+        chunk->FreeBlocks[freeIndex] = chunk->FreeBlocks[chunk->FreeBlockCount - 1];
+        chunk->FreeOrders[freeIndex] = chunk->FreeOrders[chunk->FreeBlockCount - 1];
+        chunk->FreeBlockCount--;
+    }
+
+    // Expects the chunk to be locked.
+    void commitBuddyPages(BuddyChunk *chunk, uintptr_t memoryAddress, size_t size)
+    {
+        uint32_t firstPage;
+        uint32_t pageCount;
+        getBuddyPageRange(chunk, memoryAddress, size, &firstPage, &pageCount);
+
+        // Our pages are likely still committed from a previous allocation, skip our syscall if they are.
+        if (countCommittedBuddyPages(chunk, firstPage, pageCount) != pageCount)
+        {
+            uintptr_t pageAddress = reinterpret_cast<uintptr_t>(chunk->MemoryPages) + firstPage * IB::memoryPageSize();
+            IB::commitMemoryPages(reinterpret_cast<void *>(pageAddress), pageCount);
+            for (uint32_t i = firstPage; i < firstPage + pageCount; i++)
+            {
+                setSlot(chunk->CommittedPages, i);
+            }
+        }
+    }
+
     void *allocateMediumMemory(size_t blockSize)
     {
         if (BuddyChunks == nullptr)
         {
             if (IB::atomicCompareExchange(reinterpret_cast<void **>(&BuddyChunks), nullptr, MemoryLock) == nullptr)
             {
+                IB_ASSERT(BuddyChunkSize / IB::memoryPageSize() <= MaxBuddyChunkPageCount, "Our pages are too small for our committed page bitmap!");
                 uint32_t memoryPageCount = static_cast<uint32_t>(sizeof(BuddyChunk) * BuddyChunkCount / IB::memoryPageSize());
                 BuddyChunk *buddyChunks = reinterpret_cast<BuddyChunk *>(IB::reserveMemoryPages(memoryPageCount));
                 IB::commitMemoryPages(buddyChunks, memoryPageCount);
@@ -550,10 +827,8 @@ namespace
                 initialBlock.Index = 0;
                 initialBlock.Layer = getLayerFromSize(BuddyChunkSize);
 
-                BuddyChunks[buddyChunkIndex].FreeBlocks[0] = initialBlock;
-                BuddyChunks[buddyChunkIndex].FreeBlockCount = 1;
-
                 BuddyChunks[buddyChunkIndex].MemoryPages = IB::reserveMemoryPages(static_cast<uint32_t>(BuddyChunkSize / IB::memoryPageSize()));
+                addFreeBuddyBlock(&BuddyChunks[buddyChunkIndex], initialBlock);
             }
 
             uint8_t requestedLayer = getLayerFromSize(blockSize);
@@ -581,39 +856,34 @@ namespace
                 while (currentBlock.Layer > requestedLayer)
                 {
                     // Remove our block
-                    freeBlocks[currentBlockIndex] = freeBlocks[BuddyChunks[buddyChunkIndex].FreeBlockCount - 1];
-                    BuddyChunks[buddyChunkIndex].FreeBlockCount--;
+                    removeFreeBuddyBlock(&BuddyChunks[buddyChunkIndex], currentBlockIndex);
 
                     BuddyBlock nextBlock = BuddyBlock{};
                     nextBlock.Layer = currentBlock.Layer - 1;
                     nextBlock.Index = currentBlock.Index * 2;
-                    freeBlocks[BuddyChunks[buddyChunkIndex].FreeBlockCount] = nextBlock;
+                    addFreeBuddyBlock(&BuddyChunks[buddyChunkIndex], nextBlock);
 
                     nextBlock.Index = currentBlock.Index * 2 + 1;
-                    freeBlocks[BuddyChunks[buddyChunkIndex].FreeBlockCount + 1] = nextBlock;
+                    addFreeBuddyBlock(&BuddyChunks[buddyChunkIndex], nextBlock);
 
-                    currentBlockIndex = BuddyChunks[buddyChunkIndex].FreeBlockCount;
-                    currentBlock = freeBlocks[BuddyChunks[buddyChunkIndex].FreeBlockCount];
-                    BuddyChunks[buddyChunkIndex].FreeBlockCount += 2;
+                    currentBlockIndex = BuddyChunks[buddyChunkIndex].FreeBlockCount - 2;
+                    currentBlock = freeBlocks[currentBlockIndex];
                 }
                 IB_ASSERT(currentBlock.Layer == requestedLayer, "How come we couldn't create our layer?");
 
                 // Remove our final block
-                freeBlocks[currentBlockIndex] = freeBlocks[BuddyChunks[buddyChunkIndex].FreeBlockCount - 1];
-                BuddyChunks[buddyChunkIndex].FreeBlockCount--;
+                removeFreeBuddyBlock(&BuddyChunks[buddyChunkIndex], currentBlockIndex);
 
                 BuddyChunks[buddyChunkIndex].AllocatedBlocks[BuddyChunks[buddyChunkIndex].AllocatedBlockCount] = currentBlock;
+                BuddyChunks[buddyChunkIndex].AllocatedSizes[BuddyChunks[buddyChunkIndex].AllocatedBlockCount] = static_cast<uint32_t>(blockSize);
                 BuddyChunks[buddyChunkIndex].AllocatedBlockCount++;
 
                 size_t layerSize = getSizeFromLayer(currentBlock.Layer);
                 ptrdiff_t memoryOffset = layerSize * currentBlock.Index;
                 uintptr_t memoryAddress = reinterpret_cast<uintptr_t>(BuddyChunks[buddyChunkIndex].MemoryPages) + memoryOffset;
 
-                uintptr_t alignedMemoryAddress = memoryAddress / IB::memoryPageSize() * IB::memoryPageSize();
                 // Use blockSize in our memory page count, we don't need to commit all of our unused buddy space.
-                uint32_t memoryPageCount = static_cast<uint32_t>(blockSize / IB::memoryPageSize()) + (blockSize % IB::memoryPageSize() != 0 ? 1 : 0);
-
-                IB::commitMemoryPages(reinterpret_cast<void *>(alignedMemoryAddress), memoryPageCount);
+                commitBuddyPages(&BuddyChunks[buddyChunkIndex], memoryAddress, blockSize);
 
                 IB::threadRelease();
                 IB::volatileStore<uint32_t>(&BuddyChunks[buddyChunkIndex].Locked, 0); // unlock our chunk
@@ -629,8 +899,14 @@ namespace
         return nullptr;
     }
 
-    bool freeMediumMemory(void *memory)
+    // Returns the buddy chunk that owns our memory or UINT32_MAX if it isn't medium memory.
+    uint32_t findBuddyChunk(void *memory)
     {
+        if (IB::volatileLoad(&BuddyChunks) == nullptr || IB::volatileLoad(&BuddyChunks) == MemoryLock)
+        {
+            return UINT32_MAX;
+        }
+
         uint32_t memoryPageIndex = UINT32_MAX;
         for (uint32_t i = 0; i < BuddyChunkCount; i++)
         {
@@ -645,54 +921,227 @@ namespace
             }
         }
 
-        if (memoryPageIndex != UINT32_MAX)
+        return memoryPageIndex;
+    }
+
+    // Expects the chunk to be locked.
+    uint32_t findAllocatedBuddyBlock(BuddyChunk *chunk, void *memory)
+    {
+        uintptr_t pageStart = reinterpret_cast<uintptr_t>(chunk->MemoryPages);
+        ptrdiff_t offsetFromStart = reinterpret_cast<uintptr_t>(memory) - pageStart;
+
+        uint32_t blockIndex = UINT32_MAX;
+        for (uint32_t i = 0; i < chunk->AllocatedBlockCount; i++)
         {
-            // Busy loop until we're unlocked, definitely can be improved.
-            while (IB::atomicCompareExchange(&BuddyChunks[memoryPageIndex].Locked, 0, 1) != 0)
+            BuddyBlock currentBlock = chunk->AllocatedBlocks[i];
+
+            size_t blockSize = getSizeFromLayer(currentBlock.Layer);
+            ptrdiff_t memoryOffset = blockSize * currentBlock.Index;
+
+            if (memoryOffset == offsetFromStart)
             {
+                blockIndex = i;
+                break;
             }
-            IB::threadAcquire();
+        }
 
-            uintptr_t pageStart = reinterpret_cast<uintptr_t>(BuddyChunks[memoryPageIndex].MemoryPages);
-            ptrdiff_t offsetFromStart = reinterpret_cast<uintptr_t>(memory) - pageStart;
+        IB_ASSERT(blockIndex != UINT32_MAX, "We're not in the memory block but our address matches?");
+        return blockIndex;
+    }
 
-            uint32_t blockIndex = UINT32_MAX;
-            for (uint32_t i = 0; i < BuddyChunks[memoryPageIndex].AllocatedBlockCount; i++)
+    // Expects the chunk to be locked.
+    void decommitBuddyBlock(BuddyChunk *chunk, BuddyBlock block)
+    {
+        // Blocks smaller than a page share their page with their neighbours, we can't decommit them.
+        if (block.Layer >= getLayerFromSize(IB::memoryPageSize()))
+        {
+            size_t blockSize = getSizeFromLayer(block.Layer);
+            ptrdiff_t memoryOffset = blockSize * block.Index;
+            uintptr_t memoryAddress = reinterpret_cast<uintptr_t>(chunk->MemoryPages) + memoryOffset;
+
+            uint32_t firstPage;
+            uint32_t pageCount;
+            getBuddyPageRange(chunk, memoryAddress, blockSize, &firstPage, &pageCount);
+            uint32_t committedPageCount = countCommittedBuddyPages(chunk, firstPage, pageCount);
+            if (committedPageCount > 0)
             {
-                BuddyBlock currentBlock = BuddyChunks[memoryPageIndex].AllocatedBlocks[i];
+                IB::decommitMemoryPages(reinterpret_cast<void *>(memoryAddress), pageCount);
+                for (uint32_t i = firstPage; i < firstPage + pageCount; i++)
+                {
+                    clearSlot(chunk->CommittedPages, i);
+                }
+                chunk->RetainedPageCount -= committedPageCount;
+            }
+        }
+    }
 
-                size_t blockSize = getSizeFromLayer(currentBlock.Layer);
-                ptrdiff_t memoryOffset = blockSize * currentBlock.Index;
+    // Expects the chunk to be locked.
+    // Decommits our least recently freed blocks until the memory our free blocks keep committed fits in our budget.
+    void trimRetainedBuddyBlocks(BuddyChunk *chunk, size_t budget)
+    {
+        uint8_t pageLayer = getLayerFromSize(IB::memoryPageSize());
 
-                if (memoryOffset == offsetFromStart)
+        // Our orders are unique, we only look at blocks freed after the one we've just decommitted.
+        uint64_t trimmedOrder = 0;
+        while (chunk->RetainedPageCount * IB::memoryPageSize() > budget)
+        {
+            uint32_t oldestIndex = UINT32_MAX;
+            for (uint32_t i = 0; i < chunk->FreeBlockCount; i++)
+            {
+                bool candidate = chunk->FreeBlocks[i].Layer >= pageLayer && chunk->FreeOrders[i] >= trimmedOrder;
+                if (candidate && (oldestIndex == UINT32_MAX || chunk->FreeOrders[i] < chunk->FreeOrders[oldestIndex]))
                 {
-                    blockIndex = i;
-                    break;
+                    oldestIndex = i;
                 }
             }
 
-            IB_ASSERT(blockIndex != UINT32_MAX, "We're not in the memory block but our address matches?");
-            if (blockIndex != UINT32_MAX)
+            if (oldestIndex == UINT32_MAX)
             {
-                BuddyBlock currentBlock = BuddyChunks[memoryPageIndex].AllocatedBlocks[blockIndex];
+                break;
+            }
 
-                BuddyChunks[memoryPageIndex].AllocatedBlocks[blockIndex] = BuddyChunks[memoryPageIndex].AllocatedBlocks[BuddyChunks[memoryPageIndex].AllocatedBlockCount - 1];
-                BuddyChunks[memoryPageIndex].AllocatedBlockCount--;
+            decommitBuddyBlock(chunk, chunk->FreeBlocks[oldestIndex]);
+            trimmedOrder = static_cast<uint64_t>(chunk->FreeOrders[oldestIndex]) + 1;
+        }
+    }
+
+    // Attempts to resize our block without moving it.
+    // Returns the size that was committed for our block in currentSize in case we need to copy it.
+    bool reallocateMediumMemory(uint32_t chunkIndex, void *memory, size_t blockSize, size_t alignment, size_t *currentSize)
+    {
+        BuddyChunk *chunk = &BuddyChunks[chunkIndex];
+        while (IB::atomicCompareExchange(&chunk->Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+
+        uint32_t blockIndex = findAllocatedBuddyBlock(chunk, memory);
+        *currentSize = chunk->AllocatedSizes[blockIndex];
+
+        bool resized = false;
+        bool fitsMediumMemory = blockSize > SmallMemoryBoundary && blockSize <= MediumMemoryBoundary;
+        if (fitsMediumMemory && reinterpret_cast<uintptr_t>(memory) % alignment == 0)
+        {
+            BuddyBlock block = chunk->AllocatedBlocks[blockIndex];
+            uint8_t requestedLayer = getLayerFromSize(blockSize);
+            if (requestedLayer <= block.Layer)
+            {
+                // Split our block until it's the right size, our right halves go back to the free list.
+                // Our halves stay committed like any other freed block, our budget decides what we keep.
+                while (block.Layer > requestedLayer)
+                {
+                    block.Layer--;
+                    block.Index = block.Index * 2;
+
+                    BuddyBlock rightBlock = BuddyBlock{};
+                    rightBlock.Layer = block.Layer;
+                    rightBlock.Index = block.Index + 1;
+                    addFreeBuddyBlock(chunk, rightBlock);
+                }
+
+                if (Policy.TrimIntervalMilliseconds == 0 && chunk->RetainedPageCount * IB::memoryPageSize() > Policy.RetainedBuddyMemory)
+                {
+                    trimRetainedBuddyBlocks(chunk, Policy.RetainedBuddyMemory);
+                }
+                resized = true;
+            }
+            else
+            {
+                // We can only grow in place if we're the left buddy at every layer
+                // and our right buddy is free at every layer.
+                constexpr uint32_t MaxLayerCount = 16;
+                uint32_t buddyFreeIndices[MaxLayerCount];
+                uint32_t buddyCount = 0;
+
+                BuddyBlock currentBlock = block;
+                while (currentBlock.Layer < requestedLayer)
+                {
+                    if ((currentBlock.Index & 1) != 0)
+                    {
+                        break;
+                    }
+
+                    uint32_t buddyFreeIndex = UINT32_MAX;
+                    for (uint32_t i = 0; i < chunk->FreeBlockCount; i++)
+                    {
+                        if (chunk->FreeBlocks[i].Layer == currentBlock.Layer && chunk->FreeBlocks[i].Index == currentBlock.Index + 1)
+                        {
+                            buddyFreeIndex = i;
+                            break;
+                        }
+                    }
+
+                    if (buddyFreeIndex == UINT32_MAX)
+                    {
+                        break;
+                    }
 
-                BuddyChunks[memoryPageIndex].FreeBlocks[BuddyChunks[memoryPageIndex].FreeBlockCount] = currentBlock;
-                BuddyChunks[memoryPageIndex].FreeBlockCount++;
+                    buddyFreeIndices[buddyCount++] = buddyFreeIndex;
+                    currentBlock.Index = currentBlock.Index / 2;
+                    currentBlock.Layer++;
+                }
 
-                if (currentBlock.Layer >= getLayerFromSize(IB::memoryPageSize()))
+                if (currentBlock.Layer == requestedLayer)
                 {
-                    size_t blockSize = getSizeFromLayer(currentBlock.Layer);
-                    ptrdiff_t memoryOffset = blockSize * currentBlock.Index;
-                    uintptr_t memoryAddress = reinterpret_cast<uintptr_t>(BuddyChunks[memoryPageIndex].MemoryPages) + memoryOffset;
+                    // Remove our buddies from the free list, highest index first to keep our indices valid while we swap.
+                    for (uint32_t i = 0; i < buddyCount; i++)
+                    {
+                        uint32_t highestIndex = i;
+                        for (uint32_t j = i + 1; j < buddyCount; j++)
+                        {
+                            if (buddyFreeIndices[j] > buddyFreeIndices[highestIndex])
+                            {
+                                highestIndex = j;
+                            }
+                        }
 
-                    uintptr_t alignedMemoryAddress = memoryAddress / IB::memoryPageSize() * IB::memoryPageSize();
-                    uint32_t memoryPageCount = static_cast<uint32_t>(blockSize / IB::memoryPageSize()) + (blockSize % IB::memoryPageSize() != 0 ? 1 : 0);
+                        uint32_t freeIndex = buddyFreeIndices[highestIndex];
+                        buddyFreeIndices[highestIndex] = buddyFreeIndices[i];
 
-                    IB::decommitMemoryPages(reinterpret_cast<void *>(alignedMemoryAddress), memoryPageCount);
+                        removeFreeBuddyBlock(chunk, freeIndex);
+                    }
+
+                    block = currentBlock;
+                    resized = true;
                 }
+            }
+
+            if (resized)
+            {
+                commitBuddyPages(chunk, reinterpret_cast<uintptr_t>(memory), blockSize);
+
+                chunk->AllocatedBlocks[blockIndex] = block;
+                chunk->AllocatedSizes[blockIndex] = static_cast<uint32_t>(blockSize);
+            }
+        }
+
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&chunk->Locked, 0);
+        return resized;
+    }
+
+    bool freeMediumMemory(void *memory, size_t *freedSize)
+    {
+        uint32_t memoryPageIndex = findBuddyChunk(memory);
+        if (memoryPageIndex != UINT32_MAX)
+        {
+            // Busy loop until we're unlocked, definitely can be improved.
+            while (IB::atomicCompareExchange(&BuddyChunks[memoryPageIndex].Locked, 0, 1) != 0)
+            {
+            }
+            IB::threadAcquire();
+
+            uint32_t blockIndex = findAllocatedBuddyBlock(&BuddyChunks[memoryPageIndex], memory);
+            if (blockIndex != UINT32_MAX)
+            {
+                BuddyBlock currentBlock = BuddyChunks[memoryPageIndex].AllocatedBlocks[blockIndex];
+                *freedSize = BuddyChunks[memoryPageIndex].AllocatedSizes[blockIndex];
+
+                BuddyChunks[memoryPageIndex].AllocatedBlocks[blockIndex] = BuddyChunks[memoryPageIndex].AllocatedBlocks[BuddyChunks[memoryPageIndex].AllocatedBlockCount - 1];
+                BuddyChunks[memoryPageIndex].AllocatedSizes[blockIndex] = BuddyChunks[memoryPageIndex].AllocatedSizes[BuddyChunks[memoryPageIndex].AllocatedBlockCount - 1];
+                BuddyChunks[memoryPageIndex].AllocatedBlockCount--;
+
+                addFreeBuddyBlock(&BuddyChunks[memoryPageIndex], currentBlock);
 
                 // Coallesce our buddies back into bigger blocks
                 bool blockFound = true;
@@ -711,35 +1160,31 @@ namespace
                         if (otherEvenIndex == evenIndex && otherBlock.Layer == currentBlock.Layer)
                         {
                             // Since the last element of our free blocks is our current block,
-                            // Pull the second from last block instead
-                            BuddyChunks[memoryPageIndex].FreeBlocks[i] = BuddyChunks[memoryPageIndex].FreeBlocks[BuddyChunks[memoryPageIndex].FreeBlockCount - 2];
-                            BuddyChunks[memoryPageIndex].FreeBlockCount -= 2;
+                            // remove it first, our buddy's slot is then filled by the second from last block.
+                            removeFreeBuddyBlock(&BuddyChunks[memoryPageIndex], freeBlockEnd);
+                            removeFreeBuddyBlock(&BuddyChunks[memoryPageIndex], i);
 
                             BuddyBlock parentBlock{};
                             parentBlock.Index = evenIndex / 2;
                             parentBlock.Layer = currentBlock.Layer + 1;
 
                             currentBlock = parentBlock;
-                            BuddyChunks[memoryPageIndex].FreeBlocks[BuddyChunks[memoryPageIndex].FreeBlockCount] = parentBlock;
-                            BuddyChunks[memoryPageIndex].FreeBlockCount++;
-
-                            if (currentBlock.Layer >= getLayerFromSize(IB::memoryPageSize()))
-                            {
-                                size_t blockSize = getSizeFromLayer(currentBlock.Layer);
-                                ptrdiff_t memoryOffset = blockSize * currentBlock.Index;
-                                uintptr_t memoryAddress = reinterpret_cast<uintptr_t>(BuddyChunks[memoryPageIndex].MemoryPages) + memoryOffset;
-
-                                uintptr_t alignedMemoryAddress = memoryAddress / IB::memoryPageSize() * IB::memoryPageSize();
-                                uint32_t memoryPageCount = static_cast<uint32_t>(blockSize / IB::memoryPageSize()) + (blockSize % IB::memoryPageSize() != 0 ? 1 : 0);
-
-                                IB::decommitMemoryPages(reinterpret_cast<void *>(alignedMemoryAddress), memoryPageCount);
-                            }
+                            addFreeBuddyBlock(&BuddyChunks[memoryPageIndex], parentBlock);
 
                             blockFound = true;
                             break;
                         }
                     }
                 }
+
+                // Keep some of our free pages committed, we're likely to allocate them again soon.
+                // Decommitting on every free would thrash our commits on a workload that oscillates around a block boundary.
+                // Once we're over budget, our trim thread decommits our retained blocks if it's running. Otherwise we decommit our oldest ones here.
+                BuddyChunk *chunk = &BuddyChunks[memoryPageIndex];
+                if (Policy.TrimIntervalMilliseconds == 0 && chunk->RetainedPageCount * IB::memoryPageSize() > Policy.RetainedBuddyMemory)
+                {
+                    trimRetainedBuddyBlocks(chunk, Policy.RetainedBuddyMemory);
+                }
             }
 
             // Unlock our block and make sure our changes are visible
@@ -750,231 +1195,1132 @@ namespace
         return memoryPageIndex != UINT32_MAX;
     }
 
-    uint64_t blockPoolSlotCount(size_t memoryPageSize, uint64_t blockSize)
+    // Decommits the free blocks that we've kept around until every chunk retains at most retainedMemory.
+    void trimMediumMemory(size_t retainedMemory)
     {
-        // Memory allocation sizes:
-        // B = block size
-        // B = 16 + f(N)
-        // Where N is the number of entities that can fit in the block along with the slots
-        // B-16 = f(N);
-        // f(N) = N/8+S*N
-        // Where S is the size of our blocks
-        // B-16=N/8+S*N
-        // Solve for N
-        // B-16 = N(1/8+S)
-        // B-16 = N(1/8+8S/8)
-        // B-16 = N(1+8S)/8
-        // (B-16)/(1+8S)=N/8
-        // (B-16)*8/(1+8S)=N
-        return (memoryPageSize - 16) * 8 / (1 + 8 * blockSize);
+        BuddyChunk *buddyChunks = IB::volatileLoad(&BuddyChunks);
+        if (buddyChunks == nullptr || buddyChunks == MemoryLock)
+        {
+            return;
+        }
+        IB::threadAcquire();
+
+        for (uint32_t i = 0; i < BuddyChunkCount; i++)
+        {
+            if (IB::volatileLoad(&buddyChunks[i].MemoryPages) == nullptr)
+            {
+                continue;
+            }
+
+            while (IB::atomicCompareExchange(&buddyChunks[i].Locked, 0, 1) != 0)
+            {
+            }
+            IB::threadAcquire();
+
+            if (retainedMemory == 0)
+            {
+                for (uint32_t j = 0; j < buddyChunks[i].FreeBlockCount; j++)
+                {
+                    decommitBuddyBlock(&buddyChunks[i], buddyChunks[i].FreeBlocks[j]);
+                }
+            }
+            else
+            {
+                trimRetainedBuddyBlocks(&buddyChunks[i], retainedMemory);
+            }
+
+            IB::threadRelease();
+            IB::volatileStore<uint32_t>(&buddyChunks[i].Locked, 0);
+        }
     }
 
-    struct BlockPageDesc
+    // Large Memory Allocations
+
+    struct CachedLargeBlock
     {
-        void **NextPagePtr;
-        uint64_t *SlotAllocations;
-        uintptr_t Blocks;
+        void *Memory = nullptr;
+        size_t Size = 0;
+        uint8_t SizeClass = 0;
     };
 
-    BlockPageDesc blockPageDesc(void *page, size_t blockSize, uint64_t slotCount)
+    constexpr uint32_t MaxLargeBlockCacheCount = 64;
+    struct LargeBlockCache
     {
-        void **nextPagePtr;
-        uint64_t *slotAllocations;
-        uintptr_t blocks;
-        {
-            uintptr_t address = reinterpret_cast<uintptr_t>(page);
-            blocks = address;
-            address += blockSize * slotCount;
-
-            uint64_t addressMod = address % sizeof(void*);
-            address += addressMod != 0 ? sizeof(void*) - addressMod : 0;
+        CachedLargeBlock Blocks[MaxLargeBlockCacheCount]; // Sorted from oldest to newest
+        uint32_t BlockCount = 0;
+        size_t CachedSize = 0;
+        uint32_t Locked = 0;
+    };
+    LargeBlockCache LargeBlocks;
 
-            nextPagePtr = reinterpret_cast<void **>(address);
-            address += sizeof(void *);
+    // Blocks are reused within their power of 2 size class, we waste at most half of a reused block.
+    uint8_t getLargeSizeClass(size_t size)
+    {
+        return logBase2(size - 1) + 1;
+    }
 
-            slotAllocations = reinterpret_cast<uint64_t *>(address);
-            address += slotCount / 64 + (slotCount % 64) != 0 ? 1 : 0;
+    void lockLargeBlockCache()
+    {
+        while (IB::atomicCompareExchange(&LargeBlocks.Locked, 0, 1) != 0)
+        {
         }
-
-        return BlockPageDesc{ nextPagePtr, slotAllocations, blocks };
+        IB::threadAcquire();
     }
 
-} // namespace
+    void unlockLargeBlockCache()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&LargeBlocks.Locked, 0);
+    }
 
-namespace IB
-{
-    void *memoryAllocate(size_t size, size_t alignment)
+    // Must be called with our cache locked
+    void *removeCachedLargeBlock(uint32_t index)
     {
-        IB_ASSERT(size != 0, "Can't allocate block of size 0!");
-        size_t blockSize = size;
-        if (size != alignment && size % alignment != 0)
+        void *memory = LargeBlocks.Blocks[index].Memory;
+        LargeBlocks.CachedSize -= LargeBlocks.Blocks[index].Size;
+
+        // Keep our blocks sorted by age, we evict the oldest first.
+        for (uint32_t i = index; i < LargeBlocks.BlockCount - 1; i++)
         {
-            if (size > alignment)
+            LargeBlocks.Blocks[i] = LargeBlocks.Blocks[i + 1];
+        }
+        LargeBlocks.BlockCount--;
+        return memory;
+    }
+
+    void *allocateLargeMemory(size_t blockSize, size_t reservedSize)
+    {
+        uint8_t sizeClass = getLargeSizeClass(blockSize);
+
+        void *memory = nullptr;
+        lockLargeBlockCache();
+        // Look at our newest blocks first, they're the most likely to still be in our caches and TLB.
+        for (uint32_t i = LargeBlocks.BlockCount; i > 0; i--)
+        {
+            CachedLargeBlock const &block = LargeBlocks.Blocks[i - 1];
+            if (block.SizeClass == sizeClass && block.Size >= blockSize)
             {
-                blockSize = ((size / alignment) + 1) * alignment;
+                memory = removeCachedLargeBlock(i - 1);
+                break;
             }
-            else
+        }
+        unlockLargeBlockCache();
+
+        if (memory == nullptr)
+        {
+            uint32_t options = 0;
+            if (Policy.LargePageThreshold != 0 && blockSize >= Policy.LargePageThreshold)
             {
-                blockSize = alignment;
+                options |= IB::MapMemoryOptions::LargePages;
             }
+            memory = IB::mapLargeMemoryBlock(blockSize, reservedSize, options);
         }
-        // By this point, if blockSize is larger than size, then we have internal fragmentation.
-        // TODO: Log internal fragmentation
+
+        return memory;
+    }
+
+    // Returns the size of the block we've freed.
+    size_t freeLargeMemory(void *memory)
+    {
+        size_t size = IB::largeMemoryBlockSize(memory);
+        if (size == 0)
+        {
+            // Not one of our mappings, nothing to free.
+            return 0;
+        }
+
+        uint32_t maxBlockCount = Policy.LargeBlockCacheCount < MaxLargeBlockCacheCount ? Policy.LargeBlockCacheCount : MaxLargeBlockCacheCount;
+        if (size > Policy.LargeBlockCacheBudget || maxBlockCount == 0)
+        {
+            IB::unmapLargeMemoryBlock(memory);
+            return size;
+        }
+
+        // Unmap our evicted blocks once we've released our lock, unmapping is slow.
+        void *evictedBlocks[MaxLargeBlockCacheCount];
+        uint32_t evictedBlockCount = 0;
+
+        lockLargeBlockCache();
+        while (LargeBlocks.BlockCount > 0 && (LargeBlocks.BlockCount + 1 > maxBlockCount || LargeBlocks.CachedSize + size > Policy.LargeBlockCacheBudget))
+        {
+            evictedBlocks[evictedBlockCount++] = removeCachedLargeBlock(0);
+        }
+
+        CachedLargeBlock &block = LargeBlocks.Blocks[LargeBlocks.BlockCount++];
+        block.Memory = memory;
+        block.Size = size;
+        block.SizeClass = getLargeSizeClass(size);
+        LargeBlocks.CachedSize += size;
+        unlockLargeBlockCache();
+
+        for (uint32_t i = 0; i < evictedBlockCount; i++)
+        {
+            IB::unmapLargeMemoryBlock(evictedBlocks[i]);
+        }
+        return size;
+    }
+
+    // Unmaps our oldest cached blocks until our cache fits in our budget.
+    void trimLargeMemory(size_t budget, uint32_t maxBlockCount)
+    {
+        void *evictedBlocks[MaxLargeBlockCacheCount];
+        uint32_t evictedBlockCount = 0;
+
+        lockLargeBlockCache();
+        while (LargeBlocks.BlockCount > 0 && (LargeBlocks.BlockCount > maxBlockCount || LargeBlocks.CachedSize > budget))
+        {
+            evictedBlocks[evictedBlockCount++] = removeCachedLargeBlock(0);
+        }
+        unlockLargeBlockCache();
+
+        for (uint32_t i = 0; i < evictedBlockCount; i++)
+        {
+            IB::unmapLargeMemoryBlock(evictedBlocks[i]);
+        }
+    }
+
+    // Only releases the memory we've retained past our policy's budgets, our budgeted memory stays ready to be reused.
+    void trimToPolicy()
+    {
+        trimSmallMemory(Policy.RetainedSlabPageCount);
+        trimMediumMemory(Policy.RetainedBuddyMemory);
+        trimLargeMemory(Policy.LargeBlockCacheBudget, Policy.LargeBlockCacheCount);
+    }
+
+    // Background Trimming
+
+    IB::ThreadHandle TrimThread = {};
+    IB::ThreadEvent TrimThreadEvent = {};
+    bool TrimThreadRunning = false;
+    uint32_t StopTrimThread = 0;
+
+    void trimThreadFunc(void *)
+    {
+        while (IB::volatileLoad(&StopTrimThread) == 0)
+        {
+            // We only wake up early when we're asked to stop.
+            IB::waitOnThreadEvent(TrimThreadEvent, Policy.TrimIntervalMilliseconds);
+            if (IB::volatileLoad(&StopTrimThread) == 0)
+            {
+                trimToPolicy();
+            }
+        }
+    }
+
+    void startTrimThread()
+    {
+        IB::volatileStore<uint32_t>(&StopTrimThread, 0);
+        TrimThreadEvent = IB::createThreadEvent();
+        TrimThread = IB::createThread(&trimThreadFunc, nullptr);
+        TrimThreadRunning = true;
+    }
+
+    void stopTrimThread()
+    {
+        IB::volatileStore<uint32_t>(&StopTrimThread, 1);
+        IB::signalThreadEvent(TrimThreadEvent);
+        IB::waitOnThreads(&TrimThread, 1);
+
+        IB::destroyThread(TrimThread);
+        IB::destroyThreadEvent(TrimThreadEvent);
+        TrimThreadRunning = false;
+    }
+
+    // Allocation Entry Points
+
+    // Returns the size of the block we've handed out in allocatedSize.
+    // Returns nullptr if we're out of memory.
+    void *allocateMemory(size_t size, size_t alignment, size_t *allocatedSize)
+    {
+        IB_ASSERT(size != 0, "Can't allocate block of size 0!");
+        size_t blockSize = alignedBlockSize(size, alignment);
 
         void *memory = nullptr;
         if (blockSize <= SmallMemoryBoundary)
         {
             memory = allocateSmallMemory(blockSize);
+            *allocatedSize = blockSize;
         }
         else if (blockSize <= MediumMemoryBoundary)
         {
             memory = allocateMediumMemory(blockSize);
+            *allocatedSize = blockSize;
         }
         else
         {
-            memory = IB::mapLargeMemoryBlock(blockSize);
+            memory = allocateLargeMemory(blockSize, 0);
+            // We might have reused a larger cached block.
+            *allocatedSize = memory != nullptr ? IB::largeMemoryBlockSize(memory) : 0;
         }
 
         return memory;
     }
 
-    void memoryFree(void *memory)
+    // Returns the size of the block allocateMemory would hand out, what our tag is charged for our allocation.
+    // Large blocks can still come out larger if we reuse a cached block or map them with large pages.
+    size_t allocatedBlockSize(size_t size, size_t alignment)
     {
-        if (memory == nullptr)
+        size_t blockSize = alignedBlockSize(size, alignment);
+        if (blockSize > MediumMemoryBoundary)
         {
-            return;
+            size_t pageSize = IB::memoryPageSize();
+            blockSize = (blockSize + pageSize - 1) / pageSize * pageSize;
         }
+        return blockSize;
+    }
 
-        if (!freeSmallMemory(memory))
+    // Returns the size of the block we've freed.
+    size_t freeMemory(void *memory)
+    {
+        size_t freedSize = 0;
+        if (!freeSmallMemory(memory, &freedSize))
         {
-            if (!freeMediumMemory(memory))
+            if (!freeMediumMemory(memory, &freedSize))
             {
-                IB::unmapLargeMemoryBlock(memory);
+                freedSize = freeLargeMemory(memory);
             }
         }
+        return freedSize;
     }
 
-    BlockPool createBlockPool(size_t blockSize, size_t blockAlignment)
+    // Expects memory to be valid.
+    // Returns the size of our block before and after our reallocation in previousSize and newSize.
+    // Returns nullptr and leaves our block untouched if we're out of memory.
+    void *reallocateMemory(void *memory, size_t size, size_t alignment, size_t *previousSize, size_t *newSize)
     {
-        return BlockPool{nullptr, blockSize > blockAlignment ? blockSize : blockAlignment };
+        IB_ASSERT(size != 0, "Can't reallocate to a block of size 0!");
+        size_t blockSize = alignedBlockSize(size, alignment);
+
+        bool resized = false;
+        size_t currentSize = 0; // How much of our old block we might need to copy if we move.
+
+        uint32_t smallTableIndex = findSmallMemoryTable(memory);
+        uint32_t chunkIndex = smallTableIndex == UINT32_MAX ? findBuddyChunk(memory) : UINT32_MAX;
+        if (smallTableIndex != UINT32_MAX)
+        {
+            currentSize = smallTableIndex + 1;
+            resized = blockSize <= currentSize && reinterpret_cast<uintptr_t>(memory) % alignment == 0;
+        }
+        else if (chunkIndex != UINT32_MAX)
+        {
+            resized = reallocateMediumMemory(chunkIndex, memory, blockSize, alignment, &currentSize);
+        }
+        else
+        {
+            currentSize = IB::largeMemoryBlockSize(memory);
+            // Don't stay in a mapping if we've shrunk to a medium or small block, we would be holding onto all our pages.
+            resized = blockSize > MediumMemoryBoundary && IB::resizeLargeMemoryBlock(memory, blockSize);
+        }
+
+        if (resized)
+        {
+            *previousSize = currentSize;
+            if (smallTableIndex != UINT32_MAX)
+            {
+                *newSize = currentSize; // Our slab blocks never change size
+            }
+            else if (chunkIndex != UINT32_MAX)
+            {
+                *newSize = blockSize;
+            }
+            else
+            {
+                *newSize = IB::largeMemoryBlockSize(memory);
+            }
+            return memory;
+        }
+
+        void *newMemory = nullptr;
+        if (blockSize > MediumMemoryBoundary)
+        {
+            // We're growing into a mapping, reserve room for our next growth so that it doesn't need a copy.
+            newMemory = allocateLargeMemory(blockSize, blockSize * 2);
+            *newSize = newMemory != nullptr ? IB::largeMemoryBlockSize(newMemory) : 0;
+        }
+        else
+        {
+            newMemory = allocateMemory(size, alignment, newSize);
+        }
+
+        if (newMemory == nullptr)
+        {
+            return nullptr;
+        }
+
+        memcpy(newMemory, memory, currentSize < size ? currentSize : size);
+        *previousSize = freeMemory(memory);
+        return newMemory;
     }
 
-    void destroyBlockPool(BlockPool *pool)
+    // Memory Tags
+
+    // Every tag gets its own cache line, threads allocating with different tags shouldn't contend on our stats.
+    struct alignas(64) MemoryTagStats
     {
-        // No threadsafety here. We're assuming we're cleaning up without other callsites trying to use this block pool.
-        if (pool->Memory != nullptr)
+        uint64_t AllocatedBytes = 0;
+        uint64_t PeakAllocatedBytes = 0;
+        uint64_t AllocationCount = 0;
+    };
+    MemoryTagStats TagStats[static_cast<uint32_t>(IB::MemoryTag::Count)];
+
+    char const *MemoryTagNames[] = {
+        "General",
+        "Renderer",
+        "Assets",
+        "Entities",
+        "Jobs",
+        "Tools",
+        "Audio",
+        "RendererDevice"
+    };
+    static_assert(sizeof(MemoryTagNames) / sizeof(MemoryTagNames[0]) == static_cast<uint32_t>(IB::MemoryTag::Count), "Every memory tag needs a name!");
+
+    // Memory Budgets
+
+    struct MemoryPressureListener
+    {
+        IB::MemoryPressureCallback *Callback = nullptr;
+        void *Data = nullptr;
+    };
+
+    struct alignas(64) MemoryTagBudget
+    {
+        uint64_t SoftLimit = 0;
+        uint64_t HardLimit = 0;
+        MemoryPressureListener Listeners[IB::MaxMemoryPressureCallbacks];
+        uint32_t ListenerCount = 0;
+        uint32_t Locked = 0; // Guards our listeners
+        uint32_t Notifying = 0; // Only one thread notifies our listeners at a time
+        uint32_t OverHardLimit = 0; // Only warn once every time we go over our hard limit
+    };
+    MemoryTagBudget TagBudgets[static_cast<uint32_t>(IB::MemoryTag::Count)];
+
+    void lockTagBudget(MemoryTagBudget *budget)
+    {
+        while (IB::atomicCompareExchange(&budget->Locked, 0, 1) != 0)
         {
-            uint64_t const slotCount = blockPoolSlotCount(IB::memoryPageSize(), pool->BlockSize);
+        }
+        IB::threadAcquire();
+    }
 
-            void *nextPage = pool->Memory;
-            while (nextPage != nullptr)
-            {
-                void *currentPage = nextPage;
+    void unlockTagBudget(MemoryTagBudget *budget)
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&budget->Locked, 0);
+    }
 
-                BlockPageDesc pageDesc = blockPageDesc(currentPage, pool->BlockSize, slotCount);
+    void notifyMemoryPressure(IB::MemoryTag tag, IB::MemoryPressure pressure, uint64_t requestedBytes)
+    {
+        MemoryTagBudget &budget = TagBudgets[static_cast<uint32_t>(tag)];
+        // If someone is already notifying our listeners, they're already releasing memory.
+        // This also keeps our listeners from notifying themselves when they allocate with their tag.
+        if (IB::atomicCompareExchange(&budget.Notifying, 0, 1) != 0)
+        {
+            return;
+        }
 
-                IB_ASSERT(areAllSlotsClear(pageDesc.SlotAllocations, slotCount), "Pool should be completely released before destroying!");
+        // Copy our listeners, they're free to register and unregister from their callbacks.
+        MemoryPressureListener listeners[IB::MaxMemoryPressureCallbacks];
+        lockTagBudget(&budget);
+        uint32_t listenerCount = budget.ListenerCount;
+        for (uint32_t i = 0; i < listenerCount; i++)
+        {
+            listeners[i] = budget.Listeners[i];
+        }
+        unlockTagBudget(&budget);
 
-                nextPage = *pageDesc.NextPagePtr;
-                decommitMemoryPages(currentPage, 1);
-                freeMemoryPages(currentPage);
-            }
+        for (uint32_t i = 0; i < listenerCount; i++)
+        {
+            listeners[i].Callback(listeners[i].Data, tag, pressure, requestedBytes);
         }
 
-        *pool = {};
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&budget.Notifying, 0);
     }
 
-    void *memoryAllocate(BlockPool *pool)
+    // Returns false if our allocation would still put us over our hard limit once our listeners have released their memory.
+    bool fitsHardLimit(IB::MemoryTag tag, size_t size)
     {
-        uint64_t const slotCount = blockPoolSlotCount(IB::memoryPageSize(), pool->BlockSize);
-        if (atomicCompareExchange(&pool->Memory, nullptr, MemoryLock) == nullptr)
+        MemoryTagBudget &budget = TagBudgets[static_cast<uint32_t>(tag)];
+        uint64_t hardLimit = IB::volatileLoad(&budget.HardLimit);
+        if (hardLimit == 0)
         {
-            void *memoryPage = IB::reserveMemoryPages(1);
-            commitMemoryPages(memoryPage, 1);
-            volatileStore(&pool->Memory, memoryPage);
+            return true;
         }
 
-        IB_ASSERT(volatileLoad(&pool->Memory) != nullptr, "We've made a mistake if we see this value as nullptr.");
-        while (volatileLoad(&pool->Memory) == MemoryLock)
+        uint64_t *allocatedBytes = &TagStats[static_cast<uint32_t>(tag)].AllocatedBytes;
+        if (IB::volatileLoad(allocatedBytes) + size <= hardLimit)
         {
+            return true;
         }
 
-        void *allocatedSlot = nullptr;
-        void *currentPage = pool->Memory;
-        while (allocatedSlot == nullptr)
+        notifyMemoryPressure(tag, IB::MemoryPressure::Hard, size);
+        return IB::volatileLoad(allocatedBytes) + size <= hardLimit;
+    }
+
+    void warnOverHardLimit(IB::MemoryTag tag)
+    {
+        if (IB::atomicCompareExchange(&TagBudgets[static_cast<uint32_t>(tag)].OverHardLimit, 0, 1) == 0)
         {
-            BlockPageDesc pageDesc = blockPageDesc(currentPage, pool->BlockSize, slotCount);
+            char message[128];
+            snprintf(message, sizeof(message), "%s allocations are going over their hard memory budget.", MemoryTagNames[static_cast<uint32_t>(tag)]);
+            IB_LOG(IB::LogLevel::Warn, "Memory", message);
+        }
+    }
 
-            uint64_t slotOffset = 0;
-            for (
-                uint64_t slot = findClearedSlot(pageDesc.SlotAllocations, slotCount);
-                slot != NoSlot;
-                slot = findClearedSlot(pageDesc.SlotAllocations + slotOffset, slotCount - slotOffset))
-            {
-                slotOffset += slot / 64; // Advance our slot offset
+    void addTaggedMemory(IB::MemoryTag tag, size_t size)
+    {
+        MemoryTagStats &stats = TagStats[static_cast<uint32_t>(tag)];
+        uint64_t allocatedBytes = IB::atomicAdd(&stats.AllocatedBytes, size) + size;
 
-                uint64_t *slotBlock = pageDesc.SlotAllocations + slotOffset;
-                uint64_t slotSet = 1ull << (slot % 64);
-                // If our slot wasn't already set, great! That's our block
-                if ((atomicOr(slotBlock, slotSet) & slotSet) == 0)
-                {
-                    allocatedSlot = reinterpret_cast<void *>(pageDesc.Blocks + slot * pool->BlockSize);
-                    break;
-                }
-            }
+        // Only notify our listeners when we cross our soft limit, they're expected to bring us back under it.
+        uint64_t softLimit = IB::volatileLoad(&TagBudgets[static_cast<uint32_t>(tag)].SoftLimit);
+        if (softLimit != 0 && allocatedBytes > softLimit && allocatedBytes - size <= softLimit)
+        {
+            notifyMemoryPressure(tag, IB::MemoryPressure::Soft, size);
+        }
+        IB::atomicAdd(&stats.AllocationCount, 1);
 
-            if (allocatedSlot == nullptr)
+        uint64_t peak = IB::volatileLoad(&stats.PeakAllocatedBytes);
+        while (allocatedBytes > peak)
+        {
+            uint64_t previousPeak = IB::atomicCompareExchange(&stats.PeakAllocatedBytes, peak, allocatedBytes);
+            if (previousPeak == peak)
             {
-                currentPage = volatileLoad(pageDesc.NextPagePtr);
-                if (currentPage == nullptr)
-                {
-                    if (atomicCompareExchange(pageDesc.NextPagePtr, nullptr, MemoryLock) == nullptr)
-                    {
-                        void *nextPage = IB::reserveMemoryPages(1);
-                        commitMemoryPages(nextPage, 1);
-                        volatileStore(pageDesc.NextPagePtr, nextPage);
-                    }
+                break;
+            }
+            peak = previousPeak;
+        }
+    }
 
-                    IB_ASSERT(volatileLoad(pageDesc.NextPagePtr) != nullptr, "We've made a mistake if we see this value as nullptr.");
-                    while (volatileLoad(pageDesc.NextPagePtr) == MemoryLock)
-                    {
-                    }
+    void removeTaggedMemory(IB::MemoryTag tag, size_t size)
+    {
+        MemoryTagStats &stats = TagStats[static_cast<uint32_t>(tag)];
+        // Adding our two's complement subtracts from our unsigned counters.
+        uint64_t allocatedBytes = IB::atomicAdd(&stats.AllocatedBytes, 0 - static_cast<uint64_t>(size)) - size;
+        IB::atomicAdd(&stats.AllocationCount, UINT64_MAX);
 
-                    threadLoadLoadFence(); // Assure that this load is completed after our previous load loop
-                    currentPage = volatileLoad(pageDesc.NextPagePtr);
-                }
+        MemoryTagBudget &budget = TagBudgets[static_cast<uint32_t>(tag)];
+        if (IB::volatileLoad(&budget.OverHardLimit) != 0 && allocatedBytes <= IB::volatileLoad(&budget.HardLimit))
+        {
+            IB::volatileStore<uint32_t>(&budget.OverHardLimit, 0);
+        }
+    }
+
+    // Allocation Tracing
+
+    struct AllocationTrace
+    {
+        IB::AllocationTraceEvent *Events = nullptr;
+        uint32_t MaxEventCount = 0;
+        uint32_t EventCount = 0;
+        uint32_t Active = 0;
+        uint32_t Writers = 0; // Threads currently recording an event
+    };
+    AllocationTrace Trace;
+
+    // Reserves our event's place in our trace, returns UINT32_MAX if we're not tracing.
+    uint32_t beginAllocationEvent()
+    {
+        if (IB::volatileLoad(&Trace.Active) == 0)
+        {
+            return UINT32_MAX;
+        }
+
+        IB::atomicIncrement(&Trace.Writers);
+        IB::threadAcquire();
+        // Our trace might have ended while we were registering ourselves.
+        if (IB::volatileLoad(&Trace.Active) == 0)
+        {
+            IB::atomicDecrement(&Trace.Writers);
+            return UINT32_MAX;
+        }
+
+        return IB::atomicIncrement(&Trace.EventCount) - 1;
+    }
+
+    void endAllocationEvent(uint32_t eventIndex, uint32_t type, void *memory, void *previousMemory, size_t size, size_t alignment)
+    {
+        if (eventIndex == UINT32_MAX)
+        {
+            return;
+        }
+
+        if (eventIndex < Trace.MaxEventCount)
+        {
+            IB::AllocationTraceEvent &event = Trace.Events[eventIndex];
+            event.Memory = reinterpret_cast<uint64_t>(memory);
+            event.PreviousMemory = reinterpret_cast<uint64_t>(previousMemory);
+            event.Size = size;
+            event.Alignment = static_cast<uint32_t>(alignment);
+            event.Type = type;
+        }
+
+        IB::threadRelease();
+        IB::atomicDecrement(&Trace.Writers);
+    }
+
+    void recordAllocationEvent(uint32_t type, void *memory, void *previousMemory, size_t size, size_t alignment)
+    {
+        endAllocationEvent(beginAllocationEvent(), type, memory, previousMemory, size, alignment);
+    }
+
+    // Returns nullptr if we're out of memory, our old block is untouched.
+    void *reallocateTaggedMemory(void *memory, size_t size, size_t alignment, IB::MemoryTag tag)
+    {
+        // Reserve our event before we reallocate, our previous memory can be reused
+        // by another thread as soon as we've released it and its allocation must come after us.
+        uint32_t eventIndex = beginAllocationEvent();
+        size_t previousSize = 0;
+        size_t newSize = 0;
+        void *newMemory = reallocateMemory(memory, size, alignment, &previousSize, &newSize);
+        if (newMemory == nullptr)
+        {
+            // Nothing changed, freeing a null block is a no-op when our trace is replayed.
+            endAllocationEvent(eventIndex, IB::AllocationTraceEvent::Free, nullptr, nullptr, 0, 0);
+            return nullptr;
+        }
+        endAllocationEvent(eventIndex, IB::AllocationTraceEvent::Reallocate, newMemory, memory, size, alignment);
+
+        removeTaggedMemory(tag, previousSize);
+        addTaggedMemory(tag, newSize);
+        return newMemory;
+    }
+
+    // Block Pools
+
+    // Every pool page starts with our header, followed by our slot bitmap and then our blocks.
+    // Pool pages are page aligned, a block can find its page by masking its address.
+    struct BlockPage
+    {
+        BlockPage *Next = nullptr;
+        BlockPage *Previous = nullptr;
+        // Only valid while we're in our pool's list of pages with free slots.
+        BlockPage *NextFree = nullptr;
+        BlockPage *PreviousFree = nullptr;
+        uint32_t UsedSlotCount = 0;
+    };
+
+    // We keep a single empty page around to avoid thrashing when a pool oscillates around a page boundary.
+    constexpr uint32_t MaxEmptyBlockPageCount = 1;
+
+    uint64_t *blockPageSlots(BlockPage *page)
+    {
+        return reinterpret_cast<uint64_t *>(reinterpret_cast<uintptr_t>(page) + sizeof(BlockPage));
+    }
+
+    BlockPage *findBlockPage(void *blockMemory)
+    {
+        uintptr_t pageMask = ~static_cast<uintptr_t>(IB::memoryPageSize() - 1);
+        return reinterpret_cast<BlockPage *>(reinterpret_cast<uintptr_t>(blockMemory) & pageMask);
+    }
+
+    void insertBlockPage(void **pages, BlockPage *page)
+    {
+        BlockPage *head = reinterpret_cast<BlockPage *>(*pages);
+        page->Previous = nullptr;
+        page->Next = head;
+        if (head != nullptr)
+        {
+            head->Previous = page;
+        }
+        *pages = page;
+    }
+
+    void removeBlockPage(void **pages, BlockPage *page)
+    {
+        if (page->Previous != nullptr)
+        {
+            page->Previous->Next = page->Next;
+        }
+        else
+        {
+            *pages = page->Next;
+        }
+
+        if (page->Next != nullptr)
+        {
+            page->Next->Previous = page->Previous;
+        }
+    }
+
+    void insertFreeBlockPage(void **freePages, BlockPage *page)
+    {
+        BlockPage *head = reinterpret_cast<BlockPage *>(*freePages);
+        page->PreviousFree = nullptr;
+        page->NextFree = head;
+        if (head != nullptr)
+        {
+            head->PreviousFree = page;
+        }
+        *freePages = page;
+    }
+
+    void removeFreeBlockPage(void **freePages, BlockPage *page)
+    {
+        if (page->PreviousFree != nullptr)
+        {
+            page->PreviousFree->NextFree = page->NextFree;
+        }
+        else
+        {
+            *freePages = page->NextFree;
+        }
+
+        if (page->NextFree != nullptr)
+        {
+            page->NextFree->PreviousFree = page->PreviousFree;
+        }
+    }
+
+    void lockBlockPool(IB::BlockPool *pool)
+    {
+        while (IB::atomicCompareExchange(&pool->Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+    }
+
+    void unlockBlockPool(IB::BlockPool *pool)
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&pool->Locked, 0);
+    }
+
+    // Scratch Arenas
+
+    struct ScratchChunk
+    {
+        ScratchChunk *Next = nullptr;
+        size_t Size = 0;
+    };
+
+    void addScratchChunk(IB::ScratchArena *arena, size_t size)
+    {
+        ScratchChunk *chunk = new (IB::memoryAllocate(size, alignof(ScratchChunk), arena->Tag)) ScratchChunk{};
+        chunk->Next = reinterpret_cast<ScratchChunk *>(arena->Chunks);
+        chunk->Size = size;
+
+        arena->Chunks = chunk;
+        arena->Cursor = reinterpret_cast<uintptr_t>(chunk) + sizeof(ScratchChunk);
+        arena->End = reinterpret_cast<uintptr_t>(chunk) + size;
+        arena->TotalSize += size;
+    }
+
+    void freeScratchChunks(IB::ScratchArena *arena)
+    {
+        ScratchChunk *chunk = reinterpret_cast<ScratchChunk *>(arena->Chunks);
+        while (chunk != nullptr)
+        {
+            ScratchChunk *nextChunk = chunk->Next;
+            IB::memoryFree(chunk, arena->Tag);
+            chunk = nextChunk;
+        }
+
+        arena->Chunks = nullptr;
+        arena->Cursor = 0;
+        arena->End = 0;
+        arena->TotalSize = 0;
+    }
+} // namespace
+
+namespace IB
+{
+    void *memoryAllocate(size_t size, size_t alignment, MemoryTag tag)
+    {
+        if (!fitsHardLimit(tag, allocatedBlockSize(size, alignment)))
+        {
+            warnOverHardLimit(tag);
+        }
+
+        size_t allocatedSize = 0;
+        void *memory = allocateMemory(size, alignment, &allocatedSize);
+        if (memory == nullptr)
+        {
+            // Give our listeners a chance to release some memory before we give up.
+            notifyMemoryPressure(tag, MemoryPressure::Hard, size);
+            memory = allocateMemory(size, alignment, &allocatedSize);
+            IB_ASSERT(memory != nullptr, "We're out of memory.");
+        }
+
+        addTaggedMemory(tag, allocatedSize);
+        recordAllocationEvent(AllocationTraceEvent::Allocate, memory, nullptr, size, alignment);
+        return memory;
+    }
+
+    void *tryMemoryAllocate(size_t size, size_t alignment, MemoryTag tag)
+    {
+        if (!fitsHardLimit(tag, allocatedBlockSize(size, alignment)))
+        {
+            return nullptr;
+        }
+
+        size_t allocatedSize = 0;
+        void *memory = allocateMemory(size, alignment, &allocatedSize);
+        if (memory == nullptr)
+        {
+            return nullptr;
+        }
+
+        addTaggedMemory(tag, allocatedSize);
+        recordAllocationEvent(AllocationTraceEvent::Allocate, memory, nullptr, size, alignment);
+        return memory;
+    }
+
+    void memoryFree(void *memory, MemoryTag tag)
+    {
+        if (memory != nullptr)
+        {
+            // Record our free before our memory can be handed out again.
+            recordAllocationEvent(AllocationTraceEvent::Free, memory, nullptr, 0, 0);
+            removeTaggedMemory(tag, freeMemory(memory));
+        }
+    }
+
+    void *memoryReallocate(void *memory, size_t size, size_t alignment, MemoryTag tag)
+    {
+        if (memory == nullptr)
+        {
+            return memoryAllocate(size, alignment, tag);
+        }
+
+        // If we have to move, our new block is allocated while our old one is still alive, our budget has to fit all of it.
+        if (!fitsHardLimit(tag, allocatedBlockSize(size, alignment)))
+        {
+            warnOverHardLimit(tag);
+        }
+
+        void *newMemory = reallocateTaggedMemory(memory, size, alignment, tag);
+        if (newMemory == nullptr)
+        {
+            // Give our listeners a chance to release some memory before we give up.
+            notifyMemoryPressure(tag, MemoryPressure::Hard, size);
+            newMemory = reallocateTaggedMemory(memory, size, alignment, tag);
+            IB_ASSERT(newMemory != nullptr, "We're out of memory.");
+        }
+        return newMemory;
+    }
+
+    MemoryStats memoryStats(MemoryTag tag)
+    {
+        MemoryTagStats &tagStats = TagStats[static_cast<uint32_t>(tag)];
+
+        MemoryStats stats;
+        stats.AllocatedBytes = IB::volatileLoad(&tagStats.AllocatedBytes);
+        stats.PeakAllocatedBytes = IB::volatileLoad(&tagStats.PeakAllocatedBytes);
+        stats.AllocationCount = IB::volatileLoad(&tagStats.AllocationCount);
+        return stats;
+    }
+
+    char const *memoryTagName(MemoryTag tag)
+    {
+        return MemoryTagNames[static_cast<uint32_t>(tag)];
+    }
+
+    void setMemoryBudget(MemoryTag tag, MemoryBudget budget)
+    {
+        IB_ASSERT(budget.HardLimit == 0 || budget.SoftLimit <= budget.HardLimit, "Our soft limit should be under our hard limit.");
+
+        MemoryTagBudget &tagBudget = TagBudgets[static_cast<uint32_t>(tag)];
+        IB::volatileStore(&tagBudget.SoftLimit, budget.SoftLimit);
+        IB::volatileStore(&tagBudget.HardLimit, budget.HardLimit);
+        IB::volatileStore<uint32_t>(&tagBudget.OverHardLimit, 0);
+
+        // We might already be over our new budget.
+        uint64_t allocatedBytes = IB::volatileLoad(&TagStats[static_cast<uint32_t>(tag)].AllocatedBytes);
+        if (budget.SoftLimit != 0 && allocatedBytes > budget.SoftLimit)
+        {
+            notifyMemoryPressure(tag, budget.HardLimit != 0 && allocatedBytes > budget.HardLimit ? MemoryPressure::Hard : MemoryPressure::Soft, 0);
+        }
+    }
+
+    MemoryBudget memoryBudget(MemoryTag tag)
+    {
+        MemoryTagBudget &tagBudget = TagBudgets[static_cast<uint32_t>(tag)];
+
+        MemoryBudget budget;
+        budget.SoftLimit = IB::volatileLoad(&tagBudget.SoftLimit);
+        budget.HardLimit = IB::volatileLoad(&tagBudget.HardLimit);
+        return budget;
+    }
+
+    void registerMemoryPressureCallback(MemoryTag tag, MemoryPressureCallback *callback, void *data)
+    {
+        MemoryTagBudget &budget = TagBudgets[static_cast<uint32_t>(tag)];
+        lockTagBudget(&budget);
+        IB_ASSERT(budget.ListenerCount < MaxMemoryPressureCallbacks, "Too many memory pressure callbacks for this tag!");
+        budget.Listeners[budget.ListenerCount].Callback = callback;
+        budget.Listeners[budget.ListenerCount].Data = data;
+        budget.ListenerCount++;
+        unlockTagBudget(&budget);
+    }
+
+    void unregisterMemoryPressureCallback(MemoryTag tag, MemoryPressureCallback *callback, void *data)
+    {
+        MemoryTagBudget &budget = TagBudgets[static_cast<uint32_t>(tag)];
+        lockTagBudget(&budget);
+        for (uint32_t i = 0; i < budget.ListenerCount; i++)
+        {
+            if (budget.Listeners[i].Callback == callback && budget.Listeners[i].Data == data)
+            {
+                budget.Listeners[i] = budget.Listeners[budget.ListenerCount - 1];
+                budget.ListenerCount--;
+                break;
             }
         }
+        unlockTagBudget(&budget);
+    }
 
-        return allocatedSlot;
+    bool trackMemory(MemoryTag tag, size_t size)
+    {
+        bool fits = fitsHardLimit(tag, size);
+        if (!fits)
+        {
+            warnOverHardLimit(tag);
+        }
+
+        addTaggedMemory(tag, size);
+        return fits;
     }
 
-    void memoryFree(BlockPool *pool, void *blockMemory)
+    void untrackMemory(MemoryTag tag, size_t size)
+    {
+        removeTaggedMemory(tag, size);
+    }
+
+    void setAllocatorPolicy(AllocatorPolicy policy)
+    {
+        // Our trim thread reads our policy, stop it while we change it.
+        if (TrimThreadRunning)
+        {
+            stopTrimThread();
+        }
+
+        Policy = policy;
+        // We might be keeping around more memory than our new policy allows.
+        trimToPolicy();
+
+        if (Policy.TrimIntervalMilliseconds != 0)
+        {
+            startTrimThread();
+        }
+    }
+
+    AllocatorPolicy allocatorPolicy()
+    {
+        return Policy;
+    }
+
+    void beginAllocationTrace(uint32_t maxEventCount)
+    {
+        IB_ASSERT(IB::volatileLoad(&Trace.Active) == 0, "We're already recording a trace!");
+
+        Trace.Events = reinterpret_cast<AllocationTraceEvent *>(IB::mapLargeMemoryBlock(sizeof(AllocationTraceEvent) * maxEventCount));
+        Trace.MaxEventCount = maxEventCount;
+        Trace.EventCount = 0;
+
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&Trace.Active, 1);
+    }
+
+    void endAllocationTrace(char const *filepath)
     {
-        uint64_t const slotCount = blockPoolSlotCount(IB::memoryPageSize(), pool->BlockSize);
+        IB::volatileStore<uint32_t>(&Trace.Active, 0);
+        IB::threadStoreLoadFence();
+        // Wait for our stragglers to finish writing their events.
+        while (IB::volatileLoad(&Trace.Writers) != 0)
+        {
+        }
+        IB::threadAcquire();
 
-        void *nextPage = pool->Memory;
-        while (nextPage != nullptr)
+        uint32_t eventCount = Trace.EventCount < Trace.MaxEventCount ? Trace.EventCount : Trace.MaxEventCount;
+        if (Trace.EventCount > Trace.MaxEventCount)
         {
-            void *currentPage = nextPage;
+            IB_LOG(IB::LogLevel::Warn, "Allocator", "Our allocation trace ran out of space, the end of our trace was dropped.");
+        }
 
-            BlockPageDesc pageDesc = blockPageDesc(currentPage, pool->BlockSize, slotCount);
+        IB::File file = IB::openFile(filepath, IB::OpenFileOptions::Write | IB::OpenFileOptions::Create | IB::OpenFileOptions::Overwrite);
+        IB::appendToFile(file, Trace.Events, sizeof(AllocationTraceEvent) * eventCount);
+        IB::closeFile(file);
 
-            uintptr_t blockAddress = reinterpret_cast<uintptr_t>(blockMemory);
-            uintptr_t blockOffset = blockAddress - pageDesc.Blocks;
-            bool isInBlock = blockOffset < sizeof(pool->BlockSize) * slotCount;
-            if (isInBlock)
+        IB::unmapLargeMemoryBlock(Trace.Events);
+        Trace = {};
+    }
+
+    void trimMemory()
+    {
+        trimSmallMemory(0);
+        trimMediumMemory(0);
+        trimLargeMemory(0, 0);
+    }
+
+    BlockPool createBlockPool(size_t blockSize, size_t blockAlignment, MemoryTag tag)
+    {
+        size_t const pageSize = IB::memoryPageSize();
+        IB_ASSERT(blockAlignment <= pageSize, "Our blocks can't be aligned further than our pages!");
+
+        BlockPool pool{};
+        pool.BlockSize = alignedBlockSize(blockSize, blockAlignment);
+        pool.BlockAlignment = blockAlignment;
+        pool.Tag = tag;
+
+        // Start with as many slots as could possibly fit and remove slots until our bitmap and our blocks fit in our page.
+        uint64_t slotCount = (pageSize - sizeof(BlockPage)) / pool.BlockSize;
+        size_t blocksOffset = 0;
+        for (; slotCount > 0; slotCount--)
+        {
+            size_t slotsSize = (slotCount / 64 + (slotCount % 64 != 0 ? 1 : 0)) * sizeof(uint64_t);
+            blocksOffset = alignedBlockSize(sizeof(BlockPage) + slotsSize, blockAlignment);
+            if (blocksOffset + slotCount * pool.BlockSize <= pageSize)
             {
-                uint64_t slot = blockOffset / pool->BlockSize;
-                uint64_t slotMask = ~(1ull << (slot % 64));
-                uint64_t *slotBlock = pageDesc.SlotAllocations + slot / 64;
-                atomicAnd(slotBlock, slotMask);
                 break;
             }
+        }
+        IB_ASSERT(slotCount > 0, "Our blocks are too large to fit in a pool page!");
+
+        pool.SlotCount = static_cast<uint32_t>(slotCount);
+        pool.BlocksOffset = static_cast<uint32_t>(blocksOffset);
+        return pool;
+    }
+
+    void destroyBlockPool(BlockPool *pool)
+    {
+        // No threadsafety here. We're assuming we're cleaning up without other callsites trying to use this block pool.
+        BlockPage *page = reinterpret_cast<BlockPage *>(pool->Memory);
+        while (page != nullptr)
+        {
+            IB_ASSERT(page->UsedSlotCount == 0, "Pool should be completely released before destroying!");
+
+            BlockPage *nextPage = page->Next;
+            memoryFree(page, pool->Tag);
+            page = nextPage;
+        }
+
+        *pool = {};
+    }
+
+    void *memoryAllocate(BlockPool *pool)
+    {
+        lockBlockPool(pool);
+
+        BlockPage *page = reinterpret_cast<BlockPage *>(pool->FreePages);
+        if (page == nullptr)
+        {
+            // Allocating our page can take a while, don't hold up our pool's other threads while we do.
+            unlockBlockPool(pool);
+
+            // Our pages come from our buddy allocator, a page sized block is always page aligned.
+            void *pageMemory = memoryAllocate(IB::memoryPageSize(), IB::memoryPageSize(), pool->Tag);
+            page = new (pageMemory) BlockPage{};
+            memset(blockPageSlots(page), 0, pool->BlocksOffset - sizeof(BlockPage));
+
+            // Another thread might have added a page while we were unlocked, we still take our slot from ours.
+            lockBlockPool(pool);
+            insertBlockPage(&pool->Memory, page);
+            insertFreeBlockPage(&pool->FreePages, page);
+        }
+        else if (page->UsedSlotCount == 0)
+        {
+            pool->EmptyPageCount--;
+        }
+
+        uint64_t slot = findClearedSlot(blockPageSlots(page), pool->SlotCount);
+        IB_ASSERT(slot != NoSlot, "Our page is in our free list but it has no free slots!");
+        setSlot(blockPageSlots(page), slot);
+
+        page->UsedSlotCount++;
+        if (page->UsedSlotCount == pool->SlotCount)
+        {
+            removeFreeBlockPage(&pool->FreePages, page);
+        }
+
+        unlockBlockPool(pool);
+        return reinterpret_cast<void *>(reinterpret_cast<uintptr_t>(page) + pool->BlocksOffset + slot * pool->BlockSize);
+    }
+
+    void memoryFree(BlockPool *pool, void *blockMemory)
+    {
+        BlockPage *page = findBlockPage(blockMemory);
+        uintptr_t blockOffset = reinterpret_cast<uintptr_t>(blockMemory) - reinterpret_cast<uintptr_t>(page) - pool->BlocksOffset;
+        uint64_t slot = blockOffset / pool->BlockSize;
+        IB_ASSERT(blockOffset % pool->BlockSize == 0 && slot < pool->SlotCount, "Our memory isn't a block from our pool!");
+
+        BlockPage *releasedPage = nullptr;
+
+        lockBlockPool(pool);
+        clearSlot(blockPageSlots(page), slot);
+
+        // If we were full, we have a free slot again.
+        if (page->UsedSlotCount == pool->SlotCount)
+        {
+            insertFreeBlockPage(&pool->FreePages, page);
+        }
+        page->UsedSlotCount--;
+
+        if (page->UsedSlotCount == 0)
+        {
+            if (pool->EmptyPageCount < MaxEmptyBlockPageCount)
+            {
+                pool->EmptyPageCount++;
+            }
             else
             {
-                nextPage = *pageDesc.NextPagePtr;
+                removeFreeBlockPage(&pool->FreePages, page);
+                removeBlockPage(&pool->Memory, page);
+                releasedPage = page;
             }
         }
+        unlockBlockPool(pool);
+
+        if (releasedPage != nullptr)
+        {
+            memoryFree(releasedPage, pool->Tag);
+        }
+    }
+
+    ScratchArena createScratchArena(size_t chunkSize, MemoryTag tag)
+    {
+        IB_ASSERT(chunkSize > sizeof(ScratchChunk), "Our chunks need room for their header!");
+
+        ScratchArena arena{};
+        arena.ChunkSize = chunkSize;
+        arena.Tag = tag;
+        return arena;
+    }
+
+    void destroyScratchArena(ScratchArena *arena)
+    {
+        freeScratchChunks(arena);
+        *arena = {};
+    }
+
+    void *memoryAllocate(ScratchArena *arena, size_t size, size_t alignment)
+    {
+        uintptr_t memory = (arena->Cursor + alignment - 1) & ~(alignment - 1);
+        if (arena->Chunks == nullptr || memory + size > arena->End)
+        {
+            // Oversized allocations get a chunk of their own.
+            size_t requiredSize = sizeof(ScratchChunk) + size + alignment;
+            addScratchChunk(arena, requiredSize > arena->ChunkSize ? requiredSize : arena->ChunkSize);
+            memory = (arena->Cursor + alignment - 1) & ~(alignment - 1);
+        }
+
+        arena->Cursor = memory + size;
+        return reinterpret_cast<void *>(memory);
+    }
+
+    void resetScratchArena(ScratchArena *arena)
+    {
+        ScratchChunk *chunk = reinterpret_cast<ScratchChunk *>(arena->Chunks);
+        if (chunk != nullptr && chunk->Next != nullptr)
+        {
+            size_t totalSize = arena->TotalSize;
+            freeScratchChunks(arena);
+            addScratchChunk(arena, totalSize);
+        }
+        else if (chunk != nullptr)
+        {
+            arena->Cursor = reinterpret_cast<uintptr_t>(chunk) + sizeof(ScratchChunk);
+        }
     }
 } // namespace IB
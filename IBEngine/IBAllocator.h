@@ -25,14 +25,121 @@ Ideally, these downsides will slowly fade in time as we iterate and improve on t
     - We want to make sure we have control of the performance of our allocations.
 - Prefer IBAllocator over new/delete in C++ editor code
     It could be elegant to be able to also gather statistics on our editor memory usage.
-- If you find you are making many short lived allocations (function scope/frame scope), consider if we want to add a scrap allocator.
-- If you find yourself using the standard library containers, consider using our custom allocator instead of the standard allocator.
+- If you find you are making many short lived allocations (function scope/frame scope), consider using a ScratchArena.
+- If you find yourself using the standard library containers, consider using our containers in IBContainers.h instead.
 */
 
 namespace IB
 {
-    IB_API void *memoryAllocate(size_t size, size_t alignment); // threadsafe
-    IB_API void memoryFree(void *memory); // threadsafe
+    // Tags attribute our memory to the system that owns it so that we can track every system's usage.
+    // Memory must be freed with the tag it was allocated with.
+    enum class MemoryTag : uint8_t
+    {
+        General = 0,
+        Renderer,
+        Assets,
+        Entities,
+        Jobs,
+        Tools,
+        Audio,
+        RendererDevice, // Device memory tracked by our renderer, see trackMemory
+        Count
+    };
+
+    IB_API void *memoryAllocate(size_t size, size_t alignment, MemoryTag tag = MemoryTag::General); // threadsafe
+    IB_API void memoryFree(void *memory, MemoryTag tag = MemoryTag::General); // threadsafe
+    // Grows or shrinks our block, in place if possible. Contents are preserved up to the smaller of the two sizes.
+    // A null memory pointer will simply allocate. Reallocations are checked against our budgets like memoryAllocate,
+    // if we're out of memory we return nullptr and our block is left untouched.
+    IB_API void *memoryReallocate(void *memory, size_t size, size_t alignment, MemoryTag tag = MemoryTag::General); // threadsafe
+
+    // Sizes are the size of the blocks handed out by our allocator, not the requested sizes.
+    struct MemoryStats
+    {
+        uint64_t AllocatedBytes = 0;
+        uint64_t PeakAllocatedBytes = 0;
+        uint64_t AllocationCount = 0; // Live allocations
+    };
+
+    IB_API MemoryStats memoryStats(MemoryTag tag); // threadsafe
+    IB_API char const *memoryTagName(MemoryTag tag);
+
+    // Budgets let a system know when it's using more memory than we've given it.
+    // Crossing our soft limit asks our pressure callbacks to release memory, the asset system can evict and the streamer can throttle.
+    // An allocation that would cross our hard limit asks our callbacks to release memory first,
+    // if we're still over budget, memoryAllocate warns and allocates anyway while tryMemoryAllocate returns nullptr.
+    // Allocations are checked and charged by the size of the block they're handed, their size rounded up to their alignment or pages.
+    struct MemoryBudget
+    {
+        uint64_t SoftLimit = 0; // 0 is unlimited
+        uint64_t HardLimit = 0; // 0 is unlimited
+    };
+
+    enum class MemoryPressure
+    {
+        Soft,
+        Hard
+    };
+
+    // Called from the allocating thread, requestedBytes is the size of the allocation that put us under pressure.
+    // Callbacks can free memory with their tag, allocations with their tag won't notify them again until they return.
+    using MemoryPressureCallback = void(void *data, MemoryTag tag, MemoryPressure pressure, uint64_t requestedBytes);
+    constexpr uint32_t MaxMemoryPressureCallbacks = 8; // Per tag
+
+    IB_API void setMemoryBudget(MemoryTag tag, MemoryBudget budget); // threadsafe
+    IB_API MemoryBudget memoryBudget(MemoryTag tag); // threadsafe
+    IB_API void registerMemoryPressureCallback(MemoryTag tag, MemoryPressureCallback *callback, void *data); // threadsafe
+    IB_API void unregisterMemoryPressureCallback(MemoryTag tag, MemoryPressureCallback *callback, void *data); // threadsafe
+
+    // Returns nullptr instead of going over our hard budget or if we're out of memory.
+    IB_API void *tryMemoryAllocate(size_t size, size_t alignment, MemoryTag tag = MemoryTag::General); // threadsafe
+
+    // Tracks memory that we didn't allocate, such as device memory, so that it counts towards our stats and budgets.
+    // Returns false if our memory puts us over our hard budget, our memory is tracked either way.
+    IB_API bool trackMemory(MemoryTag tag, size_t size); // threadsafe
+    IB_API void untrackMemory(MemoryTag tag, size_t size); // threadsafe
+
+    struct AllocatorPolicy
+    {
+        // Freed large blocks are kept around to be reused by allocations of a similar size.
+        size_t LargeBlockCacheBudget = 256 * 1024 * 1024;
+        uint32_t LargeBlockCacheCount = 16;
+        // Large blocks at least this large will try to use large pages. 0 disables large pages.
+        size_t LargePageThreshold = 0;
+        // Empty pages that stay committed when freed, they're only decommitted once we trim.
+        uint32_t RetainedSlabPageCount = 16; // Per size class
+        size_t RetainedBuddyMemory = 1024 * 1024; // Per buddy chunk
+        // Trims the memory we retain past our budgets from a background thread at this interval. 0 disables our trim thread.
+        uint32_t TrimIntervalMilliseconds = 0;
+    };
+
+    // Not threadsafe, set your policy before you start allocating.
+    IB_API void setAllocatorPolicy(AllocatorPolicy policy);
+    IB_API AllocatorPolicy allocatorPolicy();
+    // Returns our cached and retained memory to the operating system.
+    IB_API void trimMemory(); // threadsafe
+
+    // Allocation traces record our allocations and frees so that they can be replayed by our AllocatorBenchmark.
+    // A trace file is simply an array of events.
+    struct AllocationTraceEvent
+    {
+        uint64_t Memory = 0;
+        uint64_t PreviousMemory = 0; // Only used by reallocations
+        uint64_t Size = 0;
+        uint32_t Alignment = 0;
+        enum : uint32_t
+        {
+            Allocate,
+            Free,
+            Reallocate
+        };
+        uint32_t Type = Allocate;
+    };
+
+    // Starts recording our allocations, we stop recording once we've recorded maxEventCount events.
+    IB_API void beginAllocationTrace(uint32_t maxEventCount);
+    // Stops recording and writes our events to filepath. Not threadsafe with beginAllocationTrace.
+    IB_API void endAllocationTrace(char const *filepath);
 
     template <typename T, typename... TArgs>
     T *allocate(TArgs &&... args)
@@ -78,11 +185,18 @@ namespace IB
 
     struct BlockPool
     {
-        void *Memory = nullptr;
+        void *Memory = nullptr; // All of our pages
+        void *FreePages = nullptr; // Our pages that have free slots
         size_t BlockSize = 0;
+        size_t BlockAlignment = 0;
+        uint32_t SlotCount = 0; // Slots per page
+        uint32_t BlocksOffset = 0; // Offset of our first block in our pages
+        uint32_t EmptyPageCount = 0;
+        uint32_t Locked = 0;
+        MemoryTag Tag = MemoryTag::General; // Our pages are allocated with our tag
     };
 
-    IB_API BlockPool createBlockPool(size_t blockSize, size_t blockAlignment);
+    IB_API BlockPool createBlockPool(size_t blockSize, size_t blockAlignment, MemoryTag tag = MemoryTag::General);
     IB_API void destroyBlockPool(BlockPool *pool);
     IB_API void *memoryAllocate(BlockPool *pool); // threadsafe
     IB_API void memoryFree(BlockPool *pool, void *blockMemory); // threadsafe
@@ -115,4 +229,23 @@ namespace IB
 
         BlockPool Pool = createBlockPool(sizeof(T), alignof(T));
     };
+
+    // Scratch arenas hand out short lived allocations by bumping a pointer through chunks from our allocator.
+    // Allocations are never freed individually, reset the arena once you're done with all of them.
+    struct ScratchArena
+    {
+        void *Chunks = nullptr; // Our current chunk is first
+        uintptr_t Cursor = 0;
+        uintptr_t End = 0;
+        size_t ChunkSize = 0;
+        size_t TotalSize = 0; // Size of all of our chunks
+        MemoryTag Tag = MemoryTag::General; // Our chunks are allocated with our tag
+    };
+
+    IB_API ScratchArena createScratchArena(size_t chunkSize = 64 * 1024, MemoryTag tag = MemoryTag::General);
+    IB_API void destroyScratchArena(ScratchArena *arena);
+    IB_API void *memoryAllocate(ScratchArena *arena, size_t size, size_t alignment); // Not threadsafe
+    // Releases all of our allocations.
+    // If we needed more than one chunk, they're merged into a single chunk so that our next use fits in one.
+    IB_API void resetScratchArena(ScratchArena *arena); // Not threadsafe
 } // namespace IB
@@ -1,14 +1,24 @@
 #define _CRT_SECURE_NO_WARNINGS
 #include "IBAsset.h"
 #include "IBAllocator.h"
+#include "IBCompression.h"
+#include "IBContainers.h"
 #include "IBLogging.h"
 
 #include <string.h>
+#include <algorithm>
 
 namespace
 {
     constexpr char AssetPath[] = "../Assets/Compiled";
 
+    // Our tables and queues are tracked under our Assets tag.
+    using AssetAllocator = IB::TaggedAllocator<IB::MemoryTag::Assets>;
+    template <typename T>
+    using AssetArray = IB::DynamicArray<T, AssetAllocator>;
+    template <typename TKey, typename TValue, typename THash = IB::Hash<TKey>>
+    using AssetMap = IB::HashMap<TKey, TValue, THash, AssetAllocator>;
+
     char const *fileExtension(char const *filepath)
     {
         uint32_t filepathLength = static_cast<uint32_t>(strlen(filepath));
@@ -29,26 +39,23 @@ namespace
         return filepath + extensionIndex;
     }
 
-    // http://www.cse.yorku.ca/~oz/hash.html by Dan Bernstein
-    uint32_t hash(char const *path)
-    {
-        uint32_t hash = 5381;
-        for (; *path != 0; path++)
-        {
-            hash = hash * 33 + *path;
-        }
+    constexpr uint32_t MaxStreamerCount = 100;
+    IB::Asset::IStreamer *Streamers[MaxStreamerCount] = {}; // By StreamerIndex
+    uint32_t StreamerFlags[MaxStreamerCount] = {}; // Our StreamerOptions, by StreamerIndex
+    uint32_t StreamerCount = 0;
 
-        return hash;
-    }
+    // Maps our FourCCs to their StreamerIndex.
+    // Open addressed and kept at most half full, our lookups rarely probe past their first slot.
+    constexpr uint32_t StreamerTableBits = 8;
+    constexpr uint32_t StreamerTableSize = 1 << StreamerTableBits;
+    static_assert(MaxStreamerCount * 2 <= StreamerTableSize, "Our streamer table should stay at most half full.");
 
-    struct StreamerData
+    struct StreamerSlot
     {
-        IB::Asset::IStreamer *Streamer = nullptr;
         IB::Asset::FourCC Type = {0};
+        IB::Asset::StreamerIndex Streamer = {};
     };
-
-    constexpr uint32_t MaxStreamerCount = 100;
-    StreamerData Streamers[MaxStreamerCount];
+    StreamerSlot StreamerTable[StreamerTableSize];
 
     struct LoadResult
     {
@@ -60,346 +67,2640 @@ namespace
     struct Resource
     {
         IB::Asset::FourCC Type = {};
-        uint32_t PathHash = 0;
+        IB::Asset::StreamerIndex Streamer = {};
+        IB::StringId Path = {}; // Our path's string lives in our intern table
         IB::JobHandle LoadingJob = {};
+        IB::JobHandle LastRequestJob = {}; // Requests made while we're loading wait on each other, see chainLoadRequest
         IB::Asset::AssetHandle Asset = {};
-        IB::File File = {};
-        char Path[MaxPathSize] = {};
+        IB::File File = {}; // Only open while we're reading our loose file
+        void *Buffer = nullptr; // Our streamers can reference our data until we unload
+        size_t Size = 0; // Bytes our resource keeps loaded, counted against our cache's budget
+        uint32_t Published = 0; // Set once our resource's fields are ready to be read by other threads
+        uint32_t PublishWaiters = 0; // Threads parked until our resource is published
+        uint32_t ReadFailed = 0; // Our data couldn't be read, our load completes without an asset
+        uint32_t PendingIndex = UINT32_MAX; // Our load's slot in our streaming queue's heap while it's queued, guarded by our streaming lock
+
+        // Our resource is in our cache while it's loaded but no longer referenced.
+        Resource *CachePrev = nullptr;
+        Resource *CacheNext = nullptr;
+
+        // Or in our release queue, waiting to be unloaded. Guarded by our resource's shard.
+        Resource *ReleasePrev = nullptr;
+        Resource *ReleaseNext = nullptr;
+        uint64_t ReleaseFrame = 0; // Our release queue's frame when we were queued
+        uint32_t Queued = 0;
     };
 
     struct ResourceEntry
     {
-        uint32_t RefCount;
-        Resource *Resource;
+        uint32_t RefCount = 0;
+        Resource *Resource = nullptr;
+    };
+
+    struct StringIdHash
+    {
+        uint64_t operator()(IB::StringId id) const
+        {
+            return IB::Hash<uint64_t>{}(id.Value);
+        }
+    };
+
+    // Our resource table is split into shards that each have their own lock,
+    // loads and releases of different resources rarely contend.
+    // Entries are keyed by our full path id, ids are verified against their path when they're interned
+    // so two paths can never share an entry.
+    struct alignas(64) ResourceShard
+    {
+        AssetMap<IB::StringId, ResourceEntry, StringIdHash> Entries;
+        uint32_t Locked = 0;
     };
 
-    constexpr uint32_t MaxTableEntries = 1024 * 1024;
-    ResourceEntry ResourceHashTable[MaxTableEntries];
+    constexpr uint32_t ResourceShardBits = 6;
+    constexpr uint32_t ResourceShardCount = 1 << ResourceShardBits;
+    ResourceShard ResourceShards[ResourceShardCount];
+
+    // Entries with a reference count of 0 stay in our table while their resource is in our cache.
+    // Our list runs from our most recently released resource to our least recently released resource.
+    // Always lock our resource's shard before our cache.
+    struct ResourceCache
+    {
+        Resource *Head = nullptr;
+        Resource *Tail = nullptr;
+        uint64_t Size = 0;
+        uint64_t Budget = 0;
+        uint32_t Locked = 0;
+    };
+    ResourceCache Cache;
 
-    IB::Asset::IStreamer *getStreamer(IB::Asset::FourCC type)
+    void lockResourceCache()
     {
-        for (uint32_t i = 0; i < MaxStreamerCount; i++)
+        while (IB::atomicCompareExchange(&Cache.Locked, 0, 1) != 0)
         {
-            if (Streamers[i].Type.Value == type.Value)
-            {
-                return Streamers[i].Streamer;
-            }
         }
+        IB::threadAcquire();
+    }
 
-        return nullptr;
+    void unlockResourceCache()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&Cache.Locked, 0);
     }
 
-    LoadResult load(IB::Asset::IStreamer *streamer, IB::Asset::LoadContext *context)
+    // Our cache must be locked.
+    void cacheResource(Resource *resource)
     {
-        IB::Asset::LoadContinuation result = streamer->loadAsync(context);
-        if (result.Continuation == IB::Asset::LoadContinuation::Advance)
+        resource->CachePrev = nullptr;
+        resource->CacheNext = Cache.Head;
+        if (Cache.Head != nullptr)
         {
-            IB::volatileStore(&context->State, result.Data.Advance.NextState);
-            IB::threadStoreStoreFence(); // Make sure our state value write is visible before our job is written to the job pool.
-
-            IB_ASSERT(result.Data.Advance.DependencyCount > 0, "If we want to advance, we need dependencies.");
-            // Resignal our job once our dependencies are complete.
-            IB::continueJob(context->Handle, result.Data.Advance.Dependencies, result.Data.Advance.DependencyCount); // Job could be signaled before we return
-            return {IB::JobResult::Sleep};
+            Cache.Head->CachePrev = resource;
         }
         else
         {
-            return LoadResult{IB::JobResult::Complete, result.Data.Complete.Handle};
+            Cache.Tail = resource;
         }
+        Cache.Head = resource;
+        Cache.Size += resource->Size;
     }
 
-    IB::JobHandle loadBinaryAsync(Resource *resource, IB::Asset::FourCC type, IB::Asset::OnResourceLoad *onResourceLoad, void *data)
+    // Our cache must be locked.
+    void uncacheResource(Resource *resource)
     {
-        IB::Asset::IStreamer *streamer = getStreamer(type);
-        IB_ASSERT(streamer != nullptr, "Failed to find streamer!");
+        if (resource->CachePrev != nullptr)
+        {
+            resource->CachePrev->CacheNext = resource->CacheNext;
+        }
+        else
+        {
+            Cache.Head = resource->CacheNext;
+        }
 
-        IB::Asset::LoadContext *loadContext = IB::allocate<IB::Asset::LoadContext>();
-        IB::JobHandle fileJob = IB::launchJob([resource, loadContext]() {
-            char fullPath[MaxPathSize] = {};
-            sprintf(fullPath, "%s/%s", AssetPath, resource->Path);
+        if (resource->CacheNext != nullptr)
+        {
+            resource->CacheNext->CachePrev = resource->CachePrev;
+        }
+        else
+        {
+            Cache.Tail = resource->CachePrev;
+        }
 
-            resource->File = IB::openFile(fullPath, IB::OpenFileOptions::Read);
-            loadContext->Stream = {reinterpret_cast<uint8_t *>(IB::mapFile(resource->File))};
-            IB_ASSERT(loadContext->Stream.Memory != nullptr, "Failed to map file!");
-            return IB::JobResult::Complete;
-        });
+        resource->CachePrev = nullptr;
+        resource->CacheNext = nullptr;
+        Cache.Size -= resource->Size;
+    }
 
-        loadContext->Handle = IB::reserveJob([loadContext, streamer, onResourceLoad, data, resource]() {
-            LoadResult loadResult = load(streamer, loadContext);
-            if (loadResult.Result == IB::JobResult::Complete)
-            {
-                resource->Asset = loadResult.Asset;
+    // Our release queue holds our unreferenced resources until processReleaseQueue unloads them.
+    // Entries with a reference count of 0 stay in our table while their resource is queued, requesting them again cancels their unload.
+    // Our list runs from our most recently released resource to our least recently released resource.
+    // Always lock our resource's shard before our release queue, never lock our cache and our release queue together.
+    struct ReleaseQueue
+    {
+        Resource *Head = nullptr;
+        Resource *Tail = nullptr;
+        uint32_t Count = 0;
+        uint32_t GracePeriod = 0; // How many of our passes our released resources survive before they're unloaded
+        uint64_t Frame = 0; // How many passes we've processed
+        uint32_t Deferred = 0;
+        uint32_t Locked = 0;
+    };
+    ReleaseQueue Releases;
 
-                onResourceLoad(data, IB::Asset::ResourceHandle{resource->PathHash});
-                IB::deallocate(loadContext);
-            }
-            return loadResult.Result;
-        });
-        continueJob(loadContext->Handle, &fileJob, 1);
+    void lockReleaseQueue()
+    {
+        while (IB::atomicCompareExchange(&Releases.Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+    }
 
-        return loadContext->Handle;
+    void unlockReleaseQueue()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&Releases.Locked, 0);
     }
 
-} // namespace
+    // Our resource's shard and our release queue must be locked.
+    void queueRelease(Resource *resource)
+    {
+        resource->ReleasePrev = nullptr;
+        resource->ReleaseNext = Releases.Head;
+        if (Releases.Head != nullptr)
+        {
+            Releases.Head->ReleasePrev = resource;
+        }
+        else
+        {
+            Releases.Tail = resource;
+        }
+        Releases.Head = resource;
+        Releases.Count++;
+        resource->ReleaseFrame = Releases.Frame;
+        resource->Queued = 1;
+    }
 
-namespace IB
-{
-    namespace Asset
+    // Our resource's shard and our release queue must be locked.
+    void unqueueRelease(Resource *resource)
     {
-        LoadContinuation wait(JobHandle *dependencies, uint32_t dependencyCount, uint32_t nextState)
+        if (resource->ReleasePrev != nullptr)
         {
-            LoadContinuation result = {};
-            memcpy(result.Data.Advance.Dependencies, dependencies, sizeof(JobHandle) * dependencyCount);
-            result.Data.Advance.DependencyCount = dependencyCount;
-            result.Data.Advance.NextState = nextState;
-            result.Continuation = LoadContinuation::Advance;
-            return result;
+            resource->ReleasePrev->ReleaseNext = resource->ReleaseNext;
+        }
+        else
+        {
+            Releases.Head = resource->ReleaseNext;
         }
 
-        LoadContinuation complete(AssetHandle handle)
+        if (resource->ReleaseNext != nullptr)
         {
-            LoadContinuation result = {};
-            result.Data.Complete.Handle = handle;
-            result.Continuation = LoadContinuation::Complete;
-            return result;
+            resource->ReleaseNext->ReleasePrev = resource->ReleasePrev;
+        }
+        else
+        {
+            Releases.Tail = resource->ReleasePrev;
         }
 
-        void addStreamer(FourCC type, IStreamer *streamer)
+        resource->ReleasePrev = nullptr;
+        resource->ReleaseNext = nullptr;
+        Releases.Count--;
+        resource->Queued = 0;
+    }
+
+    // Takes our unreferenced resource out of our cache or our release queue, our resource's shard must be locked.
+    void unlinkResource(Resource *resource)
+    {
+        if (resource->Queued != 0)
         {
-            for (uint32_t i = 0; i < MaxStreamerCount; i++)
-            {
-                if (Streamers[i].Type.Value == 0)
-                {
-                    Streamers[i].Type = type;
-                    Streamers[i].Streamer = streamer;
-                    break;
-                }
-            }
+            lockReleaseQueue();
+            unqueueRelease(resource);
+            unlockReleaseQueue();
         }
+        else
+        {
+            lockResourceCache();
+            uncacheResource(resource);
+            unlockResourceCache();
+        }
+    }
 
-        ResourceHandle createResourceThreadSafe(char const *assetPath, FourCC type, AssetHandle asset)
+    ResourceShard *lockResourceShard(IB::StringId path)
+    {
+        // Our hash maps use the low bits of their hash, pick our shard with the high bits of our id.
+        ResourceShard *shard = &ResourceShards[path.Value >> (64 - ResourceShardBits)];
+        while (IB::atomicCompareExchange(&shard->Locked, 0, 1) != 0)
         {
-            uint32_t pathHash = hash(assetPath);
-            uint32_t hashTableIndex = pathHash % MaxTableEntries;
+        }
+        IB::threadAcquire();
+        return shard;
+    }
 
-            bool newAssetEntry = atomicIncrement(&ResourceHashTable[hashTableIndex].RefCount) == 1;
-            IB_ASSERT(newAssetEntry, "createResource should only be called on an asset that does not exist!");
+    void unlockResourceShard(ResourceShard *shard)
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&shard->Locked, 0);
+    }
 
-            Resource *resource = allocate<Resource>();
-            resource->PathHash = hash(assetPath);
-            resource->Type = type;
-            resource->Asset = asset;
+    // Adds references to our resource, creates it if it isn't in our table.
+    // Returns true if we created our resource, we then have to publish it once we've filled it.
+    bool acquireResource(IB::StringId path, Resource **resource, uint32_t refCount = 1)
+    {
+        ResourceShard *shard = lockResourceShard(path);
+        ResourceEntry &entry = shard->Entries.findOrAdd(path);
+        bool created = entry.Resource == nullptr;
+        if (created)
+        {
+            entry.Resource = IB::allocate<Resource>();
+            entry.Resource->Path = path;
+        }
+        else if (entry.RefCount == 0)
+        {
+            // We're picking our resource back up from our cache or cancelling its unload.
+            unlinkResource(entry.Resource);
+        }
+        entry.RefCount += refCount;
+        *resource = entry.Resource;
+        unlockResourceShard(shard);
 
-            IB_ASSERT(strlen(assetPath) < MaxPathSize - 1, "Path is too long!");
-            strcpy(resource->Path, assetPath);
+        return created;
+    }
 
-            // Assure that the writes to our resource are visible
-            // before we write our resource to the table
-            threadRelease();
-            volatileStore(&ResourceHashTable[hashTableIndex].Resource, resource);
+    // Adds a reference to a resource that's already in our table, returns nullptr if it isn't.
+    Resource *retainResource(IB::StringId path)
+    {
+        ResourceShard *shard = lockResourceShard(path);
+        ResourceEntry *entry = shard->Entries.find(path);
+        Resource *resource = nullptr;
+        if (entry != nullptr)
+        {
+            if (entry->RefCount == 0)
+            {
+                unlinkResource(entry->Resource);
+            }
 
-            return ResourceHandle{pathHash};
+            entry->RefCount++;
+            resource = entry->Resource;
         }
+        unlockResourceShard(shard);
 
-        JobHandle loadSubAssetAsync(Serialization::MemoryStream stream, FourCC type, AssetHandle parentAsset, OnSubAssetLoad *onSubAssetLoad, void *data)
+        return resource;
+    }
+
+    // Removes a reference to our resource.
+    // Returns our resource once we've removed its last reference and it didn't go to our cache or our release queue, it's no longer in our table and we own it.
+    Resource *releaseResource(IB::StringId path)
+    {
+        ResourceShard *shard = lockResourceShard(path);
+        ResourceEntry *entry = shard->Entries.find(path);
+        IB_ASSERT(entry != nullptr && entry->RefCount > 0, "Releasing a resource that isn't loaded!");
+
+        Resource *released = nullptr;
+        entry->RefCount--;
+        if (entry->RefCount == 0)
         {
-            LoadContext *context = allocate<LoadContext>(stream, parentAsset);
-            IB::Asset::IStreamer *streamer = getStreamer(type);
-            if (streamer != nullptr)
+            // Only loaded resources go to our cache, our loading resources are unloaded once they're done.
+            Resource *resource = entry->Resource;
+            bool loaded = IB::volatileLoad(&resource->Published) != 0 && IB::volatileLoad(&resource->Asset.Value) != IB::Asset::InvalidAsset.Value;
+
+            lockResourceCache(); // Our lock's acquire keeps our size read below our loaded check.
+            bool cached = loaded && Cache.Budget > 0;
+            if (cached)
             {
-                context->Handle = reserveJob([context, streamer, onSubAssetLoad, data]() {
-                    LoadResult loadResult = load(streamer, context);
-                    if (loadResult.Result == JobResult::Complete)
-                    {
-                        onSubAssetLoad(data, loadResult.Asset);
-                        deallocate(context);
-                    }
-                    return loadResult.Result;
-                });
-                launchJob(context->Handle);
+                cacheResource(resource);
+            }
+            unlockResourceCache();
+
+            if (!cached && loaded && IB::volatileLoad(&Releases.Deferred) != 0)
+            {
+                // Our entry stays in our table until processReleaseQueue unloads our resource.
+                lockReleaseQueue();
+                queueRelease(resource);
+                unlockReleaseQueue();
+            }
+            else if (!cached)
+            {
+                released = resource;
+                shard->Entries.remove(path);
             }
-            return context->Handle;
         }
+        unlockResourceShard(shard);
+
+        return released;
+    }
 
-        JobHandle loadResourceAsync(char const *assetPath, FourCC type, OnResourceLoad *onResourceLoad, void *data)
+    // Removes our resource from our table if it's sitting unreferenced in our cache or our release queue.
+    // Returns our resource if we've evicted it, we own it and have to unload it.
+    Resource *evictResource(IB::StringId path)
+    {
+        ResourceShard *shard = lockResourceShard(path);
+        ResourceEntry *entry = shard->Entries.find(path);
+        Resource *evicted = nullptr;
+        if (entry != nullptr && entry->RefCount == 0)
         {
-            uint32_t pathHash = hash(assetPath);
-            uint32_t hashTableIndex = pathHash % MaxTableEntries;
+            evicted = entry->Resource;
+            unlinkResource(evicted);
+            shard->Entries.remove(path);
+        }
+        unlockResourceShard(shard);
 
-            bool newAssetEntry = atomicIncrement(&ResourceHashTable[hashTableIndex].RefCount) == 1; // Assure that we keep a ref count for this entry to assure that no one unloads the asset from under us.
-            // Assure that we don't load our asset pointer before we've guaranteed our ref count
-            threadAcquire();
+        return evicted;
+    }
 
-            JobHandle requestHandle = {};
-            if (!newAssetEntry)
-            {
-                // We could be asking for our asset to be loaded twice before our first load is complete.
-                // Simply wait for it to be complete.
-                while (volatileLoad(&ResourceHashTable[hashTableIndex].Resource) == nullptr)
-                {
-                }
-                // Assure we don't move our resource reads/writes above this point.
-                // Our reads are dependent on the volatileLoad above however, perhaps we can avoid the acquire due to a data dependency?
-                threadAcquire();
+    // Moves our resource from our cache to our release queue if it's still sitting unreferenced in our cache.
+    void queueEvictedResource(IB::StringId path)
+    {
+        ResourceShard *shard = lockResourceShard(path);
+        ResourceEntry *entry = shard->Entries.find(path);
+        if (entry != nullptr && entry->RefCount == 0 && entry->Resource->Queued == 0)
+        {
+            lockResourceCache();
+            uncacheResource(entry->Resource);
+            unlockResourceCache();
 
-                Resource *resource = volatileLoad(&ResourceHashTable[hashTableIndex].Resource);
+            lockReleaseQueue();
+            queueRelease(entry->Resource);
+            unlockReleaseQueue();
+        }
+        unlockResourceShard(shard);
+    }
 
-                // If our data loads are reordered above the branch,
-                // and our loaded asset data has not been written yet
-                // We'll simply wait until the loading job is visible
-                // and submit a "continue" job to be run after our loading job
+    // Doesn't add a reference, our caller must already hold one.
+    Resource *findResource(IB::StringId path)
+    {
+        ResourceShard *shard = lockResourceShard(path);
+        ResourceEntry *entry = shard->Entries.find(path);
+        Resource *resource = entry != nullptr ? entry->Resource : nullptr;
+        unlockResourceShard(shard);
 
-                if (resource->Asset.Value != InvalidAsset.Value)
-                {
-                    onResourceLoad(data, ResourceHandle{pathHash});
-                }
-                else
-                {
-                    requestHandle = continueJob([resource, onResourceLoad, data, pathHash]() {
-                        IB_ASSERT(resource->Asset.Value != InvalidAsset.Value, "No asset handle loaded!");
-                        onResourceLoad(data, ResourceHandle{pathHash});
-                        return JobResult::Complete;
-                    },
-                                                &resource->LoadingJob, 1);
-                }
-            }
-            else // New resource, request load
-            {
-                Resource *resource = allocate<Resource>();
-                resource->PathHash = pathHash;
-                resource->Type = type;
+        return resource;
+    }
 
-                IB_ASSERT(strlen(assetPath) < MaxPathSize - 1, "Path is too long!");
-                strcpy(resource->Path, assetPath);
+    void publishResource(Resource *resource)
+    {
+        // Assure that the writes to our resource are visible before we publish it.
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&resource->Published, 1);
 
-                requestHandle = loadBinaryAsync(resource, type, onResourceLoad, data);
-                resource->LoadingJob = requestHandle;
+        // Our waiters register themselves before checking our flag, one of us always sees the other.
+        IB::threadStoreLoadFence();
+        if (IB::volatileLoad(&resource->PublishWaiters) > 0)
+        {
+            IB::wakeOnAddress(&resource->Published);
+        }
+    }
+
+    // Our resources are published right after they're added to our table, we rarely wait more than a few iterations.
+    constexpr uint32_t PublishSpinCount = 256;
+    void waitOnResource(Resource *resource)
+    {
+        // We could be asking for our resource before its creator has finished filling it.
+        for (uint32_t i = 0; i < PublishSpinCount && IB::volatileLoad(&resource->Published) == 0; i++)
+        {
+        }
 
-                // Assure that the writes to our resource are visible
-                // before we write our resource to the table
-                threadRelease();
-                volatileStore(&ResourceHashTable[hashTableIndex].Resource, resource);
+        // Our creator was likely preempted, park until it publishes our resource instead of burning our core.
+        if (IB::volatileLoad(&resource->Published) == 0)
+        {
+            IB::atomicIncrement(&resource->PublishWaiters);
+            while (IB::volatileLoad(&resource->Published) == 0)
+            {
+                IB::waitOnAddress(&resource->Published, 0);
             }
+            IB::atomicDecrement(&resource->PublishWaiters);
+        }
 
-            return requestHandle;
+        // Assure we don't move our resource reads above this point.
+        IB::threadAcquire();
+    }
+
+    // Our jobs only have room for a handful of waiters, a popular resource can be requested far more often while it loads.
+    // Every request waits on the request before it instead, the first one waits on our load.
+    IB::JobHandle chainLoadRequest(IB::JobHandle *lastRequestJob, IB::JobHandle requestJob)
+    {
+        uint64_t previous = IB::volatileLoad(&lastRequestJob->Value);
+        while (true)
+        {
+            uint64_t current = IB::atomicCompareExchange(&lastRequestJob->Value, previous, requestJob.Value);
+            if (current == previous)
+            {
+                break;
+            }
+            previous = current;
         }
 
-        JobHandle releaseResourceAsync(ResourceHandle resourceHandle)
+        IB::JobHandle previousJob = {previous};
+        IB::continueJob(requestJob, &previousJob, 1);
+        return requestJob;
+    }
+
+    // Our archives stay open while they're mounted, assets are read from them without opening a file of their own.
+    struct MountedArchive
+    {
+        IB::File File = {};
+        IB::Asset::ArchiveEntry *Entries = nullptr;
+        uint32_t EntryCount = 0;
+    };
+
+    constexpr size_t AssetBufferAlignment = 16;
+
+    constexpr uint32_t MaxMountedArchives = 16;
+    MountedArchive MountedArchives[MaxMountedArchives];
+    uint32_t MountedArchiveCount = 0;
+
+    // Returns nullptr if our asset isn't in any of our archives.
+    IB::Asset::ArchiveEntry const *findArchivedAsset(IB::StringId path, IB::File *archiveFile)
+    {
+        // Our latest archives override our earlier archives.
+        for (uint32_t archiveIndex = MountedArchiveCount; archiveIndex > 0; archiveIndex--)
         {
-            uint32_t mappingIndex = resourceHandle.Hash % MaxTableEntries;
-            // We could be asking to release our resource before our resource has been assigned to the resource table.
-            while (volatileLoad(&ResourceHashTable[mappingIndex].Resource) == nullptr)
-            {
-            }
-            // Assure we don't move our resource reads/writes past this point.
-            // Our reads are dependent on the volatileLoad above however, perhaps we can avoid the acquire due to a data dependency?
-            threadAcquire();
-
-            // Load and copy our data before we do our decrement.
-            Resource *resource = volatileLoad(&ResourceHashTable[mappingIndex].Resource);
-
-            // Make sure our asset pointer load is completed before our ref count store is complete
-            // If it isn't, we can potentially load someone else's data
-            // Example:
-            // Thread 1: Decrement ref count, 0
-            // Thread 2: Increment ref count, 1
-            // Thread 2: Allocate data and add to table
-            // Thread 1: Load asset from table (Oops! This is now Thread 2's data!)
-            //
-            // Instead, we want:
-            // Thread 1: Load asset from table (guaranteed our data)
-            // Thread 1: Decrement ref count, 0
-            // Thread 2: Increment ref count, 1
-            // Thread 2: Allocate data and add to table
-            threadLoadStoreFence();
+            MountedArchive const &archive = MountedArchives[archiveIndex - 1];
 
-            JobHandle job = {};
-            if (atomicDecrement(&ResourceHashTable[mappingIndex].RefCount) == 0)
-            {
-                auto onUnload = [resource]() {
-                    getStreamer(resource->Type)->unloadThreadSafe(resource->Asset);
-                    unmapFile(resource->File);
-                    closeFile(resource->File);
-                    deallocate(resource);
-                    return JobResult::Complete;
-                };
-
-                // At this point, we own the loaded asset. We're free to do what we want with it's data
-                if (volatileLoad(&resource->Asset.Value) == InvalidAsset.Value) // Not loaded yet
+            // Binary search our sorted table of contents
+            uint32_t first = 0;
+            uint32_t last = archive.EntryCount;
+            while (first < last)
+            {
+                uint32_t middle = first + (last - first) / 2;
+                if (archive.Entries[middle].Path.Value < path.Value)
                 {
-                    job = continueJob(onUnload, &resource->LoadingJob, 1);
+                    first = middle + 1;
                 }
                 else
                 {
-                    job = launchJob(onUnload);
+                    last = middle;
                 }
             }
 
-            return job;
+            if (first < archive.EntryCount && archive.Entries[first].Path == path)
+            {
+                *archiveFile = archive.File;
+                return &archive.Entries[first];
+            }
         }
 
-        void unloadSubAssetThreadSafe(AssetHandle asset, FourCC type)
+        return nullptr;
+    }
+
+    void *allocateArchivedAssetBuffer(IB::Asset::ArchiveEntry const *archivedAsset)
+    {
+        size_t alignment = archivedAsset->Alignment > AssetBufferAlignment ? archivedAsset->Alignment : AssetBufferAlignment;
+        return IB::memoryAllocate(archivedAsset->Size > 0 ? static_cast<size_t>(archivedAsset->Size) : 1, alignment, IB::MemoryTag::Assets);
+    }
+
+    struct LoadTracer
+    {
+        AssetArray<IB::Asset::LoadTraceEntry> Entries;
+        uint64_t StartTime = 0;
+        uint32_t Recording = 0;
+        uint32_t Locked = 0;
+    };
+    LoadTracer Tracer;
+
+    void lockTracer()
+    {
+        while (IB::atomicCompareExchange(&Tracer.Locked, 0, 1) != 0)
         {
-            getStreamer(type)->unloadThreadSafe(asset);
         }
+        IB::threadAcquire();
+    }
 
-        JobHandle saveResourceAsync(ResourceHandle resourceHandle)
+    void unlockTracer()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&Tracer.Locked, 0);
+    }
+
+    void traceLoad(IB::StringId path)
+    {
+        if (IB::volatileLoad(&Tracer.Recording) == 0)
         {
-            return launchJob([resourceHandle]() {
-                uint32_t hashTableIndex = resourceHandle.Hash % MaxTableEntries;
+            return;
+        }
 
-                atomicIncrement(&ResourceHashTable[hashTableIndex].RefCount); // Keep a reference count as we save, we don't want to dump our asset
+        uint64_t now = IB::currentTimestamp();
+        lockTracer();
+        if (Tracer.Recording != 0)
+        {
+            uint64_t time = (now - Tracer.StartTime) * 1000000 / IB::timestampFrequency();
+            Tracer.Entries.add(IB::Asset::LoadTraceEntry{path, time});
+        }
+        unlockTracer();
+    }
 
-                IB_ASSERT(volatileLoad(&ResourceHashTable[hashTableIndex].Resource) != nullptr, "Asset should be in our table!");
-                Resource *resource = volatileLoad(&ResourceHashTable[hashTableIndex].Resource);
-                // Assure we don't move our resource reads/writes past this point.
-                // Our reads are dependent on the volatileLoad above however, perhaps we can avoid the acquire due to a data dependency?
-                threadAcquire();
+    // Our load profile times the stages of the loads that were requested while it was recording.
+    struct LoadStage
+    {
+        enum
+        {
+            Queue, // Waiting for a read slot in our streaming queue
+            Open, // Opening our loose file
+            Read,
+            Decompress,
+            Stream, // One state of our streamer's loadAsync
+            Wait, // Waiting on the dependencies of our streamer's advanced state, derived from the gaps between our states
+            Callback, // Our completion callback
+            Count
+        };
+    };
+    constexpr char const *LoadStageNames[LoadStage::Count] = {"Queue", "Open", "Read", "Decompress", "Stream", "Wait", "Callback"};
 
-                char fullPath[MaxPathSize] = {};
-                sprintf(fullPath, "%s/%s", AssetPath, resource->Path);
+    struct ProfiledLoad
+    {
+        IB::StringId Resource = {}; // The resource we're loaded as part of
+        IB::Asset::StreamerIndex Streamer = {};
+        bool SubAsset = false;
+    };
 
-                IB::File file = IB::openFile(fullPath, OpenFileOptions::Create | OpenFileOptions::Overwrite | OpenFileOptions::Write);
+    struct ProfiledStage
+    {
+        uint32_t Load = 0;
+        uint32_t Stage = 0;
+        uint32_t State = 0; // Our streamer's state, only used by our stream stages
+        uint64_t Start = 0; // In ticks of timestampFrequency
+        uint64_t End = 0;
+    };
 
-                Serialization::FileStream fileStream = {file};
-                SaveContext saveContext = {&fileStream, resource->Asset};
-                getStreamer(resource->Type)->saveThreadSafe(&saveContext);
-                flush(&fileStream);
+    // Our load ids keep counting across our profiles, the loads still in flight from a previous profile are ignored.
+    struct LoadProfiler
+    {
+        AssetArray<ProfiledLoad> Loads; // Our first load's id is FirstLoad
+        AssetArray<ProfiledStage> Stages;
+        uint64_t StartTime = 0;
+        uint32_t FirstLoad = 1;
+        uint32_t Recording = 0;
+        uint32_t Locked = 0;
+    };
+    LoadProfiler Profiler;
 
-                // Once we're done saving to our file, assure that we close our write access to it.
-                IB::closeFile(file);
+    void lockProfiler()
+    {
+        while (IB::atomicCompareExchange(&Profiler.Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+    }
 
-                releaseResourceAsync(resourceHandle); // Go through our release flow to assure that we do the appropriate cleanup if we're the last reference.
+    void unlockProfiler()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&Profiler.Locked, 0);
+    }
 
-                return JobResult::Complete;
-            });
+    // Returns our load's id, 0 if we aren't profiling.
+    uint32_t profileLoad(IB::StringId resource, IB::Asset::StreamerIndex streamer, bool subAsset)
+    {
+        if (IB::volatileLoad(&Profiler.Recording) == 0)
+        {
+            return 0;
         }
 
-        void saveSubAssetThreadSafe(Serialization::FileStream *stream, FourCC type, AssetHandle asset)
+        uint32_t load = 0;
+        lockProfiler();
+        if (Profiler.Recording != 0)
         {
-            SaveContext saveContext = {stream, asset};
-            getStreamer(type)->saveThreadSafe(&saveContext);
+            load = Profiler.FirstLoad + Profiler.Loads.count();
+            Profiler.Loads.add(ProfiledLoad{resource, streamer, subAsset});
+        }
+        unlockProfiler();
+        return load;
+    }
+
+    // Our stages are only timed if our load is profiled.
+    uint64_t profileTime(uint32_t load)
+    {
+        return load != 0 ? IB::currentTimestamp() : 0;
+    }
+
+    void profileStage(uint32_t load, uint32_t stage, uint64_t start, uint32_t state = 0)
+    {
+        if (load == 0)
+        {
+            return;
+        }
+
+        uint64_t end = IB::currentTimestamp();
+        lockProfiler();
+        if (Profiler.Recording != 0 && load >= Profiler.FirstLoad)
+        {
+            Profiler.Stages.add(ProfiledStage{load, stage, state, start, end});
+        }
+        unlockProfiler();
+    }
+
+    // Our streamers' waits are the gaps between their states, adds them to our stages sorted by load.
+    void addProfiledWaits(AssetArray<ProfiledStage> *stages)
+    {
+        std::sort(stages->begin(), stages->end(), [](ProfiledStage const &left, ProfiledStage const &right) {
+            return left.Load != right.Load ? left.Load < right.Load : left.Start < right.Start;
+        });
+
+        AssetArray<ProfiledStage> waits;
+        for (uint32_t i = 1; i < stages->count(); i++)
+        {
+            ProfiledStage const &previous = (*stages)[i - 1];
+            ProfiledStage const &next = (*stages)[i];
+            if (previous.Load == next.Load && previous.Stage == LoadStage::Stream && next.Stage == LoadStage::Stream && next.Start > previous.End)
+            {
+                waits.add(ProfiledStage{next.Load, LoadStage::Wait, next.State, previous.End, next.Start});
+            }
+        }
+
+        for (ProfiledStage const &wait : waits)
+        {
+            stages->add(wait);
+        }
+        std::sort(stages->begin(), stages->end(), [](ProfiledStage const &left, ProfiledStage const &right) {
+            return left.Load != right.Load ? left.Load < right.Load : left.Start < right.Start;
+        });
+    }
+
+    void fourCCText(IB::Asset::FourCC type, char (&text)[5])
+    {
+        memcpy(text, &type.Value, 4);
+        text[4] = '\0';
+    }
+
+    // Our profiled loads only know their streamer, our streamer table knows their type.
+    IB::Asset::FourCC streamerType(IB::Asset::StreamerIndex streamer)
+    {
+        for (StreamerSlot const &slot : StreamerTable)
+        {
+            if (slot.Type.Value != 0 && slot.Streamer.Value == streamer.Value)
+            {
+                return slot.Type;
+            }
+        }
+        return IB::Asset::FourCC{0};
+    }
+
+    void writeText(IB::Serialization::BufferStream *stream, char const *text)
+    {
+        IB::Serialization::toBinary(stream, text, strlen(text));
+    }
+
+    bool writeProfileFile(char const *path, IB::Serialization::BufferStream const &stream)
+    {
+        IB::File file = IB::openFile(path, IB::OpenFileOptions::Write | IB::OpenFileOptions::Overwrite);
+        if (file.Value == IB::InvalidFile.Value)
+        {
+            IB_LOG(IB::LogLevel::Error, "Asset", "Failed to open our load profile for writing.");
+            return false;
+        }
+
+        IB::appendToFile(file, stream.Memory, stream.Size);
+        IB::closeFile(file);
+        return true;
+    }
+
+    // Our timeline is a Chrome trace, every load is on its own row named after its type and resource.
+    bool writeLoadTimeline(char const *path, AssetArray<ProfiledLoad> const &loads, uint32_t firstLoad, AssetArray<ProfiledStage> const &stages, uint64_t startTime)
+    {
+        double microsecondsPerTick = 1000000.0 / static_cast<double>(IB::timestampFrequency());
+
+        IB::Serialization::BufferStream stream;
+        writeText(&stream, "{\"displayTimeUnit\":\"ms\",\"traceEvents\":[\n");
+
+        char line[MaxPathSize + 256];
+        bool first = true;
+        for (uint32_t i = 0; i < loads.count(); i++)
+        {
+            ProfiledLoad const &load = loads[i];
+            char type[5];
+            fourCCText(streamerType(load.Streamer), type);
+
+            // Our paths are interned asset paths, they don't have any characters that JSON would need us to escape.
+            char const *resourcePath = load.Resource != IB::InvalidStringId ? IB::stringFromId(load.Resource) : nullptr;
+            snprintf(line, sizeof(line), "%s{\"name\":\"thread_name\",\"ph\":\"M\",\"pid\":1,\"tid\":%u,\"args\":{\"name\":\"%s %s%s\"}}",
+                     first ? "" : ",\n", firstLoad + i, type, load.SubAsset ? "sub asset of " : "", resourcePath != nullptr ? resourcePath : "unknown resource");
+            writeText(&stream, line);
+            first = false;
+        }
+
+        for (ProfiledStage const &stage : stages)
+        {
+            char type[5];
+            fourCCText(streamerType(loads[stage.Load - firstLoad].Streamer), type);
+
+            double start = static_cast<double>(stage.Start - startTime) * microsecondsPerTick;
+            double duration = static_cast<double>(stage.End - stage.Start) * microsecondsPerTick;
+            snprintf(line, sizeof(line), "%s{\"name\":\"%s\",\"cat\":\"%s\",\"ph\":\"X\",\"pid\":1,\"tid\":%u,\"ts\":%.3f,\"dur\":%.3f,\"args\":{\"state\":%u}}",
+                     first ? "" : ",\n", LoadStageNames[stage.Stage], type, stage.Load, start, duration, stage.State);
+            writeText(&stream, line);
+            first = false;
+        }
+
+        writeText(&stream, "\n]}\n");
+        return writeProfileFile(path, stream);
+    }
+
+    // Our summary totals our stages per asset type, our load row spans each load from its first stage to its last.
+    bool writeLoadSummary(char const *path, AssetArray<ProfiledLoad> const &loads, uint32_t firstLoad, AssetArray<ProfiledStage> const &stages)
+    {
+        struct StageSummary
+        {
+            uint32_t Count = 0;
+            uint64_t Total = 0;
+            uint64_t Max = 0;
+        };
+
+        constexpr uint32_t LoadRow = LoadStage::Count;
+        constexpr uint32_t RowCount = LoadStage::Count + 1;
+        AssetArray<StageSummary> summaries;
+        summaries.resize(MaxStreamerCount * RowCount);
+
+        auto addTime = [&summaries](IB::Asset::StreamerIndex streamer, uint32_t row, uint64_t time) {
+            StageSummary &summary = summaries[streamer.Value * RowCount + row];
+            summary.Count++;
+            summary.Total += time;
+            summary.Max = time > summary.Max ? time : summary.Max;
+        };
+
+        // Our stages are sorted by load.
+        for (uint32_t i = 0; i < stages.count();)
+        {
+            uint32_t load = stages[i].Load;
+            IB::Asset::StreamerIndex streamer = loads[load - firstLoad].Streamer;
+            uint64_t loadStart = stages[i].Start;
+            uint64_t loadEnd = stages[i].End;
+            for (; i < stages.count() && stages[i].Load == load; i++)
+            {
+                addTime(streamer, stages[i].Stage, stages[i].End - stages[i].Start);
+                loadEnd = stages[i].End > loadEnd ? stages[i].End : loadEnd;
+            }
+            addTime(streamer, LoadRow, loadEnd - loadStart);
+        }
+
+        double millisecondsPerTick = 1000.0 / static_cast<double>(IB::timestampFrequency());
+
+        IB::Serialization::BufferStream stream;
+        char line[256];
+        snprintf(line, sizeof(line), "%-6s%-12s%10s%12s%12s%12s\n", "Type", "Stage", "Count", "Total ms", "Mean ms", "Max ms");
+        writeText(&stream, line);
+        for (uint32_t streamer = 0; streamer < MaxStreamerCount; streamer++)
+        {
+            char type[5];
+            fourCCText(streamerType(IB::Asset::StreamerIndex{streamer}), type);
+            for (uint32_t row = 0; row < RowCount; row++)
+            {
+                StageSummary const &summary = summaries[streamer * RowCount + row];
+                if (summary.Count == 0)
+                {
+                    continue;
+                }
+
+                double total = static_cast<double>(summary.Total) * millisecondsPerTick;
+                snprintf(line, sizeof(line), "%-6s%-12s%10u%12.3f%12.3f%12.3f\n", type, row == LoadRow ? "Load" : LoadStageNames[row],
+                         summary.Count, total, total / summary.Count, static_cast<double>(summary.Max) * millisecondsPerTick);
+                writeText(&stream, line);
+            }
+        }
+
+        return writeProfileFile(path, stream);
+    }
+
+    // Our prefetched reads wait here until their resource is loaded.
+    // Prefetches that are never picked up are discarded once we need their slot.
+    struct PrefetchedRead
+    {
+        IB::StringId Path = {};
+        void *Buffer = nullptr;
+        size_t Size = 0;
+        size_t *BytesRead = nullptr; // Written by our read, handed to our load along with our buffer
+        IB::JobHandle ReadJob = {};
+    };
+
+    constexpr uint32_t MaxPrefetchedReads = 64;
+    struct Prefetcher
+    {
+        IB::Asset::LoadTraceEntry *Trace = nullptr;
+        uint32_t TraceCount = 0;
+        AssetMap<IB::StringId, uint32_t, StringIdHash> TraceIndices; // The first time our path shows up in our trace
+        uint32_t Cursor = 0; // Our trace entries before our cursor have been prefetched
+        uint32_t Distance = 0;
+
+        PrefetchedRead Reads[MaxPrefetchedReads];
+        uint32_t NextRead = 0;
+        uint32_t Locked = 0;
+    };
+    Prefetcher Prefetch;
+
+    void lockPrefetch()
+    {
+        while (IB::atomicCompareExchange(&Prefetch.Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+    }
+
+    void unlockPrefetch()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&Prefetch.Locked, 0);
+    }
+
+    void discardPrefetchedRead(PrefetchedRead *read)
+    {
+        if (read->Buffer != nullptr)
+        {
+            // Our read could still be in flight, free our buffer once it's done.
+            void *buffer = read->Buffer;
+            size_t *bytesRead = read->BytesRead;
+            IB::continueJob([buffer, bytesRead]() {
+                IB::memoryFree(buffer, IB::MemoryTag::Assets);
+                IB::deallocate(bytesRead);
+                return IB::JobResult::Complete;
+            },
+                            &read->ReadJob, 1);
+        }
+        *read = {};
+    }
+
+    bool isPrefetched(IB::StringId path)
+    {
+        for (PrefetchedRead const &read : Prefetch.Reads)
+        {
+            if (read.Buffer != nullptr && read.Path == path)
+            {
+                return true;
+            }
+        }
+        return false;
+    }
+
+    // Reads ahead the archived assets that follow our path in our trace.
+    void prefetchAfter(IB::StringId path)
+    {
+        if (IB::volatileLoad(&Prefetch.TraceCount) == 0)
+        {
+            return;
+        }
+
+        lockPrefetch();
+        uint32_t const *traceIndex = Prefetch.TraceIndices.find(path);
+        if (traceIndex != nullptr)
+        {
+            // We've fallen far behind our cursor, our trace is being replayed again. (Reloading our level)
+            if (*traceIndex + 1 + Prefetch.Distance < Prefetch.Cursor)
+            {
+                Prefetch.Cursor = *traceIndex + 1;
+            }
+
+            uint32_t end = *traceIndex + 1 + Prefetch.Distance;
+            end = end < Prefetch.TraceCount ? end : Prefetch.TraceCount;
+            for (uint32_t i = Prefetch.Cursor > *traceIndex + 1 ? Prefetch.Cursor : *traceIndex + 1; i < end; i++)
+            {
+                IB::StringId upcomingPath = Prefetch.Trace[i].Path;
+                IB::File archiveFile = {};
+                IB::Asset::ArchiveEntry const *archivedAsset = findArchivedAsset(upcomingPath, &archiveFile);
+
+                // Loose files aren't prefetched and resources that are already in our table don't need to be read.
+                if (archivedAsset != nullptr && findResource(upcomingPath) == nullptr && !isPrefetched(upcomingPath))
+                {
+                    PrefetchedRead *read = &Prefetch.Reads[Prefetch.NextRead];
+                    Prefetch.NextRead = (Prefetch.NextRead + 1) % MaxPrefetchedReads;
+                    discardPrefetchedRead(read);
+
+                    read->Path = upcomingPath;
+                    read->Buffer = allocateArchivedAssetBuffer(archivedAsset);
+                    read->Size = static_cast<size_t>(archivedAsset->Size);
+                    read->BytesRead = IB::allocate<size_t>();
+                    read->ReadJob = IB::readFileAsync(archiveFile, read->Buffer, read->Size, archivedAsset->Offset, read->BytesRead);
+                }
+            }
+            Prefetch.Cursor = end > Prefetch.Cursor ? end : Prefetch.Cursor;
+        }
+        unlockPrefetch();
+    }
+
+    // Returns false if our asset wasn't prefetched.
+    bool takePrefetchedRead(IB::StringId path, PrefetchedRead *prefetchedRead)
+    {
+        if (IB::volatileLoad(&Prefetch.TraceCount) == 0)
+        {
+            return false;
+        }
+
+        bool found = false;
+        lockPrefetch();
+        for (PrefetchedRead &read : Prefetch.Reads)
+        {
+            if (read.Buffer != nullptr && read.Path == path)
+            {
+                *prefetchedRead = read;
+                read = {};
+                found = true;
+                break;
+            }
+        }
+        unlockPrefetch();
+
+        return found;
+    }
+
+    uint32_t streamerSlot(IB::Asset::FourCC type)
+    {
+        // Fibonacci hashing, our FourCCs only differ by a few characters and need to be spread over our table.
+        return (type.Value * 2654435769u) >> (32 - StreamerTableBits);
+    }
+
+    IB::Asset::IStreamer *getStreamer(IB::Asset::StreamerIndex streamer)
+    {
+        IB_ASSERT(streamer.Value < StreamerCount, "Failed to find streamer!");
+        return Streamers[streamer.Value];
+    }
+
+    // Sub assets with identical content are loaded once when their streamer shares identical assets.
+    struct SharedAsset
+    {
+        IB::Asset::ContentHash Hash = {};
+        IB::Asset::AssetHandle Asset = {};
+        IB::JobHandle LastRequestJob = {}; // Our first request is our load, see chainLoadRequest
+        uint32_t RefCount = 0;
+        uint32_t Loaded = 0;
+#ifdef IB_ENABLE_ASSERTS
+        // A copy of our first request's data, our hashes can collide and our later requests must have identical data.
+        void *Content = nullptr;
+        size_t Size = 0;
+#endif // IB_ENABLE_ASSERTS
+    };
+
+    // One table per streamer, our assets' handles only need to be unique within their streamer.
+    struct SharedAssetTable
+    {
+        AssetMap<uint64_t, SharedAsset *> ByContent;
+        AssetMap<uint64_t, SharedAsset *> ByAsset; // Only holds loaded assets, our unloads only know their asset
+        uint32_t Locked = 0;
+    };
+    SharedAssetTable SharedAssets[MaxStreamerCount];
+
+    void lockSharedAssets(SharedAssetTable *table)
+    {
+        while (IB::atomicCompareExchange(&table->Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+    }
+
+    void unlockSharedAssets(SharedAssetTable *table)
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&table->Locked, 0);
+    }
+
+    IB::JobHandle acquireSharedAsset(IB::Serialization::MemoryStream stream, size_t size, IB::Asset::StreamerIndex streamer, IB::Asset::ContentHash contentHash, IB::Asset::OnSubAssetLoad *onSubAssetLoad, void *data)
+    {
+        SharedAssetTable *table = &SharedAssets[streamer.Value];
+        lockSharedAssets(table);
+        SharedAsset *&entry = table->ByContent.findOrAdd(contentHash.Value);
+        if (entry == nullptr)
+        {
+            entry = IB::allocate<SharedAsset>();
+            entry->Hash = contentHash;
+            entry->RefCount = 1;
+#ifdef IB_ENABLE_ASSERTS
+            entry->Content = IB::memoryAllocate(size > 0 ? size : 1, alignof(uint64_t), IB::MemoryTag::Assets);
+            memcpy(entry->Content, stream.Memory, size);
+            entry->Size = size;
+#endif // IB_ENABLE_ASSERTS
+
+            struct SharedLoad
+            {
+                SharedAssetTable *Table;
+                SharedAsset *Shared;
+                IB::Asset::OnSubAssetLoad *OnSubAssetLoad;
+                void *Data;
+            };
+            SharedLoad *sharedLoad = IB::allocate<SharedLoad>(table, entry, onSubAssetLoad, data);
+
+            // Later requests wait on our load, our table stays locked until they can find it.
+            entry->LastRequestJob = IB::Asset::loadSubAssetAsync(stream, streamer, IB::Asset::InvalidAsset, [](void *data, IB::Asset::AssetHandle asset) {
+                SharedLoad *sharedLoad = reinterpret_cast<SharedLoad *>(data);
+                SharedAsset *shared = sharedLoad->Shared;
+
+                lockSharedAssets(sharedLoad->Table);
+                shared->Asset = asset;
+                shared->Loaded = 1;
+                SharedAsset *&byAsset = sharedLoad->Table->ByAsset.findOrAdd(asset.Value);
+                IB_ASSERT(byAsset == nullptr, "Two of our shared assets have the same handle!");
+                byAsset = shared;
+                unlockSharedAssets(sharedLoad->Table);
+
+                sharedLoad->OnSubAssetLoad(sharedLoad->Data, asset);
+                IB::deallocate(sharedLoad);
+            },
+                                                                         sharedLoad);
+            IB::JobHandle loadJob = entry->LastRequestJob;
+            unlockSharedAssets(table);
+            return loadJob;
+        }
+
+        SharedAsset *shared = entry;
+        shared->RefCount++;
+        bool loaded = shared->Loaded != 0;
+        unlockSharedAssets(table);
+
+        // Our reference keeps our shared asset's content alive.
+        IB_ASSERT(size == shared->Size && memcmp(shared->Content, stream.Memory, size) == 0, "Two different sub assets have the same content hash!");
+
+        if (loaded)
+        {
+            onSubAssetLoad(data, shared->Asset);
+            return IB::launchJob([]() { return IB::JobResult::Complete; });
+        }
+
+        IB::JobHandle requestJob = IB::reserveJob([shared, onSubAssetLoad, data]() {
+            onSubAssetLoad(data, shared->Asset);
+            return IB::JobResult::Complete;
+        });
+        return chainLoadRequest(&shared->LastRequestJob, requestJob);
+    }
+
+    // Returns the asset our streamer should unload, InvalidAsset if our asset still has users.
+    IB::Asset::AssetHandle releaseSharedAsset(IB::Asset::StreamerIndex streamer, IB::Asset::AssetHandle asset)
+    {
+        SharedAssetTable *table = &SharedAssets[streamer.Value];
+        lockSharedAssets(table);
+        SharedAsset **found = table->ByAsset.find(asset.Value);
+        if (found == nullptr) // Loaded without a content hash, we're its only user
+        {
+            unlockSharedAssets(table);
+            return asset;
+        }
+
+        SharedAsset *shared = *found;
+        IB_ASSERT(shared->RefCount > 0, "Unloaded our shared asset more often than we've loaded it!");
+        shared->RefCount--;
+        if (shared->RefCount > 0)
+        {
+            unlockSharedAssets(table);
+            return IB::Asset::InvalidAsset;
+        }
+
+        table->ByAsset.remove(asset.Value);
+        table->ByContent.remove(shared->Hash.Value);
+        unlockSharedAssets(table);
+
+#ifdef IB_ENABLE_ASSERTS
+        IB::memoryFree(shared->Content, IB::MemoryTag::Assets);
+#endif // IB_ENABLE_ASSERTS
+        IB::deallocate(shared);
+        return asset;
+    }
+
+    // The resource whose load our thread is running, the sub assets and resources that we load belong to it.
+    thread_local IB::StringId LoadingResource = {};
+
+    LoadResult load(IB::Asset::IStreamer *streamer, IB::Asset::LoadContext *context)
+    {
+        uint32_t state = context->State;
+        uint64_t streamStart = profileTime(context->Profile);
+
+        IB::StringId previousResource = LoadingResource;
+        LoadingResource = context->Resource;
+        IB::Asset::LoadContinuation result = streamer->loadAsync(context);
+        LoadingResource = previousResource;
+
+        // Once we've advanced, our job can be resumed and complete before we return.
+        profileStage(context->Profile, LoadStage::Stream, streamStart, state);
+        if (result.Continuation == IB::Asset::LoadContinuation::Advance)
+        {
+            IB::volatileStore(&context->State, result.Data.Advance.NextState);
+            IB::threadStoreStoreFence(); // Make sure our state value write is visible before our job is written to the job pool.
+
+            IB_ASSERT(result.Data.Advance.DependencyCount > 0, "If we want to advance, we need dependencies.");
+            // Resignal our job once our dependencies are complete.
+            IB::continueJob(context->Handle, result.Data.Advance.Dependencies, result.Data.Advance.DependencyCount); // Job could be signaled before we return
+            return {IB::JobResult::Sleep};
+        }
+        else
+        {
+            return LoadResult{IB::JobResult::Complete, result.Data.Complete.Handle};
+        }
+    }
+
+    // Loads of new resources wait in our queue until a slot frees up to read them.
+    struct PendingLoad
+    {
+        Resource *Resource = nullptr;
+        IB::Asset::LoadContext *LoadContext = nullptr;
+        IB::Asset::StreamingHints Hints = {};
+        uint64_t Order = 0; // Loads with the same hints start in the order they were requested
+        bool LooseFile = false; // Our reloads read our loose file even if our resource is archived
+        uint64_t QueuedTime = 0; // Only timed if our load is profiled
+    };
+
+    struct StreamingQueue
+    {
+        AssetArray<PendingLoad> Pending; // Binary heap, our most urgent load is first
+        uint64_t NextOrder = 0;
+        uint32_t ReadingCount = 0;
+        uint32_t MaxConcurrentLoads = 16;
+        uint32_t Locked = 0;
+    };
+    StreamingQueue Streaming;
+
+    void lockStreaming()
+    {
+        while (IB::atomicCompareExchange(&Streaming.Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+    }
+
+    void unlockStreaming()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&Streaming.Locked, 0);
+    }
+
+    bool isMoreUrgent(PendingLoad const &load, PendingLoad const &other)
+    {
+        if (load.Hints.Priority != other.Hints.Priority)
+        {
+            return load.Hints.Priority > other.Hints.Priority;
+        }
+
+        if (load.Hints.Distance != other.Hints.Distance)
+        {
+            return load.Hints.Distance < other.Hints.Distance;
+        }
+
+        return load.Order < other.Order;
+    }
+
+    // Our streaming queue's heap helpers, our streaming lock must be held.
+    void placePendingLoad(uint32_t index, PendingLoad const &load)
+    {
+        Streaming.Pending[index] = load;
+        load.Resource->PendingIndex = index;
+    }
+
+    void siftPendingLoadUp(uint32_t index)
+    {
+        PendingLoad load = Streaming.Pending[index];
+        while (index > 0)
+        {
+            uint32_t parent = (index - 1) / 2;
+            if (!isMoreUrgent(load, Streaming.Pending[parent]))
+            {
+                break;
+            }
+
+            placePendingLoad(index, Streaming.Pending[parent]);
+            index = parent;
+        }
+        placePendingLoad(index, load);
+    }
+
+    void siftPendingLoadDown(uint32_t index)
+    {
+        PendingLoad load = Streaming.Pending[index];
+        uint32_t count = Streaming.Pending.count();
+        while (true)
+        {
+            uint32_t child = index * 2 + 1;
+            if (child >= count)
+            {
+                break;
+            }
+
+            if (child + 1 < count && isMoreUrgent(Streaming.Pending[child + 1], Streaming.Pending[child]))
+            {
+                child++;
+            }
+
+            if (!isMoreUrgent(Streaming.Pending[child], load))
+            {
+                break;
+            }
+
+            placePendingLoad(index, Streaming.Pending[child]);
+            index = child;
+        }
+        placePendingLoad(index, load);
+    }
+
+    void pushPendingLoad(PendingLoad const &load)
+    {
+        Streaming.Pending.add(load);
+        siftPendingLoadUp(Streaming.Pending.count() - 1);
+    }
+
+    PendingLoad popPendingLoad()
+    {
+        PendingLoad load = Streaming.Pending[0];
+        load.Resource->PendingIndex = UINT32_MAX;
+
+        Streaming.Pending[0] = Streaming.Pending[Streaming.Pending.count() - 1];
+        Streaming.Pending.removeLast();
+        if (Streaming.Pending.count() > 0)
+        {
+            siftPendingLoadDown(0);
+        }
+        return load;
+    }
+
+    void pumpStreamingQueue();
+
+    // Our read is done, hand our slot to our next queued load.
+    void finishLoadRead()
+    {
+        lockStreaming();
+        Streaming.ReadingCount--;
+        unlockStreaming();
+
+        pumpStreamingQueue();
+    }
+
+    // Once our read is complete, decompresses our asset if our content processor compressed it and then launches our load.
+    // We own bytesRead, a failed or short read fails our load instead of handing a partially filled buffer to our streamer.
+    void continueLoadOnRead(Resource *resource, IB::Asset::LoadContext *loadContext, IB::JobHandle readJob, size_t *bytesRead, size_t readSize, uint64_t readStart)
+    {
+        IB::continueJob([resource, loadContext, bytesRead, readSize, readStart]() {
+            profileStage(loadContext->Profile, LoadStage::Read, readStart);
+            size_t readBytes = *bytesRead;
+            IB::deallocate(bytesRead);
+
+            // We don't need our loose file anymore.
+            if (resource->File.Value != IB::InvalidFile.Value)
+            {
+                IB::closeFile(resource->File);
+                resource->File = IB::InvalidFile;
+            }
+            finishLoadRead();
+
+            if (readBytes != readSize)
+            {
+                char message[MaxPathSize + 64];
+                snprintf(message, sizeof(message), "Failed to read %s, our file could be truncated.", IB::stringFromId(resource->Path));
+                IB_LOG(IB::LogLevel::Error, "Asset", message);
+
+                resource->ReadFailed = 1;
+                IB::launchJob(loadContext->Handle);
+            }
+            else if (IB::isCompressed(resource->Buffer, readSize))
+            {
+                // Our blocks are decompressed in parallel straight into the buffer that our streamer will read from.
+                void *compressed = resource->Buffer;
+                size_t size = IB::decompressedSize(compressed);
+                resource->Buffer = IB::memoryAllocate(size > 0 ? size : 1, AssetBufferAlignment, IB::MemoryTag::Assets);
+                resource->Size = size;
+                loadContext->Stream = {reinterpret_cast<uint8_t *>(resource->Buffer)};
+
+                uint32_t profile = loadContext->Profile;
+                uint64_t decompressStart = profileTime(profile);
+                IB::JobHandle decompressJob = IB::decompressAsync(compressed, readSize, resource->Buffer);
+                IB::JobHandle freeJob = IB::continueJob([compressed, profile, decompressStart]() {
+                    profileStage(profile, LoadStage::Decompress, decompressStart);
+                    IB::memoryFree(compressed, IB::MemoryTag::Assets);
+                    return IB::JobResult::Complete;
+                },
+                                                        &decompressJob, 1);
+                IB::continueJob(loadContext->Handle, &freeJob, 1);
+            }
+            else
+            {
+                IB::launchJob(loadContext->Handle);
+            }
+            return IB::JobResult::Complete;
+        },
+                        &readJob, 1);
+    }
+
+    void startLoad(PendingLoad const &load)
+    {
+        Resource *resource = load.Resource;
+        IB::Asset::LoadContext *loadContext = load.LoadContext;
+        profileStage(loadContext->Profile, LoadStage::Queue, load.QueuedTime);
+
+        IB::File archiveFile = {};
+        IB::Asset::ArchiveEntry const *archivedAsset = load.LooseFile ? nullptr : findArchivedAsset(resource->Path, &archiveFile);
+        IB_ASSERT(archivedAsset == nullptr || archivedAsset->Type.Value == resource->Type.Value, "Archived asset isn't the type we're loading it as!");
+
+        PrefetchedRead prefetchedRead = {};
+        // Our reads are issued by our I/O thread, our workers never stall on page faults for our asset's data.
+        if (archivedAsset != nullptr && takePrefetchedRead(resource->Path, &prefetchedRead))
+        {
+            // Our read was issued ahead of time, it might already be complete.
+            resource->Buffer = prefetchedRead.Buffer;
+            resource->Size = prefetchedRead.Size;
+            loadContext->Stream = {reinterpret_cast<uint8_t *>(resource->Buffer)};
+            continueLoadOnRead(resource, loadContext, prefetchedRead.ReadJob, prefetchedRead.BytesRead, prefetchedRead.Size, profileTime(loadContext->Profile));
+        }
+        else if (archivedAsset != nullptr)
+        {
+            // Our archive is already open, read our asset's range straight out of it.
+            resource->Buffer = allocateArchivedAssetBuffer(archivedAsset);
+            resource->Size = archivedAsset->Size;
+            loadContext->Stream = {reinterpret_cast<uint8_t *>(resource->Buffer)};
+
+            uint64_t readStart = profileTime(loadContext->Profile);
+            size_t *bytesRead = IB::allocate<size_t>();
+            IB::JobHandle readJob = IB::readFileAsync(archiveFile, resource->Buffer, archivedAsset->Size, archivedAsset->Offset, bytesRead);
+            continueLoadOnRead(resource, loadContext, readJob, bytesRead, archivedAsset->Size, readStart);
+        }
+        else
+        {
+            // Our file job continues our load once it's issued our read.
+            IB::launchJob([resource, loadContext]() {
+                uint64_t openStart = profileTime(loadContext->Profile);
+                char fullPath[MaxPathSize] = {};
+                snprintf(fullPath, MaxPathSize, "%s/%s", AssetPath, IB::stringFromId(resource->Path));
+
+                resource->File = IB::openFile(fullPath, IB::OpenFileOptions::Read | IB::OpenFileOptions::Asynchronous);
+                if (resource->File.Value == IB::InvalidFile.Value)
+                {
+                    // Our file could be missing or still locked by whoever is writing it, fail our load like a failed read.
+                    char message[MaxPathSize + 64];
+                    snprintf(message, sizeof(message), "Failed to open %s.", fullPath);
+                    IB_LOG(IB::LogLevel::Error, "Asset", message);
+
+                    profileStage(loadContext->Profile, LoadStage::Open, openStart);
+                    finishLoadRead();
+                    resource->ReadFailed = 1;
+                    IB::launchJob(loadContext->Handle);
+                    return IB::JobResult::Complete;
+                }
+
+                size_t size = IB::fileSize(resource->File);
+                resource->Buffer = IB::memoryAllocate(size > 0 ? size : 1, AssetBufferAlignment, IB::MemoryTag::Assets);
+                resource->Size = size;
+                loadContext->Stream = {reinterpret_cast<uint8_t *>(resource->Buffer)};
+                profileStage(loadContext->Profile, LoadStage::Open, openStart);
+
+                uint64_t readStart = profileTime(loadContext->Profile);
+                size_t *bytesRead = IB::allocate<size_t>();
+                IB::JobHandle readJob = IB::readFileAsync(resource->File, resource->Buffer, size, 0, bytesRead);
+                continueLoadOnRead(resource, loadContext, readJob, bytesRead, size, readStart);
+                return IB::JobResult::Complete;
+            });
+        }
+    }
+
+    // Starts our most urgent queued loads while we have free slots.
+    void pumpStreamingQueue()
+    {
+        bool started = true;
+        while (started)
+        {
+            PendingLoad load = {};
+
+            lockStreaming();
+            started = Streaming.ReadingCount < Streaming.MaxConcurrentLoads && Streaming.Pending.count() > 0;
+            if (started)
+            {
+                load = popPendingLoad();
+                Streaming.ReadingCount++;
+            }
+            unlockStreaming();
+
+            if (started)
+            {
+                startLoad(load);
+            }
+        }
+    }
+
+    // Raises our queued load's hints if our new request is more urgent.
+    // Our hints only ever become more urgent, sifting our load up is enough to keep our heap ordered.
+    void raiseLoadHints(Resource *resource, IB::Asset::StreamingHints hints)
+    {
+        lockStreaming();
+        uint32_t index = resource->PendingIndex;
+        if (index != UINT32_MAX)
+        {
+            PendingLoad &load = Streaming.Pending[index];
+            load.Hints.Priority = hints.Priority > load.Hints.Priority ? hints.Priority : load.Hints.Priority;
+            load.Hints.Distance = hints.Distance < load.Hints.Distance ? hints.Distance : load.Hints.Distance;
+            siftPendingLoadUp(index);
+        }
+        unlockStreaming();
+    }
+
+    IB::JobHandle loadBinaryAsync(Resource *resource, IB::Asset::StreamingHints hints, IB::Asset::OnResourceLoad *onResourceLoad, void *data)
+    {
+        IB::Asset::IStreamer *streamer = getStreamer(resource->Streamer);
+
+        IB::Asset::LoadContext *loadContext = IB::allocate<IB::Asset::LoadContext>();
+        loadContext->Streamer = resource->Streamer;
+        loadContext->Resource = resource->Path;
+        loadContext->Profile = profileLoad(resource->Path, resource->Streamer, false);
+        loadContext->Handle = IB::reserveJob([loadContext, streamer, onResourceLoad, data, resource]() {
+            // Our failed loads still call back, our resource simply doesn't have an asset.
+            LoadResult loadResult = resource->ReadFailed == 0 ? load(streamer, loadContext) : LoadResult{IB::JobResult::Complete, IB::Asset::InvalidAsset};
+            if (loadResult.Result == IB::JobResult::Complete)
+            {
+                resource->Asset = loadResult.Asset;
+
+                uint64_t callbackStart = profileTime(loadContext->Profile);
+                onResourceLoad(data, IB::Asset::ResourceHandle{resource->Path});
+                profileStage(loadContext->Profile, LoadStage::Callback, callbackStart);
+                IB::deallocate(loadContext);
+            }
+            return loadResult.Result;
+        });
+
+        // Our load job is reserved, waiting on our handle is valid before our load starts.
+        uint64_t queuedTime = profileTime(loadContext->Profile);
+        lockStreaming();
+        pushPendingLoad(PendingLoad{resource, loadContext, hints, Streaming.NextOrder++, false, queuedTime});
+        unlockStreaming();
+
+        pumpStreamingQueue();
+        return loadContext->Handle;
+    }
+
+    // Our resource must be loaded and we must own it.
+    void destroyResource(Resource *resource)
+    {
+        // Our failed loads don't have an asset to unload.
+        if (resource->Asset.Value != IB::Asset::InvalidAsset.Value)
+        {
+            getStreamer(resource->Streamer)->unloadThreadSafe(resource->Asset);
+        }
+        // Resources created with createResourceThreadSafe don't have a buffer.
+        if (resource->Buffer != nullptr)
+        {
+            IB::memoryFree(resource->Buffer, IB::MemoryTag::Assets);
+        }
+        IB::deallocate(resource);
+    }
+
+    IB::JobHandle unloadResource(Resource *resource)
+    {
+        waitOnResource(resource);
+
+        auto onUnload = [resource]() {
+            destroyResource(resource);
+            return IB::JobResult::Complete;
+        };
+
+        // At this point, we own the loaded asset. We're free to do what we want with it's data
+        if (IB::volatileLoad(&resource->Asset.Value) == IB::Asset::InvalidAsset.Value) // Not loaded yet
+        {
+            return IB::continueJob(onUnload, &resource->LoadingJob, 1);
+        }
+        else
+        {
+            return IB::launchJob(onUnload);
+        }
+    }
+
+    // Unloads our least recently released resources until our cache fits in its budget.
+    void trimResourceCache()
+    {
+        bool overBudget = true;
+        while (overBudget)
+        {
+            lockResourceCache();
+            overBudget = Cache.Tail != nullptr && (Cache.Budget == 0 || Cache.Size > Cache.Budget);
+            IB::StringId path = overBudget ? Cache.Tail->Path : IB::InvalidStringId;
+            unlockResourceCache();
+
+            // Our resource could have been picked back up while our cache was unlocked, we'll simply try again.
+            if (overBudget && IB::volatileLoad(&Releases.Deferred) != 0)
+            {
+                queueEvictedResource(path);
+                continue;
+            }
+
+            Resource *evicted = overBudget ? evictResource(path) : nullptr;
+            if (evicted != nullptr)
+            {
+                unloadResource(evicted);
+            }
+        }
+    }
+
+    // Takes our due resource out of our release queue and our table.
+    // Returns our resource if it was still unreferenced and due, we own it and have to unload it.
+    Resource *unqueueDueResource(IB::StringId path, uint64_t frame, bool flush)
+    {
+        ResourceShard *shard = lockResourceShard(path);
+        ResourceEntry *entry = shard->Entries.find(path);
+        Resource *due = nullptr;
+        if (entry != nullptr && entry->RefCount == 0 && entry->Resource->Queued != 0)
+        {
+            lockReleaseQueue();
+            if (flush || frame - entry->Resource->ReleaseFrame > Releases.GracePeriod)
+            {
+                due = entry->Resource;
+                unqueueRelease(due);
+            }
+            unlockReleaseQueue();
+
+            if (due != nullptr)
+            {
+                shard->Entries.remove(path);
+            }
+        }
+        unlockResourceShard(shard);
+
+        return due;
+    }
+
+    // Unloads our least recently released resources that have outlived our grace period, or all of them if we're flushing our queue.
+    // Stops once we're past our deadline, we always unload at least one resource to guarantee progress.
+    uint32_t unloadQueuedResources(bool flush, uint64_t deadline)
+    {
+        lockReleaseQueue();
+        uint64_t frame = ++Releases.Frame;
+        unlockReleaseQueue();
+
+        while (true)
+        {
+            // Our queued resources are only freed once they've left our queue, our tail is safe to read while our queue is locked.
+            lockReleaseQueue();
+            Resource *tail = Releases.Tail;
+            bool due = tail != nullptr && (flush || frame - tail->ReleaseFrame > Releases.GracePeriod);
+            IB::StringId path = due ? tail->Path : IB::InvalidStringId;
+            unlockReleaseQueue();
+
+            if (!due)
+            {
+                break;
+            }
+
+            // Our resource could have been picked back up while our queue was unlocked, we'll simply try again.
+            Resource *released = unqueueDueResource(path, frame, flush);
+            if (released != nullptr)
+            {
+                destroyResource(released);
+                if (IB::currentTimestamp() >= deadline)
+                {
+                    break;
+                }
+            }
+        }
+
+        lockReleaseQueue();
+        uint32_t remaining = Releases.Count;
+        unlockReleaseQueue();
+        return remaining;
+    }
+
+    // Assets replaced by our reloads stay loaded until they've survived our release queue's grace period, their users could still be reading them.
+    struct RetiredAsset
+    {
+        IB::Asset::StreamerIndex Streamer = {};
+        IB::Asset::AssetHandle Asset = {};
+        void *Buffer = nullptr;
+        uint64_t ReleaseFrame = 0; // Our release queue's frame when we were retired
+    };
+
+    // Our hot reloader watches our compiled assets while it's active.
+    // Resources that load other resources while we're watching are recorded as their dependents and reload along with them.
+    struct HotReloader
+    {
+        IB::DirectoryWatch Watch = IB::InvalidDirectoryWatch;
+        AssetMap<IB::StringId, uint64_t, StringIdHash> Changes; // When each of our changed files last changed, we reload them once they settle
+        AssetMap<IB::StringId, AssetArray<IB::StringId>, StringIdHash> Dependents; // By the resource they depend on
+        AssetMap<IB::StringId, Resource *, StringIdHash> Reloading; // Our reloads that haven't been swapped in yet
+        AssetArray<RetiredAsset> Retired; // In the order they were retired
+        uint32_t Watching = 0;
+        uint32_t Locked = 0;
+    };
+    HotReloader HotReload;
+
+    // Editors and our content processor could still be writing our file when we hear about it.
+    constexpr uint64_t ReloadSettleMilliseconds = 100;
+    // Cyclic dependents stop reloading once they're this deep.
+    constexpr uint32_t MaxReloadDepth = 16;
+
+    void lockHotReload()
+    {
+        while (IB::atomicCompareExchange(&HotReload.Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+    }
+
+    void unlockHotReload()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&HotReload.Locked, 0);
+    }
+
+    // Records the resource our thread is loading as a dependent of our path.
+    void recordDependent(IB::StringId dependency)
+    {
+        IB::StringId dependent = LoadingResource;
+        if (IB::volatileLoad(&HotReload.Watching) == 0 || dependent == IB::InvalidStringId || dependent == dependency)
+        {
+            return;
+        }
+
+        lockHotReload();
+        AssetArray<IB::StringId> &dependents = HotReload.Dependents.findOrAdd(dependency);
+        if (std::find(dependents.begin(), dependents.end(), dependent) == dependents.end())
+        {
+            dependents.add(dependent);
+        }
+        unlockHotReload();
+    }
+
+    void unloadRetiredAssets(AssetArray<RetiredAsset> *retired)
+    {
+        for (RetiredAsset &asset : *retired)
+        {
+            getStreamer(asset.Streamer)->unloadThreadSafe(asset.Asset);
+            // Resources created with createResourceThreadSafe don't have a buffer.
+            if (asset.Buffer != nullptr)
+            {
+                IB::memoryFree(asset.Buffer, IB::MemoryTag::Assets);
+            }
+        }
+        retired->clear();
+    }
+
+    // Unloads our retired assets that have outlived our grace period on our release queue's frame, or all of them if we're flushing.
+    void unloadDueRetiredAssets(uint64_t frame, bool flush)
+    {
+        lockReleaseQueue();
+        uint32_t gracePeriod = Releases.GracePeriod;
+        unlockReleaseQueue();
+
+        AssetArray<RetiredAsset> due;
+        lockHotReload();
+        // Our assets are retired in frame order, our due assets come first.
+        uint32_t retiredCount = HotReload.Retired.count();
+        uint32_t dueCount = 0;
+        while (dueCount < retiredCount && (flush || frame - HotReload.Retired[dueCount].ReleaseFrame > gracePeriod))
+        {
+            due.add(HotReload.Retired[dueCount]);
+            dueCount++;
+        }
+
+        for (uint32_t i = dueCount; i < retiredCount; i++)
+        {
+            HotReload.Retired[i - dueCount] = HotReload.Retired[i];
+        }
+        HotReload.Retired.resize(retiredCount - dueCount);
+        unlockHotReload();
+
+        unloadRetiredAssets(&due);
+    }
+
+    // Swaps our reloaded asset in behind our resource's handle, our old asset is retired until processReleaseQueue unloads it.
+    void swapReloadedResource(Resource *resource, Resource *reloaded, IB::Asset::AssetHandle asset)
+    {
+        lockReleaseQueue();
+        uint64_t frame = Releases.Frame;
+        unlockReleaseQueue();
+
+        lockHotReload();
+        HotReload.Retired.add(RetiredAsset{resource->Streamer, resource->Asset, resource->Buffer, frame});
+        HotReload.Reloading.remove(resource->Path);
+
+        // Our reload holds a reference, our resource isn't in our cache while we change its size.
+        resource->Buffer = reloaded->Buffer;
+        resource->Size = reloaded->Size;
+        IB::threadRelease(); // Our new buffer is visible before our new asset.
+        IB::volatileStore(&resource->Asset.Value, asset.Value);
+        unlockHotReload();
+
+        IB::deallocate(reloaded);
+        IB::Asset::releaseResourceAsync(IB::Asset::ResourceHandle{resource->Path});
+    }
+
+    // Our resource keeps its current asset if we couldn't read its new data.
+    // Whoever is writing our file could still hold it past our settle time, we try again on a later poll as long as our file exists.
+    void abandonReload(Resource *resource, Resource *reloaded)
+    {
+        char fullPath[MaxPathSize] = {};
+        snprintf(fullPath, MaxPathSize, "%s/%s", AssetPath, IB::stringFromId(resource->Path));
+        bool retry = IB::doesFileExist(fullPath);
+
+        lockHotReload();
+        HotReload.Reloading.remove(resource->Path);
+        if (retry)
+        {
+            HotReload.Changes.findOrAdd(resource->Path) = IB::currentTimestamp();
+        }
+        unlockHotReload();
+
+        IB::memoryFree(reloaded->Buffer, IB::MemoryTag::Assets);
+        IB::deallocate(reloaded);
+        IB::Asset::releaseResourceAsync(IB::Asset::ResourceHandle{resource->Path});
+    }
+
+    // Our reload reads our resource's loose file into a staging resource, our resource keeps its asset until our reload is swapped in.
+    // Our load job is reserved, our reload only starts once it's queued.
+    PendingLoad reserveReload(Resource *resource)
+    {
+        Resource *reloaded = IB::allocate<Resource>();
+        reloaded->Type = resource->Type;
+        reloaded->Streamer = resource->Streamer;
+        reloaded->Path = resource->Path;
+
+        IB::Asset::IStreamer *streamer = getStreamer(resource->Streamer);
+        IB::Asset::LoadContext *loadContext = IB::allocate<IB::Asset::LoadContext>();
+        loadContext->Streamer = resource->Streamer;
+        loadContext->Resource = resource->Path;
+        loadContext->Profile = profileLoad(resource->Path, resource->Streamer, false);
+        loadContext->Handle = IB::reserveJob([loadContext, streamer, resource, reloaded]() {
+            if (reloaded->ReadFailed != 0)
+            {
+                abandonReload(resource, reloaded);
+                IB::deallocate(loadContext);
+                return IB::JobResult::Complete;
+            }
+
+            LoadResult loadResult = load(streamer, loadContext);
+            if (loadResult.Result == IB::JobResult::Complete)
+            {
+                swapReloadedResource(resource, reloaded, loadResult.Asset);
+                IB::deallocate(loadContext);
+            }
+            return loadResult.Result;
+        });
+
+        // Someone is waiting to see their change, our reloads start before the rest of our streaming.
+        IB::Asset::StreamingHints hints = {};
+        hints.Priority = UINT32_MAX;
+        return PendingLoad{reloaded, loadContext, hints, 0, true};
+    }
+
+    // Our reloads that depend on the same depth of reloads start together.
+    struct ReloadWave
+    {
+        AssetArray<PendingLoad> Reloads;
+    };
+
+    void startReloadWave(ReloadWave *wave)
+    {
+        lockStreaming();
+        for (PendingLoad &reload : wave->Reloads)
+        {
+            reload.Order = Streaming.NextOrder++;
+            reload.QueuedTime = profileTime(reload.LoadContext->Profile);
+            pushPendingLoad(reload);
+        }
+        unlockStreaming();
+        IB::deallocate(wave);
+
+        pumpStreamingQueue();
+    }
+
+} // namespace
+
+namespace IB
+{
+    namespace Asset
+    {
+        LoadContinuation wait(JobHandle *dependencies, uint32_t dependencyCount, uint32_t nextState)
+        {
+            LoadContinuation result = {};
+            memcpy(result.Data.Advance.Dependencies, dependencies, sizeof(JobHandle) * dependencyCount);
+            result.Data.Advance.DependencyCount = dependencyCount;
+            result.Data.Advance.NextState = nextState;
+            result.Continuation = LoadContinuation::Advance;
+            return result;
+        }
+
+        LoadContinuation complete(AssetHandle handle)
+        {
+            LoadContinuation result = {};
+            result.Data.Complete.Handle = handle;
+            result.Continuation = LoadContinuation::Complete;
+            return result;
+        }
+
+        StreamerIndex addStreamer(FourCC type, IStreamer *streamer, uint32_t options)
+        {
+            IB_ASSERT(type.Value != 0, "Our empty streamer slots are marked with a FourCC of 0!");
+            IB_ASSERT(StreamerCount < MaxStreamerCount, "Too many streamers!");
+            IB_ASSERT(findStreamer(type).Value == InvalidStreamer.Value, "Type already has a streamer!");
+
+            StreamerIndex index = {StreamerCount++};
+            Streamers[index.Value] = streamer;
+            StreamerFlags[index.Value] = options;
+
+            uint32_t slot = streamerSlot(type);
+            while (StreamerTable[slot].Type.Value != 0)
+            {
+                slot = (slot + 1) & (StreamerTableSize - 1);
+            }
+            StreamerTable[slot] = StreamerSlot{type, index};
+            return index;
+        }
+
+        StreamerIndex findStreamer(FourCC type)
+        {
+            for (uint32_t slot = streamerSlot(type);; slot = (slot + 1) & (StreamerTableSize - 1))
+            {
+                if (StreamerTable[slot].Type.Value == type.Value)
+                {
+                    return StreamerTable[slot].Streamer;
+                }
+                else if (StreamerTable[slot].Type.Value == 0)
+                {
+                    return InvalidStreamer;
+                }
+            }
+        }
+
+        bool sharesIdenticalAssets(StreamerIndex streamer)
+        {
+            IB_ASSERT(streamer.Value < StreamerCount, "Failed to find streamer!");
+            return (StreamerFlags[streamer.Value] & StreamerOptions::ShareIdenticalAssets) != 0;
+        }
+
+        ContentHash hashContent(void const *data, size_t size)
+        {
+            // FNV-1a, like our string ids.
+            uint8_t const *bytes = reinterpret_cast<uint8_t const *>(data);
+            uint64_t hash = 0xcbf29ce484222325ull;
+            for (size_t i = 0; i < size; i++)
+            {
+                hash = (hash ^ bytes[i]) * 0x100000001b3ull;
+            }
+
+            // 0 is our unhashed content
+            return ContentHash{hash != 0 ? hash : 1};
+        }
+
+        ResourceHandle createResourceThreadSafe(StringId assetPath, FourCC type, AssetHandle asset)
+        {
+            IB_ASSERT(stringFromId(assetPath) != nullptr, "Asset paths must be interned!");
+
+            // Our new asset replaces any unreferenced copy of our resource that's sitting in our cache.
+            Resource *evicted = evictResource(assetPath);
+            if (evicted != nullptr)
+            {
+                unloadResource(evicted);
+            }
+
+            Resource *resource = nullptr;
+            bool newAssetEntry = acquireResource(assetPath, &resource);
+            IB_ASSERT(newAssetEntry, "createResource should only be called on an asset that does not exist!");
+
+            resource->Type = type;
+            resource->Streamer = findStreamer(type);
+            resource->Asset = asset;
+            publishResource(resource);
+
+            return ResourceHandle{assetPath};
+        }
+
+        JobHandle loadSubAssetAsync(Serialization::MemoryStream stream, StreamerIndex streamerIndex, AssetHandle parentAsset, OnSubAssetLoad *onSubAssetLoad, void *data)
+        {
+            LoadContext *context = allocate<LoadContext>(stream, parentAsset);
+            context->Streamer = streamerIndex;
+            context->Resource = LoadingResource;
+            context->Profile = profileLoad(LoadingResource, streamerIndex, true);
+
+            IB::Asset::IStreamer *streamer = getStreamer(streamerIndex);
+            context->Handle = reserveJob([context, streamer, onSubAssetLoad, data]() {
+                LoadResult loadResult = load(streamer, context);
+                if (loadResult.Result == JobResult::Complete)
+                {
+                    uint64_t callbackStart = profileTime(context->Profile);
+                    onSubAssetLoad(data, loadResult.Asset);
+                    profileStage(context->Profile, LoadStage::Callback, callbackStart);
+                    deallocate(context);
+                }
+                return loadResult.Result;
+            });
+            launchJob(context->Handle);
+            return context->Handle;
+        }
+
+        JobHandle loadSubAssetAsync(Serialization::MemoryStream stream, FourCC type, AssetHandle parentAsset, OnSubAssetLoad *onSubAssetLoad, void *data)
+        {
+            return loadSubAssetAsync(stream, findStreamer(type), parentAsset, onSubAssetLoad, data);
+        }
+
+        JobHandle loadSubAssetAsync(Serialization::MemoryStream stream, size_t size, StreamerIndex streamer, AssetHandle parentAsset, ContentHash contentHash, OnSubAssetLoad *onSubAssetLoad, void *data)
+        {
+            if (contentHash.Value != 0 && sharesIdenticalAssets(streamer))
+            {
+                return acquireSharedAsset(stream, size, streamer, contentHash, onSubAssetLoad, data);
+            }
+            return loadSubAssetAsync(stream, streamer, parentAsset, onSubAssetLoad, data);
+        }
+
+        JobHandle loadResourceAsync(StringId assetPath, FourCC type, StreamingHints hints, OnResourceLoad *onResourceLoad, void *data)
+        {
+            IB_ASSERT(stringFromId(assetPath) != nullptr, "Asset paths must be interned!");
+            traceLoad(assetPath);
+            prefetchAfter(assetPath);
+            recordDependent(assetPath);
+
+            // Our reference assures that no one unloads the asset from under us.
+            Resource *resource = nullptr;
+            bool newAssetEntry = acquireResource(assetPath, &resource);
+
+            JobHandle requestHandle = {};
+            if (!newAssetEntry)
+            {
+                // We could be asking for our asset to be loaded twice before our first load is complete.
+                // Simply wait for it to be complete.
+                waitOnResource(resource);
+
+                // If our data loads are reordered above the branch,
+                // and our loaded asset data has not been written yet
+                // We'll simply wait until the loading job is visible
+                // and submit a "continue" job to be run after our loading job
+
+                if (resource->Asset.Value != InvalidAsset.Value || volatileLoad(&resource->ReadFailed) != 0)
+                {
+                    onResourceLoad(data, ResourceHandle{assetPath});
+                    // Our callers can wait on our handle, an empty handle would alias whatever job is in our pool's first slot.
+                    requestHandle = launchJob([]() { return JobResult::Complete; });
+                }
+                else
+                {
+                    raiseLoadHints(resource, hints);
+                    JobHandle requestJob = reserveJob([resource, onResourceLoad, data, assetPath]() {
+                        IB_ASSERT(resource->Asset.Value != InvalidAsset.Value || resource->ReadFailed != 0, "No asset handle loaded!");
+                        onResourceLoad(data, ResourceHandle{assetPath});
+                        return JobResult::Complete;
+                    });
+                    requestHandle = chainLoadRequest(&resource->LastRequestJob, requestJob);
+                }
+            }
+            else // New resource, request load
+            {
+                resource->Type = type;
+                resource->Streamer = findStreamer(type);
+
+                requestHandle = loadBinaryAsync(resource, hints, onResourceLoad, data);
+                resource->LoadingJob = requestHandle;
+                resource->LastRequestJob = requestHandle;
+                publishResource(resource);
+            }
+
+            return requestHandle;
+        }
+
+        JobHandle releaseResourceAsync(ResourceHandle resourceHandle)
+        {
+            JobHandle job = {};
+            // Once we've released our last reference, our resource is either in our cache, in our release queue or no longer in our table.
+            // A new load of our path will create a new resource while we unload this one.
+            Resource *resource = releaseResource(resourceHandle.Path);
+            if (resource != nullptr)
+            {
+                job = unloadResource(resource);
+            }
+
+            trimResourceCache();
+            return job;
+        }
+
+        JobHandle loadSubAssetBatchAsync(BatchLoadContext const *context)
+        {
+            StreamerIndex streamer = findStreamer(context->Type);
+            if (context->ContentHashes != nullptr && sharesIdenticalAssets(streamer))
+            {
+                return loadBatchSeparatelyAsync(context);
+            }
+            return getStreamer(streamer)->loadBatchAsync(context);
+        }
+
+        JobHandle loadBatchSeparatelyAsync(BatchLoadContext const *context)
+        {
+            Serialization::MemoryStream stream = context->Stream;
+            StreamerIndex streamer = findStreamer(context->Type);
+            AssetArray<JobHandle> loadHandles;
+            loadHandles.reserve(context->Count);
+            for (uint32_t i = 0; i < context->Count; i++)
+            {
+                uint32_t size;
+                Serialization::fromBinary(&stream, &size);
+
+                AssetHandle *asset = &context->Assets[i];
+                ContentHash contentHash = context->ContentHashes != nullptr ? context->ContentHashes[i] : ContentHash{};
+                loadHandles.add(loadSubAssetAsync(stream, size, streamer, context->ParentAssets[i], contentHash, [](void *data, AssetHandle loadedAsset) {
+                    *reinterpret_cast<AssetHandle *>(data) = loadedAsset;
+                },
+                                                  asset));
+                Serialization::advance(&stream, size);
+            }
+
+            if (loadHandles.count() == 0)
+            {
+                return launchJob([]() { return JobResult::Complete; });
+            }
+            return continueJob([]() { return JobResult::Complete; }, loadHandles.data(), loadHandles.count());
+        }
+
+        void retainSubAssetThreadSafe(AssetHandle asset, StreamerIndex streamer)
+        {
+            IB_ASSERT(sharesIdenticalAssets(streamer), "Only shared assets can have more than one user!");
+            SharedAssetTable *table = &SharedAssets[streamer.Value];
+            lockSharedAssets(table);
+            SharedAsset **found = table->ByAsset.find(asset.Value);
+            IB_ASSERT(found != nullptr, "Our asset wasn't loaded as a shared asset!");
+            (*found)->RefCount++;
+            unlockSharedAssets(table);
+        }
+
+        void unloadSubAssetThreadSafe(AssetHandle asset, StreamerIndex streamer)
+        {
+            if (sharesIdenticalAssets(streamer))
+            {
+                asset = releaseSharedAsset(streamer, asset);
+                if (asset.Value == InvalidAsset.Value)
+                {
+                    return;
+                }
+            }
+            getStreamer(streamer)->unloadThreadSafe(asset);
+        }
+
+        void unloadSubAssetThreadSafe(AssetHandle asset, FourCC type)
+        {
+            unloadSubAssetThreadSafe(asset, findStreamer(type));
+        }
+
+        JobHandle saveResourceAsync(ResourceHandle resourceHandle)
+        {
+            return launchJob([resourceHandle]() {
+                // Keep a reference as we save, we don't want to dump our asset
+                Resource *resource = retainResource(resourceHandle.Path);
+                IB_ASSERT(resource != nullptr, "Asset should be in our table!");
+                waitOnResource(resource);
+
+                char fullPath[MaxPathSize] = {};
+                snprintf(fullPath, MaxPathSize, "%s/%s", AssetPath, stringFromId(resource->Path));
+
+                // Our asset is built in memory and written with a single write.
+                Serialization::BufferStream stream;
+                SaveContext saveContext = {&stream, resource->Asset};
+                getStreamer(resource->Streamer)->saveThreadSafe(&saveContext);
+
+                // Write to a temporary file and swap it in, a failed save never leaves a truncated asset behind.
+                char tempPath[MaxPathSize] = {};
+                snprintf(tempPath, MaxPathSize, "%s.tmp", fullPath);
+
+                IB::File file = IB::openFile(tempPath, OpenFileOptions::Create | OpenFileOptions::Overwrite | OpenFileOptions::Write);
+                IB_ASSERT(file.Value != InvalidFile.Value, "Failed to open our asset for saving!");
+                IB::appendToFile(file, stream.Memory, stream.Size);
+
+                // Once we're done saving to our file, assure that we close our write access to it.
+                IB::closeFile(file);
+
+                if (!replaceFile(tempPath, fullPath))
+                {
+                    IB_LOG(LogLevel::Error, "Asset", "Failed to replace our asset with its saved version.");
+                }
+
+                releaseResourceAsync(resourceHandle); // Go through our release flow to assure that we do the appropriate cleanup if we're the last reference.
+
+                return JobResult::Complete;
+            });
+        }
+
+        void saveSubAssetThreadSafe(Serialization::BufferStream *stream, StreamerIndex streamer, AssetHandle asset)
+        {
+            SaveContext saveContext = {stream, asset};
+            getStreamer(streamer)->saveThreadSafe(&saveContext);
+        }
+
+        void saveSubAssetThreadSafe(Serialization::BufferStream *stream, FourCC type, AssetHandle asset)
+        {
+            saveSubAssetThreadSafe(stream, findStreamer(type), asset);
         }
 
         AssetHandle GetAssetFromResource(ResourceHandle resourceHandle)
         {
-            uint32_t hashTableIndex = resourceHandle.Hash % MaxTableEntries;
-            IB_ASSERT(ResourceHashTable[hashTableIndex].RefCount > 0, "Resource is not loaded!");
+            Resource *resource = findResource(resourceHandle.Path);
+            IB_ASSERT(resource != nullptr, "Resource is not loaded!");
+            waitOnResource(resource);
 
-            return ResourceHashTable[hashTableIndex].Resource->Asset;
+            return resource->Asset;
         }
 
         char const *GetResourcePath(ResourceHandle resourceHandle)
         {
-            uint32_t hashTableIndex = resourceHandle.Hash % MaxTableEntries;
-            IB_ASSERT(ResourceHashTable[hashTableIndex].RefCount > 0, "Resource is not loaded!");
+            IB_ASSERT(findResource(resourceHandle.Path) != nullptr, "Resource is not loaded!");
+            return stringFromId(resourceHandle.Path);
+        }
+
+        void setMaxConcurrentLoads(uint32_t loadCount)
+        {
+            IB_ASSERT(loadCount > 0, "We need to be able to start at least one load.");
+            lockStreaming();
+            Streaming.MaxConcurrentLoads = loadCount;
+            unlockStreaming();
+
+            // We might have room for more of our queued loads.
+            pumpStreamingQueue();
+        }
+
+        void setResourceCacheBudget(uint64_t bytes)
+        {
+            lockResourceCache();
+            Cache.Budget = bytes;
+            unlockResourceCache();
+
+            trimResourceCache();
+        }
+
+        void setDeferredReleases(bool deferred, uint32_t gracePeriod)
+        {
+            lockReleaseQueue();
+            Releases.Deferred = deferred ? 1 : 0;
+            Releases.GracePeriod = gracePeriod;
+            unlockReleaseQueue();
+
+            // Nobody will process our queue anymore, unload what's left in it.
+            if (!deferred)
+            {
+                unloadQueuedResources(true, UINT64_MAX);
+            }
+        }
+
+        uint32_t processReleaseQueue(uint64_t budgetMicroseconds)
+        {
+            uint64_t deadline = UINT64_MAX;
+            if (budgetMicroseconds != UINT64_MAX)
+            {
+                deadline = IB::currentTimestamp() + budgetMicroseconds * IB::timestampFrequency() / 1000000;
+            }
+            uint32_t remaining = unloadQueuedResources(false, deadline);
+
+            // Our hot reloads' replaced assets share our frames and our grace period.
+            lockReleaseQueue();
+            uint64_t frame = Releases.Frame;
+            unlockReleaseQueue();
+            unloadDueRetiredAssets(frame, false);
+            return remaining;
+        }
+
+        JobHandle loadResourcesAsync(StringId const *assetPaths, FourCC const *types, uint32_t count, ResourceHandle *outputResources, StreamingHints hints)
+        {
+            struct BatchedLoad
+            {
+                StringId Path = {};
+                FourCC Type = {};
+                uint32_t RefCount = 0;
+                Resource *Resource = nullptr;
+                uintptr_t Archive = UINTPTR_MAX; // Loose files are read after our archives
+                uint64_t Offset = 0;
+            };
+
+            AssetArray<BatchedLoad> loads;
+            loads.reserve(count);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                IB_ASSERT(stringFromId(assetPaths[i]) != nullptr, "Asset paths must be interned!");
+                traceLoad(assetPaths[i]);
+                prefetchAfter(assetPaths[i]);
+                recordDependent(assetPaths[i]);
+                outputResources[i] = ResourceHandle{assetPaths[i]};
+                loads.add(BatchedLoad{assetPaths[i], types[i], 1});
+            }
+
+            // Merge our duplicate paths, each of our output handles still holds its own reference.
+            std::sort(loads.begin(), loads.end(), [](BatchedLoad const &left, BatchedLoad const &right) {
+                return left.Path.Value < right.Path.Value;
+            });
+
+            uint32_t uniqueCount = 0;
+            for (uint32_t i = 0; i < loads.count(); i++)
+            {
+                if (uniqueCount > 0 && loads[uniqueCount - 1].Path == loads[i].Path)
+                {
+                    IB_ASSERT(loads[uniqueCount - 1].Type.Value == loads[i].Type.Value, "Loading the same resource as different types!");
+                    loads[uniqueCount - 1].RefCount++;
+                }
+                else
+                {
+                    loads[uniqueCount++] = loads[i];
+                }
+            }
+            loads.resize(uniqueCount);
+
+            // Our handle waits on every resource that isn't loaded yet.
+            AssetArray<JobHandle> dependencies;
+            uint32_t createdCount = 0;
+            for (uint32_t i = 0; i < loads.count(); i++)
+            {
+                BatchedLoad &load = loads[i];
+                if (acquireResource(load.Path, &load.Resource, load.RefCount))
+                {
+                    load.Resource->Type = load.Type;
+                    load.Resource->Streamer = findStreamer(load.Type);
+
+                    File archiveFile = {};
+                    ArchiveEntry const *archivedAsset = findArchivedAsset(load.Path, &archiveFile);
+                    if (archivedAsset != nullptr)
+                    {
+                        load.Archive = archiveFile.Value;
+                        load.Offset = archivedAsset->Offset;
+                    }
+
+                    // Keep our created loads at the front of our batch.
+                    std::swap(loads[createdCount++], load);
+                }
+                else
+                {
+                    waitOnResource(load.Resource);
+                    if (volatileLoad(&load.Resource->Asset.Value) == InvalidAsset.Value)
+                    {
+                        raiseLoadHints(load.Resource, hints);
+                        dependencies.add(chainLoadRequest(&load.Resource->LastRequestJob, reserveJob([]() { return JobResult::Complete; })));
+                    }
+                }
+            }
+
+            // Queue our new loads in the order they're laid out in our archives.
+            std::sort(loads.begin(), loads.begin() + createdCount, [](BatchedLoad const &left, BatchedLoad const &right) {
+                return left.Archive != right.Archive ? left.Archive < right.Archive : left.Offset < right.Offset;
+            });
+
+            for (uint32_t i = 0; i < createdCount; i++)
+            {
+                Resource *resource = loads[i].Resource;
+                resource->LoadingJob = loadBinaryAsync(resource, hints, [](void *, ResourceHandle) {}, nullptr);
+                resource->LastRequestJob = resource->LoadingJob;
+                publishResource(resource);
+                dependencies.add(resource->LoadingJob);
+            }
+
+            if (dependencies.count() == 0)
+            {
+                return launchJob([]() { return JobResult::Complete; });
+            }
+            return continueJob([]() { return JobResult::Complete; }, dependencies.data(), dependencies.count());
+        }
+
+        uint64_t resourceCacheSize()
+        {
+            lockResourceCache();
+            uint64_t size = Cache.Size;
+            unlockResourceCache();
+
+            return size;
+        }
+
+        bool mountArchive(char const *archivePath)
+        {
+            IB_ASSERT(MountedArchiveCount < MaxMountedArchives, "Too many mounted archives!");
+
+            File file = openFile(archivePath, OpenFileOptions::Read | OpenFileOptions::Asynchronous);
+            if (file.Value == InvalidFile.Value)
+            {
+                return false;
+            }
+
+            // Our table of contents is read once, our assets are read as they're loaded.
+            ArchiveHeader header = {};
+            size_t tableSize = 0;
+            if (readFile(file, &header, sizeof(ArchiveHeader), 0) == sizeof(ArchiveHeader) && header.Magic == ArchiveMagic && header.Version == ArchiveVersion)
+            {
+                tableSize = sizeof(ArchiveEntry) * header.EntryCount;
+            }
+
+            ArchiveEntry *entries = nullptr;
+            if (tableSize > 0 && sizeof(ArchiveHeader) + tableSize <= fileSize(file))
+            {
+                entries = reinterpret_cast<ArchiveEntry *>(memoryAllocate(tableSize, alignof(ArchiveEntry), MemoryTag::Assets));
+                if (readFile(file, entries, tableSize, sizeof(ArchiveHeader)) != tableSize)
+                {
+                    memoryFree(entries, MemoryTag::Assets);
+                    entries = nullptr;
+                }
+            }
+
+            if (entries == nullptr)
+            {
+                IB_LOG(LogLevel::Error, "Asset", "Archive is invalid or was built by another version of our content processor.");
+                closeFile(file);
+                return false;
+            }
+
+            MountedArchive &archive = MountedArchives[MountedArchiveCount++];
+            archive.File = file;
+            archive.Entries = entries;
+            archive.EntryCount = header.EntryCount;
+            return true;
+        }
+
+        void unmountArchives()
+        {
+            for (uint32_t i = 0; i < MountedArchiveCount; i++)
+            {
+                memoryFree(MountedArchives[i].Entries, MemoryTag::Assets);
+                closeFile(MountedArchives[i].File);
+                MountedArchives[i] = {};
+            }
+            MountedArchiveCount = 0;
+        }
+
+        void beginLoadTrace()
+        {
+            lockTracer();
+            Tracer.Entries.clear();
+            Tracer.StartTime = currentTimestamp();
+            volatileStore<uint32_t>(&Tracer.Recording, 1);
+            unlockTracer();
+        }
+
+        bool endLoadTrace(char const *tracePath)
+        {
+            lockTracer();
+            volatileStore<uint32_t>(&Tracer.Recording, 0);
+            AssetArray<LoadTraceEntry> entries = std::move(Tracer.Entries);
+            unlockTracer();
+
+            File file = openFile(tracePath, OpenFileOptions::Write | OpenFileOptions::Overwrite);
+            if (file.Value == InvalidFile.Value)
+            {
+                IB_LOG(LogLevel::Error, "Asset", "Failed to open our load trace for writing.");
+                return false;
+            }
+
+            LoadTraceHeader header = {};
+            header.EntryCount = entries.count();
+            appendToFile(file, &header, sizeof(LoadTraceHeader));
+            appendToFile(file, entries.data(), sizeof(LoadTraceEntry) * entries.count());
+            closeFile(file);
+            return true;
+        }
+
+        bool beginPrefetch(char const *tracePath, uint32_t prefetchDistance)
+        {
+            IB_ASSERT(Prefetch.TraceCount == 0, "We're already prefetching, call endPrefetch first!");
+
+            File file = openFile(tracePath, OpenFileOptions::Read);
+            if (file.Value == InvalidFile.Value)
+            {
+                return false;
+            }
+
+            LoadTraceHeader header = {};
+            size_t traceSize = 0;
+            if (readFile(file, &header, sizeof(LoadTraceHeader), 0) == sizeof(LoadTraceHeader) && header.Magic == LoadTraceMagic && header.Version == LoadTraceVersion)
+            {
+                traceSize = sizeof(LoadTraceEntry) * header.EntryCount;
+            }
+
+            LoadTraceEntry *trace = nullptr;
+            if (traceSize > 0 && sizeof(LoadTraceHeader) + traceSize <= fileSize(file))
+            {
+                trace = reinterpret_cast<LoadTraceEntry *>(memoryAllocate(traceSize, alignof(LoadTraceEntry), MemoryTag::Assets));
+                if (readFile(file, trace, traceSize, sizeof(LoadTraceHeader)) != traceSize)
+                {
+                    memoryFree(trace, MemoryTag::Assets);
+                    trace = nullptr;
+                }
+            }
+            closeFile(file);
+
+            if (trace == nullptr)
+            {
+                IB_LOG(LogLevel::Error, "Asset", "Load trace is invalid or was recorded by another version of our engine.");
+                return false;
+            }
+
+            lockPrefetch();
+            for (uint32_t i = 0; i < header.EntryCount; i++)
+            {
+                // Assets we request more than once prefetch from their first request.
+                if (Prefetch.TraceIndices.find(trace[i].Path) == nullptr)
+                {
+                    Prefetch.TraceIndices.add(trace[i].Path, i);
+                }
+            }
+            Prefetch.Trace = trace;
+            Prefetch.Cursor = 0;
+            Prefetch.Distance = prefetchDistance;
+            volatileStore(&Prefetch.TraceCount, header.EntryCount);
+            unlockPrefetch();
+            return true;
+        }
+
+        void endPrefetch()
+        {
+            lockPrefetch();
+            volatileStore<uint32_t>(&Prefetch.TraceCount, 0);
+            for (PrefetchedRead &read : Prefetch.Reads)
+            {
+                discardPrefetchedRead(&read);
+            }
+            Prefetch.TraceIndices.clear();
+            memoryFree(Prefetch.Trace, MemoryTag::Assets);
+            Prefetch.Trace = nullptr;
+            Prefetch.Cursor = 0;
+            unlockPrefetch();
+        }
+
+        void beginLoadProfile()
+        {
+            lockProfiler();
+            Profiler.FirstLoad += Profiler.Loads.count();
+            Profiler.Loads.clear();
+            Profiler.Stages.clear();
+            Profiler.StartTime = currentTimestamp();
+            volatileStore<uint32_t>(&Profiler.Recording, 1);
+            unlockProfiler();
+        }
+
+        bool endLoadProfile(char const *timelinePath, char const *summaryPath)
+        {
+            lockProfiler();
+            volatileStore<uint32_t>(&Profiler.Recording, 0);
+            AssetArray<ProfiledLoad> loads = std::move(Profiler.Loads);
+            AssetArray<ProfiledStage> stages = std::move(Profiler.Stages);
+            uint32_t firstLoad = Profiler.FirstLoad;
+            uint64_t startTime = Profiler.StartTime;
+            Profiler.FirstLoad += loads.count();
+            unlockProfiler();
+
+            addProfiledWaits(&stages);
+
+            bool written = true;
+            if (timelinePath != nullptr)
+            {
+                written = writeLoadTimeline(timelinePath, loads, firstLoad, stages, startTime) && written;
+            }
+
+            if (summaryPath != nullptr)
+            {
+                written = writeLoadSummary(summaryPath, loads, firstLoad, stages) && written;
+            }
+            return written;
+        }
+
+        bool beginHotReload()
+        {
+            IB_ASSERT(HotReload.Watch.Value == InvalidDirectoryWatch.Value, "We're already hot reloading, call endHotReload first!");
+
+            HotReload.Watch = watchDirectory(AssetPath);
+            if (HotReload.Watch.Value == InvalidDirectoryWatch.Value)
+            {
+                IB_LOG(LogLevel::Error, "Asset", "Failed to watch our compiled assets for changes.");
+                return false;
+            }
+
+            volatileStore<uint32_t>(&HotReload.Watching, 1);
+            return true;
+        }
+
+        void endHotReload()
+        {
+            volatileStore<uint32_t>(&HotReload.Watching, 0);
+            unwatchDirectory(HotReload.Watch);
+            HotReload.Watch = InvalidDirectoryWatch;
+
+            lockHotReload();
+            IB_ASSERT(HotReload.Reloading.count() == 0, "Wait on our reloads before ending our hot reload!");
+            HotReload.Changes.clear();
+            HotReload.Dependents.clear();
+            unlockHotReload();
+
+            unloadDueRetiredAssets(0, true);
+        }
+
+        JobHandle reloadChangedResourcesAsync()
+        {
+            IB_ASSERT(HotReload.Watch.Value != InvalidDirectoryWatch.Value, "Call beginHotReload first!");
+
+            struct ReloadTarget
+            {
+                StringId Path = {};
+                uint32_t Depth = 0;
+                Resource *Resource = nullptr;
+            };
+
+            uint64_t now = currentTimestamp();
+            uint64_t settleTime = ReloadSettleMilliseconds * timestampFrequency() / 1000;
+            AssetArray<ReloadTarget> targets;
+
+            lockHotReload();
+            consumeDirectoryChanges(HotReload.Watch, [](void *data, char const *relativePath) {
+                // Our resources are keyed by their path relative to our compiled assets, we don't need to intern our changed paths.
+                HotReload.Changes.findOrAdd(toStringId(relativePath)) = *reinterpret_cast<uint64_t *>(data);
+            },
+                                    &now);
+
+            // Files that are still reloading from a previous change reload again once they're done.
+            AssetMap<StringId, uint32_t, StringIdHash> depths;
+            AssetArray<StringId> visiting;
+            for (auto &change : HotReload.Changes)
+            {
+                if (now - change.Value >= settleTime && HotReload.Reloading.find(change.Key) == nullptr)
+                {
+                    depths.add(change.Key, 0u);
+                    visiting.add(change.Key);
+                }
+            }
+
+            for (StringId path : visiting)
+            {
+                HotReload.Changes.remove(path);
+            }
+
+            // Our dependents reload in the wave after their deepest changed dependency.
+            while (visiting.count() > 0)
+            {
+                StringId path = visiting[visiting.count() - 1];
+                visiting.removeLast();
+
+                uint32_t depth = *depths.find(path);
+                AssetArray<StringId> *dependents = HotReload.Dependents.find(path);
+                if (dependents == nullptr || depth + 1 >= MaxReloadDepth)
+                {
+                    continue;
+                }
+
+                for (StringId dependent : *dependents)
+                {
+                    uint32_t *dependentDepth = depths.find(dependent);
+                    if (dependentDepth == nullptr)
+                    {
+                        depths.add(dependent, depth + 1);
+                        visiting.add(dependent);
+                    }
+                    else if (*dependentDepth < depth + 1)
+                    {
+                        *dependentDepth = depth + 1;
+                        visiting.add(dependent);
+                    }
+                }
+            }
+            unlockHotReload();
+
+            // Only our loaded resources reload, the rest will load our new file whenever they're requested.
+            for (auto &entry : depths)
+            {
+                Resource *resource = retainResource(entry.Key);
+                if (resource == nullptr)
+                {
+                    continue;
+                }
+
+                waitOnResource(resource);
+                if (volatileLoad(&resource->Asset.Value) == InvalidAsset.Value)
+                {
+                    releaseResourceAsync(ResourceHandle{entry.Key});
+                    continue;
+                }
+                targets.add(ReloadTarget{entry.Key, entry.Value, resource});
+            }
+
+            uint32_t reloadCount = 0;
+            lockHotReload();
+            for (ReloadTarget &target : targets)
+            {
+                // Our dependent is still reloading from a previous change, try again on our next poll.
+                if (HotReload.Reloading.find(target.Path) != nullptr)
+                {
+                    HotReload.Changes.findOrAdd(target.Path) = 0;
+                    continue;
+                }
+
+                HotReload.Reloading.add(target.Path, target.Resource);
+                targets[reloadCount++] = target;
+            }
+            unlockHotReload();
+
+            for (uint32_t i = reloadCount; i < targets.count(); i++)
+            {
+                releaseResourceAsync(ResourceHandle{targets[i].Path});
+            }
+            targets.resize(reloadCount);
 
-            Resource *resource = volatileLoad(&ResourceHashTable[hashTableIndex].Resource);
-            // Assure we don't move our resource reads/writes past this point.
-            // Our reads are dependent on the volatileLoad above however, perhaps we can avoid the acquire due to a data dependency?
-            threadAcquire();
+            std::sort(targets.begin(), targets.end(), [](ReloadTarget const &left, ReloadTarget const &right) {
+                return left.Depth < right.Depth;
+            });
+
+            // Our load jobs are reserved up front, each wave is started once the wave before it is swapped in.
+            AssetArray<JobHandle> previousWave;
+            AssetArray<JobHandle> currentWave;
+            for (uint32_t i = 0; i < targets.count();)
+            {
+                ReloadWave *wave = allocate<ReloadWave>();
+                currentWave.clear();
+                for (uint32_t depth = targets[i].Depth; i < targets.count() && targets[i].Depth == depth; i++)
+                {
+                    PendingLoad reload = reserveReload(targets[i].Resource);
+                    currentWave.add(reload.LoadContext->Handle);
+                    wave->Reloads.add(reload);
+                }
+
+                if (previousWave.count() == 0)
+                {
+                    startReloadWave(wave);
+                }
+                else
+                {
+                    continueJob([wave]() {
+                        startReloadWave(wave);
+                        return JobResult::Complete;
+                    },
+                                previousWave.data(), previousWave.count());
+                }
+                std::swap(previousWave, currentWave);
+            }
 
-            return resource->Path;
+            if (previousWave.count() == 0)
+            {
+                return launchJob([]() { return JobResult::Complete; });
+            }
+            return continueJob([]() { return JobResult::Complete; }, previousWave.data(), previousWave.count());
         }
 
     } // namespace Asset
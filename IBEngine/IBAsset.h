@@ -4,6 +4,7 @@
 #include "IBSerialization.h"
 #include "IBJobs.h"
 #include "IBLogging.h"
+#include "IBStringId.h"
 #include <stdint.h>
 
 namespace IB
@@ -28,9 +29,23 @@ namespace IB
 
         struct ResourceHandle
         {
-            uint32_t Hash;
+            StringId Path;
         };
 
+        // Our streamers are numbered in the order they're added, look them up once and keep their index around.
+        struct StreamerIndex
+        {
+            uint32_t Value = UINT32_MAX;
+        };
+        constexpr StreamerIndex InvalidStreamer = {UINT32_MAX};
+
+        // Hash of a sub asset's serialized data, written next to it when it's saved.
+        struct ContentHash
+        {
+            uint64_t Value = 0; // 0 if our content wasn't hashed
+        };
+        IB_API ContentHash hashContent(void const *data, size_t size);
+
         struct LoadContext
         {
             Serialization::MemoryStream Stream;
@@ -38,11 +53,14 @@ namespace IB
             JobHandle Handle = {};
             uint64_t Data = 0;
             uint32_t State = 0;
+            StreamerIndex Streamer = {}; // The streamer loading us
+            StringId Resource = {}; // The resource we're loaded as part of, InvalidStringId if we aren't loaded as part of a resource
+            uint32_t Profile = 0; // Our load's id in our load profile, 0 if we aren't profiled
         };
 
         struct SaveContext
         {
-            Serialization::FileStream *Stream;
+            Serialization::BufferStream *Stream; // Written to our asset's file once our save is complete
             AssetHandle Asset;
         };
 
@@ -73,11 +91,32 @@ namespace IB
         IB_API LoadContinuation wait(JobHandle *dependencies, uint32_t dependencyCount, uint32_t nextState);
         IB_API LoadContinuation complete(AssetHandle handle);
 
+        // Many sub assets of the same type, loaded with a single call to their streamer.
+        struct BatchLoadContext
+        {
+            Serialization::MemoryStream Stream; // Our assets' data back to back, each one prefixed by its uint32_t size
+            FourCC Type = {};
+            uint32_t Count = 0;
+            AssetHandle const *ParentAssets = nullptr; // One per asset
+            AssetHandle *Assets = nullptr; // One per asset, written before our handle completes
+            ContentHash const *ContentHashes = nullptr; // Optional, one per asset, lets our streamer share our identical assets
+        };
+
+        // Loads every asset of our batch on its own sub asset job.
+        IB_API JobHandle loadBatchSeparatelyAsync(BatchLoadContext const *context);
+
         class IStreamer
         {
         public:
             virtual LoadContinuation loadAsync(LoadContext *context) = 0;
             virtual void unloadThreadSafe(AssetHandle handle) = 0;
+            // Our handle completes once all of our batch's assets are written, our context survives until then.
+            // Override it to load our batch in bulk, our assets are still unloaded one at a time.
+            // Batches with content hashes bypass it if we share identical assets, each of their assets is shared or loaded on its own.
+            virtual JobHandle loadBatchAsync(BatchLoadContext const *context)
+            {
+                return loadBatchSeparatelyAsync(context);
+            }
             virtual void saveThreadSafe(SaveContext *context)
             {
                 (void)context;
@@ -87,22 +126,179 @@ namespace IB
         using OnResourceLoad = void(void *data, ResourceHandle resource);
         using OnSubAssetLoad = void(void *data, AssetHandle asset);
 
+        struct StreamerOptions
+        {
+            enum
+            {
+                // Our assets are never modified once they're loaded.
+                // Sub assets loaded with the same content hash are loaded once and handed out to every user, without a parent.
+                ShareIdenticalAssets = 0x01
+            };
+        };
+
         // Streamer API
-        IB_API void addStreamer(FourCC type, IStreamer *streamer);
+        IB_API StreamerIndex addStreamer(FourCC type, IStreamer *streamer, uint32_t options = 0);
+        IB_API StreamerIndex findStreamer(FourCC type); // Threadsafe once our streamers are added, InvalidStreamer if our type has no streamer
+        IB_API bool sharesIdenticalAssets(StreamerIndex streamer); // Threadsafe once our streamers are added
+        IB_API JobHandle loadSubAssetAsync(Serialization::MemoryStream stream, StreamerIndex streamer, AssetHandle parentAsset, OnSubAssetLoad *onSubAssetLoad, void *data);
         IB_API JobHandle loadSubAssetAsync(Serialization::MemoryStream stream, FourCC type, AssetHandle parentAsset, OnSubAssetLoad *onSubAssetLoad, void *data);
+        // Hands out our shared asset if it's already loaded or loading, every load has to be matched by an unload.
+        // Size is our stream's size, with asserts enabled we check that our shared asset was loaded from identical bytes.
+        IB_API JobHandle loadSubAssetAsync(Serialization::MemoryStream stream, size_t size, StreamerIndex streamer, AssetHandle parentAsset, ContentHash contentHash, OnSubAssetLoad *onSubAssetLoad, void *data);
+        IB_API JobHandle loadSubAssetBatchAsync(BatchLoadContext const *context);
+        // Adds a user to a loaded shared asset, they'll have to unload it as well.
+        IB_API void retainSubAssetThreadSafe(AssetHandle asset, StreamerIndex streamer);
+        // Shared assets are only unloaded by their streamer once their last user unloads them.
+        IB_API void unloadSubAssetThreadSafe(AssetHandle asset, StreamerIndex streamer);
         IB_API void unloadSubAssetThreadSafe(AssetHandle asset, FourCC type);
-        IB_API void saveSubAssetThreadSafe(Serialization::FileStream *stream, FourCC type, AssetHandle asset);
+        IB_API void saveSubAssetThreadSafe(Serialization::BufferStream *stream, StreamerIndex streamer, AssetHandle asset);
+        IB_API void saveSubAssetThreadSafe(Serialization::BufferStream *stream, FourCC type, AssetHandle asset);
 
         // User API
-        IB_API ResourceHandle createResourceThreadSafe(char const *assetPath, FourCC type, AssetHandle asset);
-        IB_API JobHandle loadResourceAsync(char const *assetPath, FourCC type, OnResourceLoad *onResourceLoad, void *data);
-        IB_API JobHandle releaseResourceAsync(ResourceHandle resource);
+        // Our asset paths must have been interned, intern your paths once and keep their ids around to avoid rehashing them.
+        IB_API ResourceHandle createResourceThreadSafe(StringId assetPath, FourCC type, AssetHandle asset);
+        IB_API JobHandle releaseResourceAsync(ResourceHandle resource); // Our handle is empty if our resource stays in our cache or goes to our release queue.
         IB_API JobHandle saveResourceAsync(ResourceHandle resource);
 
         IB_API AssetHandle GetAssetFromResource(ResourceHandle resourceHandle);
         IB_API char const *GetResourcePath(ResourceHandle resourceHandle);
 
-        inline JobHandle loadResourceAsync(char const *assetPath, FourCC type, ResourceHandle *outputResource)
+        // Streaming API
+        // Loads of new resources are queued and started by priority, then by distance.
+        // Only our max concurrent loads read at once, decompressing and streaming our resource doesn't hold on to our slot.
+        // Requesting a resource that's still queued raises its hints if our request is more urgent.
+        // If our resource's data can't be read, our load logs an error and still calls back, GetAssetFromResource returns InvalidAsset.
+        struct StreamingHints
+        {
+            uint32_t Priority = 0; // Higher priorities load first
+            float Distance = 0.0f; // Closer resources load first among equal priorities
+        };
+
+        IB_API JobHandle loadResourceAsync(StringId assetPath, FourCC type, StreamingHints hints, OnResourceLoad *onResourceLoad, void *data);
+        // Loads a batch of resources, our handle completes once all of them are loaded.
+        // Our output handles are written right away, one per path. Release each of them like any other resource handle.
+        // Duplicate paths share a single load and our new loads are queued in archive order to keep our reads sequential.
+        IB_API JobHandle loadResourcesAsync(StringId const *assetPaths, FourCC const *types, uint32_t count, ResourceHandle *outputResources, StreamingHints hints = {});
+        IB_API void setMaxConcurrentLoads(uint32_t loadCount); // Threadsafe
+
+        // Resources that are no longer referenced stay loaded in our cache until it goes over its budget,
+        // our least recently released resources are unloaded first. Loading a cached resource is free.
+        // Our budget defaults to 0, released resources are unloaded right away. Setting our budget to 0 unloads our whole cache.
+        IB_API void setResourceCacheBudget(uint64_t bytes); // Threadsafe
+        IB_API uint64_t resourceCacheSize(); // Threadsafe, in bytes
+
+        // Deferred releases queue our unreferenced resources instead of unloading them, including the ones our cache evicts.
+        // Call processReleaseQueue at a known point, like the end of a frame, to unload them in a single pass.
+        // Our queued resources survive gracePeriod passes, requesting one of them again cancels its unload.
+        // Disabling deferred releases unloads everything that's still queued.
+        IB_API void setDeferredReleases(bool deferred, uint32_t gracePeriod = 0); // Threadsafe
+        // Unloads our due resources, oldest first, until we run out of our budget. Returns how many resources are still queued.
+        // Also unloads the assets that our hot reloads retired once they're due, see reloadChangedResourcesAsync.
+        IB_API uint32_t processReleaseQueue(uint64_t budgetMicroseconds = UINT64_MAX); // Threadsafe
+
+        // Archive API
+        // Archives pack our compiled assets into a single file that we open once.
+        // Our table of contents is sorted by path id and read at mount, loading a resource that lives in a mounted archive
+        // reads its range from our open archive without opening a file of its own.
+        // Resources that aren't in any of our archives are loaded from their own file.
+        // Saving always writes our resource to its own file.
+        //
+        // Layout: ArchiveHeader, ArchiveEntry[EntryCount], our assets' data
+        constexpr uint32_t ArchiveMagic = toFourCC("IBAR").Value;
+        constexpr uint32_t ArchiveVersion = 1;
+
+        struct ArchiveHeader
+        {
+            uint32_t Magic = ArchiveMagic;
+            uint32_t Version = ArchiveVersion;
+            uint32_t EntryCount = 0;
+            uint32_t Padding = 0;
+        };
+
+        struct ArchiveEntry
+        {
+            StringId Path = {};
+            uint64_t Offset = 0; // From the start of our archive, a multiple of our alignment
+            uint64_t Size = 0;
+            FourCC Type = {};
+            uint32_t Alignment = 0;
+        };
+
+        // Archives mounted last are searched first, mount patches after the archives they override.
+        IB_API bool mountArchive(char const *archivePath); // Not threadsafe, mount your archives before loading from them.
+        IB_API void unmountArchives(); // Not threadsafe, all resources loaded from our archives must have been released.
+
+        // Load Trace API
+        // Our load trace records every resource we request and when we requested it.
+        // Packaging our archives with a trace lays out our assets in the order that we load them, see ContentProcessor -package.
+        // Prefetching with a trace reads our upcoming archived assets ahead of time as we request the assets that precede them.
+        //
+        // Layout: LoadTraceHeader, LoadTraceEntry[EntryCount]
+        constexpr uint32_t LoadTraceMagic = toFourCC("IBLT").Value;
+        constexpr uint32_t LoadTraceVersion = 1;
+
+        struct LoadTraceHeader
+        {
+            uint32_t Magic = LoadTraceMagic;
+            uint32_t Version = LoadTraceVersion;
+            uint32_t EntryCount = 0;
+            uint32_t Padding = 0;
+        };
+
+        struct LoadTraceEntry
+        {
+            StringId Path = {};
+            uint64_t Time = 0; // Microseconds since our trace began
+        };
+
+        IB_API void beginLoadTrace(); // Threadsafe
+        // Returns false if we failed to write our trace.
+        IB_API bool endLoadTrace(char const *tracePath); // Threadsafe
+
+        // prefetchDistance is how many of our upcoming trace entries we keep reading ahead of our requests.
+        IB_API bool beginPrefetch(char const *tracePath, uint32_t prefetchDistance = 8); // Not threadsafe, mount your archives first.
+        IB_API void endPrefetch(); // Not threadsafe
+
+        // Load Profile API
+        // Our load profile times every stage of the resource and sub asset loads that we request while it's recording:
+        // waiting in our streaming queue, opening our loose file, reading, decompressing, each state of our streamer,
+        // waiting on the dependencies of our streamer's advanced states and our completion callback.
+        // Our timeline is a Chrome trace (chrome://tracing or ui.perfetto.dev) with a row per load.
+        // Our summary is a table of the time spent in each stage per asset type.
+        IB_API void beginLoadProfile(); // Threadsafe
+        // Either path can be nullptr. Returns false if we failed to write either of them.
+        IB_API bool endLoadProfile(char const *timelinePath, char const *summaryPath); // Threadsafe
+
+        // Hot Reload API
+        // Our hot reloader watches our compiled assets and reloads our loaded resources whose files changed.
+        // Reloads read our resource's loose file with its streamer and swap our new asset in behind its resource handle,
+        // GetAssetFromResource returns our new asset once its reload is complete.
+        // A reload that fails to read our file keeps our current asset.
+        // Resources that loaded our changed resource while we were watching are its dependents, they reload after it.
+        // Begin hot reloading before loading the resources you want to iterate on.
+        IB_API bool beginHotReload(); // Not threadsafe, returns false if we failed to watch our compiled assets.
+        IB_API void endHotReload(); // Not threadsafe, our reloads must be complete. Unloads our remaining retired assets.
+        // Call it once a frame, our handle completes once the reloads we've started are swapped in.
+        // The assets that our reloads replace are retired, processReleaseQueue unloads them once they've survived our grace period like our deferred releases.
+        // Call processReleaseQueue once a frame while hot reloading, at a point where nothing still reads the assets it got before our reloads.
+        IB_API JobHandle reloadChangedResourcesAsync(); // Not threadsafe
+
+        inline ResourceHandle createResourceThreadSafe(char const *assetPath, FourCC type, AssetHandle asset)
+        {
+            return createResourceThreadSafe(internString(assetPath), type, asset);
+        }
+
+        inline JobHandle loadResourceAsync(StringId assetPath, FourCC type, OnResourceLoad *onResourceLoad, void *data)
+        {
+            return loadResourceAsync(assetPath, type, StreamingHints{}, onResourceLoad, data);
+        }
+
+        inline JobHandle loadResourceAsync(char const *assetPath, FourCC type, OnResourceLoad *onResourceLoad, void *data)
+        {
+            return loadResourceAsync(internString(assetPath), type, onResourceLoad, data);
+        }
+
+        inline JobHandle loadResourceAsync(StringId assetPath, FourCC type, ResourceHandle *outputResource)
         {
             return loadResourceAsync(assetPath, type, [](void *data, ResourceHandle resource) {
                 *reinterpret_cast<ResourceHandle *>(data) = resource;
@@ -110,8 +306,22 @@ namespace IB
                                      outputResource);
         }
 
-        template <typename StreamType>
-        inline JobHandle loadSubAssetAsync(StreamType stream, FourCC type, AssetHandle parentAsset, AssetHandle *outputAsset)
+        inline JobHandle loadResourceAsync(char const *assetPath, FourCC type, ResourceHandle *outputResource)
+        {
+            return loadResourceAsync(internString(assetPath), type, outputResource);
+        }
+
+        inline JobHandle loadResourceAsync(StringId assetPath, FourCC type, StreamingHints hints, ResourceHandle *outputResource)
+        {
+            return loadResourceAsync(assetPath, type, hints, [](void *data, ResourceHandle resource) {
+                *reinterpret_cast<ResourceHandle *>(data) = resource;
+            },
+                                     outputResource);
+        }
+
+        // Our type can be a FourCC or a StreamerIndex.
+        template <typename StreamType, typename TypeOrStreamer>
+        inline JobHandle loadSubAssetAsync(StreamType stream, TypeOrStreamer type, AssetHandle parentAsset, AssetHandle *outputAsset)
         {
             return loadSubAssetAsync(stream, type, parentAsset, [](void *data, AssetHandle asset) {
                 *reinterpret_cast<AssetHandle *>(data) = asset;
@@ -119,8 +329,8 @@ namespace IB
                                      outputAsset);
         }
 
-        template <typename StreamType>
-        inline JobHandle loadSubAssetAsync(StreamType stream, FourCC type, AssetHandle parentAsset)
+        template <typename StreamType, typename TypeOrStreamer>
+        inline JobHandle loadSubAssetAsync(StreamType stream, TypeOrStreamer type, AssetHandle parentAsset)
         {
             return loadSubAssetAsync(stream, type, parentAsset, [](void *, AssetHandle) {}, nullptr);
         }
@@ -0,0 +1,338 @@
+#include "IBCompression.h"
+#include "IBAllocator.h"
+#include "IBLogging.h"
+
+#include <string.h>
+
+namespace
+{
+    constexpr uint32_t MinMatchLength = 4;
+    constexpr uint32_t MaxMatchOffset = 0xFFFF;
+    constexpr uint32_t HashBits = 14;
+    constexpr uint32_t InvalidPosition = UINT32_MAX;
+    static_assert(IB::CompressionBlockSize - 1 <= MaxMatchOffset, "Our offsets are 2 bytes, every position in our block has to be reachable.");
+
+    uint32_t read32(uint8_t const *data)
+    {
+        uint32_t value;
+        memcpy(&value, data, sizeof(uint32_t));
+        return value;
+    }
+
+    uint32_t hashSequence(uint32_t sequence)
+    {
+        // Knuth's multiplicative hash, keep our top bits.
+        return (sequence * 2654435761u) >> (32 - HashBits);
+    }
+
+    // Returns false if our length doesn't fit in our output.
+    bool writeLength(uint8_t **output, uint8_t const *outputEnd, size_t length)
+    {
+        for (; length >= 255; length -= 255)
+        {
+            if (*output >= outputEnd)
+            {
+                return false;
+            }
+            *(*output)++ = 255;
+        }
+
+        if (*output >= outputEnd)
+        {
+            return false;
+        }
+        *(*output)++ = static_cast<uint8_t>(length);
+        return true;
+    }
+
+    // Returns false if our sequence doesn't fit in our output.
+    // A match length of 0 writes our final sequence, it only has literals.
+    bool writeSequence(uint8_t **output, uint8_t const *outputEnd, uint8_t const *literals, size_t literalCount, uint32_t offset, size_t matchLength)
+    {
+        if (*output >= outputEnd)
+        {
+            return false;
+        }
+
+        size_t matchToken = matchLength > 0 ? matchLength - MinMatchLength : 0;
+        uint8_t *token = (*output)++;
+        *token = static_cast<uint8_t>(((literalCount < 15 ? literalCount : 15) << 4) | (matchToken < 15 ? matchToken : 15));
+
+        if (literalCount >= 15 && !writeLength(output, outputEnd, literalCount - 15))
+        {
+            return false;
+        }
+
+        if (static_cast<size_t>(outputEnd - *output) < literalCount)
+        {
+            return false;
+        }
+        memcpy(*output, literals, literalCount);
+        *output += literalCount;
+
+        if (matchLength > 0)
+        {
+            if (outputEnd - *output < 2)
+            {
+                return false;
+            }
+            *(*output)++ = static_cast<uint8_t>(offset);
+            *(*output)++ = static_cast<uint8_t>(offset >> 8);
+
+            if (matchToken >= 15 && !writeLength(output, outputEnd, matchToken - 15))
+            {
+                return false;
+            }
+        }
+
+        return true;
+    }
+
+    // Returns 0 if our block doesn't shrink, we store it raw instead.
+    size_t compressBlock(uint8_t const *data, size_t size, uint8_t *output)
+    {
+        uint32_t table[1 << HashBits];
+        for (uint32_t i = 0; i < (1 << HashBits); i++)
+        {
+            table[i] = InvalidPosition;
+        }
+
+        uint8_t *outputIter = output;
+        uint8_t const *outputEnd = output + size - 1; // We have to beat our raw size
+
+        size_t anchor = 0;
+        size_t position = 0;
+        while (position + MinMatchLength <= size)
+        {
+            uint32_t sequence = read32(data + position);
+            uint32_t hash = hashSequence(sequence);
+            uint32_t candidate = table[hash];
+            table[hash] = static_cast<uint32_t>(position);
+
+            if (candidate != InvalidPosition && read32(data + candidate) == sequence)
+            {
+                size_t matchLength = MinMatchLength;
+                while (position + matchLength < size && data[candidate + matchLength] == data[position + matchLength])
+                {
+                    matchLength++;
+                }
+
+                uint32_t offset = static_cast<uint32_t>(position - candidate);
+                if (!writeSequence(&outputIter, outputEnd, data + anchor, position - anchor, offset, matchLength))
+                {
+                    return 0;
+                }
+
+                position += matchLength;
+                anchor = position;
+            }
+            else
+            {
+                position++;
+            }
+        }
+
+        if (!writeSequence(&outputIter, outputEnd, data + anchor, size - anchor, 0, 0))
+        {
+            return 0;
+        }
+
+        return static_cast<size_t>(outputIter - output);
+    }
+
+    // Returns false if our length runs past the end of our block.
+    bool readLength(uint8_t const **data, uint8_t const *dataEnd, size_t *length)
+    {
+        uint8_t byte = 255;
+        while (byte == 255)
+        {
+            if (*data >= dataEnd)
+            {
+                return false;
+            }
+            byte = *(*data)++;
+            *length += byte;
+        }
+        return true;
+    }
+
+    // Returns false if our block is corrupt.
+    bool decompressBlock(uint8_t const *data, size_t size, uint8_t *output, size_t outputSize)
+    {
+        uint8_t const *dataEnd = data + size;
+        uint8_t *outputIter = output;
+        uint8_t *outputEnd = output + outputSize;
+
+        while (data < dataEnd)
+        {
+            uint8_t token = *data++;
+
+            size_t literalCount = token >> 4;
+            if (literalCount == 15 && !readLength(&data, dataEnd, &literalCount))
+            {
+                return false;
+            }
+
+            if (static_cast<size_t>(dataEnd - data) < literalCount || static_cast<size_t>(outputEnd - outputIter) < literalCount)
+            {
+                return false;
+            }
+            memcpy(outputIter, data, literalCount);
+            data += literalCount;
+            outputIter += literalCount;
+
+            // Our last sequence only has literals.
+            if (data == dataEnd)
+            {
+                break;
+            }
+
+            if (dataEnd - data < 2)
+            {
+                return false;
+            }
+            size_t offset = data[0] | (data[1] << 8);
+            data += 2;
+
+            size_t matchLength = token & 0x0F;
+            if (matchLength == 15 && !readLength(&data, dataEnd, &matchLength))
+            {
+                return false;
+            }
+            matchLength += MinMatchLength;
+
+            if (offset == 0 || offset > static_cast<size_t>(outputIter - output) || static_cast<size_t>(outputEnd - outputIter) < matchLength)
+            {
+                return false;
+            }
+
+            // Our match can overlap our output, copy it byte by byte.
+            uint8_t const *match = outputIter - offset;
+            for (size_t i = 0; i < matchLength; i++)
+            {
+                outputIter[i] = match[i];
+            }
+            outputIter += matchLength;
+        }
+
+        return outputIter == outputEnd;
+    }
+
+    uint32_t blockCount(size_t size)
+    {
+        return static_cast<uint32_t>((size + IB::CompressionBlockSize - 1) / IB::CompressionBlockSize);
+    }
+} // namespace
+
+namespace IB
+{
+    size_t compressionBound(size_t size)
+    {
+        // Our blocks are never larger than their raw size.
+        return sizeof(CompressionHeader) + sizeof(uint32_t) * blockCount(size) + size;
+    }
+
+    size_t compress(void const *data, size_t size, void *output)
+    {
+        CompressionHeader header = {};
+        header.Size = size;
+        header.BlockCount = blockCount(size);
+
+        uint8_t *outputBytes = reinterpret_cast<uint8_t *>(output);
+        memcpy(outputBytes, &header, sizeof(CompressionHeader));
+
+        uint32_t *blockSizes = reinterpret_cast<uint32_t *>(outputBytes + sizeof(CompressionHeader));
+        uint8_t *outputIter = outputBytes + sizeof(CompressionHeader) + sizeof(uint32_t) * header.BlockCount;
+
+        uint8_t const *dataBytes = reinterpret_cast<uint8_t const *>(data);
+        for (uint32_t i = 0; i < header.BlockCount; i++)
+        {
+            size_t offset = static_cast<size_t>(i) * CompressionBlockSize;
+            size_t rawSize = size - offset < CompressionBlockSize ? size - offset : CompressionBlockSize;
+
+            uint32_t blockSize = static_cast<uint32_t>(compressBlock(dataBytes + offset, rawSize, outputIter));
+            if (blockSize == 0)
+            {
+                memcpy(outputIter, dataBytes + offset, rawSize);
+                blockSize = static_cast<uint32_t>(rawSize) | RawBlockFlag;
+            }
+
+            memcpy(&blockSizes[i], &blockSize, sizeof(uint32_t));
+            outputIter += blockSize & ~RawBlockFlag;
+        }
+
+        return static_cast<size_t>(outputIter - outputBytes);
+    }
+
+    bool isCompressed(void const *data, size_t size)
+    {
+        if (size < sizeof(CompressionHeader))
+        {
+            return false;
+        }
+
+        CompressionHeader header;
+        memcpy(&header, data, sizeof(CompressionHeader));
+        return header.Magic == CompressionMagic && header.BlockSize == CompressionBlockSize && header.BlockCount == blockCount(static_cast<size_t>(header.Size));
+    }
+
+    size_t decompressedSize(void const *compressed)
+    {
+        CompressionHeader header;
+        memcpy(&header, compressed, sizeof(CompressionHeader));
+        return static_cast<size_t>(header.Size);
+    }
+
+    JobHandle decompressAsync(void const *compressed, size_t compressedSize, void *output)
+    {
+        IB_ASSERT(isCompressed(compressed, compressedSize), "Our data isn't compressed!");
+
+        CompressionHeader header;
+        memcpy(&header, compressed, sizeof(CompressionHeader));
+        if (header.BlockCount == 0)
+        {
+            return launchJob([]() { return JobResult::Complete; });
+        }
+
+        uint8_t const *compressedBytes = reinterpret_cast<uint8_t const *>(compressed);
+        uint8_t const *compressedEnd = compressedBytes + compressedSize;
+        uint32_t const *blockSizes = reinterpret_cast<uint32_t const *>(compressedBytes + sizeof(CompressionHeader));
+        uint8_t const *block = compressedBytes + sizeof(CompressionHeader) + sizeof(uint32_t) * header.BlockCount;
+        IB_ASSERT(block <= compressedEnd, "Our block table is truncated!");
+
+        // Our blocks are independent, decompress each of them on their own job.
+        JobHandle *blockJobs = reinterpret_cast<JobHandle *>(memoryAllocate(sizeof(JobHandle) * header.BlockCount, alignof(JobHandle)));
+        for (uint32_t i = 0; i < header.BlockCount; i++)
+        {
+            uint32_t blockSize;
+            memcpy(&blockSize, &blockSizes[i], sizeof(uint32_t));
+            bool raw = (blockSize & RawBlockFlag) != 0;
+            blockSize &= ~RawBlockFlag;
+            IB_ASSERT(blockSize <= static_cast<size_t>(compressedEnd - block), "Our compressed block is truncated!");
+
+            size_t offset = static_cast<size_t>(i) * CompressionBlockSize;
+            uint8_t *blockOutput = reinterpret_cast<uint8_t *>(output) + offset;
+            uint32_t outputSize = static_cast<uint32_t>(header.Size - offset < CompressionBlockSize ? header.Size - offset : CompressionBlockSize);
+
+            blockJobs[i] = launchJob([block, blockSize, blockOutput, outputSize, raw]() {
+                if (raw)
+                {
+                    IB_ASSERT(blockSize == outputSize, "Our raw block doesn't match our block size!");
+                    memcpy(blockOutput, block, outputSize);
+                }
+                else
+                {
+                    bool decompressed = decompressBlock(block, blockSize, blockOutput, outputSize);
+                    IB_ASSERT(decompressed, "Our compressed block is corrupt!");
+                }
+                return JobResult::Complete;
+            });
+            block += blockSize;
+        }
+
+        // Our dependencies are registered before continueJob returns, we can free our handles right away.
+        JobHandle decompressJob = continueJob([]() { return JobResult::Complete; }, blockJobs, header.BlockCount);
+        memoryFree(blockJobs);
+        return decompressJob;
+    }
+} // namespace IB
@@ -0,0 +1,53 @@
+#pragma once
+
+#include "IBEngineAPI.h"
+#include "IBJobs.h"
+#include <stdint.h>
+
+/*
+## Compression
+Our compiled assets are compressed by our content processor and decompressed by our asset loader as they're read.
+Loading is bound by the bytes we read far more often than by our CPU, a fast LZ codec trades a little CPU for a lot less I/O.
+
+Our data is split into independent blocks of CompressionBlockSize bytes, every block can be decompressed on its own job.
+Blocks that don't shrink are stored raw and simply copied.
+
+Layout: CompressionHeader, uint32_t BlockSizes[BlockCount], our blocks' data
+Our block sizes are the size of the block in our compressed data, RawBlockFlag is set if our block was stored raw.
+
+### Block format
+Our blocks are a sequence of literal runs followed by a match. (The same scheme as LZ4)
+- Token: high nibble is our literal count, low nibble is our match length minus MinMatchLength
+- Nibbles of 15 are followed by bytes that are added to them, until a byte isn't 255
+- Our literals
+- 2 byte offset back into our decompressed block, followed by our match length's extra bytes
+Our last sequence only has literals, it ends our block.
+*/
+
+namespace IB
+{
+    constexpr uint32_t CompressionMagic = 0x5A4C4249; // "IBLZ"
+    constexpr uint32_t CompressionBlockSize = 64 * 1024;
+    constexpr uint32_t RawBlockFlag = 0x80000000;
+
+    struct CompressionHeader
+    {
+        uint32_t Magic = CompressionMagic;
+        uint32_t BlockSize = CompressionBlockSize;
+        uint64_t Size = 0; // Decompressed
+        uint32_t BlockCount = 0;
+        uint32_t Padding = 0;
+    };
+
+    // Largest size our compressed data can take for our uncompressed size.
+    IB_API size_t compressionBound(size_t size);
+    // Returns the size of our compressed data. Our output must be at least compressionBound(size) large.
+    IB_API size_t compress(void const *data, size_t size, void *output); // Threadsafe
+
+    // Returns false if our data wasn't written by compress.
+    IB_API bool isCompressed(void const *data, size_t size);
+    IB_API size_t decompressedSize(void const *compressed);
+    // Decompresses our blocks in parallel, our handle completes once our output has been filled.
+    // Our compressed data and our output must survive until our handle completes.
+    IB_API JobHandle decompressAsync(void const *compressed, size_t compressedSize, void *output); // Threadsafe
+} // namespace IB
@@ -0,0 +1,920 @@
+#pragma once
+
+#include "IBAllocator.h"
+#include "IBLogging.h"
+#include "IBPlatform.h"
+
+#include <stdint.h>
+#include <string.h>
+#include <type_traits>
+#include <utility>
+#include <new>
+
+#if defined(_M_X64) || defined(_M_IX86) || defined(__SSE2__)
+#include <emmintrin.h>
+#define IB_CONTAINERS_SSE2
+#endif
+
+/*
+## Containers
+Our containers all allocate through IBAllocator so that their memory shows up in our statistics.
+Their last template parameter picks their allocator:
+- TaggedAllocator<Tag>: Our general allocator, our memory is tracked under our tag. (MemoryTag::General by default)
+- ScratchAllocator: Bumps through a scratch arena. Pass it to our constructor, our container is done once our arena is reset.
+
+- DynamicArray: Growable array, use it when you don't know your item count ahead of time.
+- SmallVector: DynamicArray with inline storage for its first few items, only touches the allocator once it outgrows them.
+- HashMap: Open addressing hash map, see below.
+- SlotMap: Densely packed items referenced through generational handles.
+
+Growing a container moves its items, don't hold on to pointers to items across an add unless you've reserved your memory.
+
+### HashMap
+Our hash map stores its keys and values inline in a single array and keeps a parallel array of control bytes.
+Each control byte is either empty, deleted or holds 7 bits of the key's hash.
+Lookups load a group of 16 control bytes at a time and compare all of them against our hash bits with SSE2,
+only keys with matching hash bits are ever compared. This keeps most probes within a single cache line of control bytes.
+
+Groups are probed with a triangular sequence which visits every group once our capacity is a power of two.
+*/
+
+namespace IB
+{
+    template <MemoryTag Tag = MemoryTag::General>
+    struct TaggedAllocator
+    {
+        void *allocate(size_t size, size_t alignment) { return memoryAllocate(size, alignment, Tag); }
+        // Our previous size is only needed by allocators that can't resize in place.
+        void *reallocate(void *memory, size_t, size_t size, size_t alignment) { return memoryReallocate(memory, size, alignment, Tag); }
+        void deallocate(void *memory) { memoryFree(memory, Tag); }
+    };
+
+    // Our arena releases our memory once it's reset, our freed memory simply stays in our arena until then.
+    struct ScratchAllocator
+    {
+        ScratchArena *Arena = nullptr;
+
+        void *allocate(size_t size, size_t alignment) { return memoryAllocate(Arena, size, alignment); }
+        void *reallocate(void *memory, size_t previousSize, size_t size, size_t alignment)
+        {
+            void *resized = memoryAllocate(Arena, size, alignment);
+            if (memory != nullptr)
+            {
+                memcpy(resized, memory, previousSize < size ? previousSize : size);
+            }
+            return resized;
+        }
+        void deallocate(void *) {}
+    };
+
+    // Moves count items from source to destination, source items are left destroyed.
+    template <typename T>
+    void relocateItems(T *destination, T *source, uint32_t count)
+    {
+        if (std::is_trivially_copyable<T>::value)
+        {
+            if (count > 0)
+            {
+                memcpy(static_cast<void *>(destination), source, sizeof(T) * count);
+            }
+        }
+        else
+        {
+            for (uint32_t i = 0; i < count; i++)
+            {
+                new (&destination[i]) T(std::move(source[i]));
+                source[i].~T();
+            }
+        }
+    }
+
+    // Our allocator is a private base, our default allocators don't take up any space.
+    template <typename T, typename TAllocator = TaggedAllocator<>>
+    class DynamicArray final : private TAllocator
+    {
+    public:
+        DynamicArray() = default;
+        explicit DynamicArray(TAllocator allocator)
+            : TAllocator(allocator)
+        {
+        }
+
+        DynamicArray(const DynamicArray &rhs)
+            : TAllocator(rhs)
+        {
+            operator=(rhs);
+        }
+
+        DynamicArray(DynamicArray &&rhs)
+            : TAllocator(rhs)
+        {
+            operator=(std::move(rhs));
+        }
+
+        DynamicArray &operator=(const DynamicArray &rhs)
+        {
+            if (this != &rhs)
+            {
+                clear();
+                reserve(rhs.ItemCount);
+                for (uint32_t i = 0; i < rhs.ItemCount; i++)
+                {
+                    new (&Buffer[i]) T(rhs.Buffer[i]);
+                }
+                ItemCount = rhs.ItemCount;
+            }
+            return *this;
+        }
+
+        DynamicArray &operator=(DynamicArray &&rhs)
+        {
+            if (this != &rhs)
+            {
+                clear();
+                TAllocator::deallocate(Buffer);
+
+                // Our buffer belongs to our allocator, it comes along with it.
+                static_cast<TAllocator &>(*this) = rhs;
+                Buffer = rhs.Buffer;
+                ItemCount = rhs.ItemCount;
+                MaxItemCount = rhs.MaxItemCount;
+                rhs.Buffer = nullptr;
+                rhs.ItemCount = 0;
+                rhs.MaxItemCount = 0;
+            }
+            return *this;
+        }
+
+        ~DynamicArray()
+        {
+            clear();
+            TAllocator::deallocate(Buffer);
+        }
+
+        template <typename... TArgs>
+        T &add(TArgs &&... args)
+        {
+            if (ItemCount + 1 > MaxItemCount)
+            {
+                reserve(MaxItemCount == 0 ? 1 : MaxItemCount * 2);
+            }
+
+            T *item = new (&Buffer[ItemCount]) T{std::forward<TArgs>(args)...};
+            ItemCount++;
+
+            return *item;
+        }
+
+        void reserve(uint32_t count)
+        {
+            if (count > MaxItemCount)
+            {
+                if (std::is_trivially_copyable<T>::value)
+                {
+                    // Trivially copyable items can simply follow our memory if it moves.
+                    Buffer = reinterpret_cast<T *>(TAllocator::reallocate(Buffer, sizeof(T) * MaxItemCount, sizeof(T) * count, alignof(T)));
+                }
+                else
+                {
+                    T *buffer = reinterpret_cast<T *>(TAllocator::allocate(sizeof(T) * count, alignof(T)));
+                    relocateItems(buffer, Buffer, ItemCount);
+                    TAllocator::deallocate(Buffer);
+                    Buffer = buffer;
+                }
+
+                MaxItemCount = count;
+            }
+        }
+
+        void resize(uint32_t count)
+        {
+            reserve(count);
+            for (uint32_t i = ItemCount; i < count; i++)
+            {
+                new (&Buffer[i]) T{};
+            }
+
+            for (uint32_t i = count; i < ItemCount; i++)
+            {
+                Buffer[i].~T();
+            }
+            ItemCount = count;
+        }
+
+        void removeLast()
+        {
+            IB_ASSERT(ItemCount > 0, "Removing from an empty array!");
+            ItemCount--;
+            Buffer[ItemCount].~T();
+        }
+
+        // Moves our last item into our removed item's place, this doesn't preserve our order.
+        void removeSwap(uint32_t i)
+        {
+            IB_ASSERT(i < ItemCount, "Index out of range!");
+            if (i != ItemCount - 1)
+            {
+                Buffer[i] = std::move(Buffer[ItemCount - 1]);
+            }
+            removeLast();
+        }
+
+        // Destroys our items but keeps our memory around.
+        void clear()
+        {
+            for (uint32_t i = 0; i < ItemCount; i++)
+            {
+                Buffer[i].~T();
+            }
+            ItemCount = 0;
+        }
+
+        T *data() { return Buffer; }
+        T const *data() const { return Buffer; }
+        T *begin() { return Buffer; }
+        T *end() { return Buffer + ItemCount; }
+        T const *begin() const { return Buffer; }
+        T const *end() const { return Buffer + ItemCount; }
+        T &operator[](uint32_t i)
+        {
+            IB_ASSERT(i < ItemCount, "Index out of range!");
+            return Buffer[i];
+        }
+        T const &operator[](uint32_t i) const
+        {
+            IB_ASSERT(i < ItemCount, "Index out of range!");
+            return Buffer[i];
+        }
+        uint32_t count() const { return ItemCount; }
+        uint32_t capacity() const { return MaxItemCount; }
+
+    private:
+        T *Buffer = nullptr;
+        uint32_t ItemCount = 0;
+        uint32_t MaxItemCount = 0;
+    };
+
+    template <typename T, uint32_t InlineCount, typename TAllocator = TaggedAllocator<>>
+    class SmallVector final : private TAllocator
+    {
+    public:
+        static_assert(InlineCount > 0, "Use a DynamicArray if you don't want any inline storage.");
+
+        SmallVector() = default;
+        explicit SmallVector(TAllocator allocator)
+            : TAllocator(allocator)
+        {
+        }
+
+        SmallVector(const SmallVector &rhs)
+            : TAllocator(rhs)
+        {
+            operator=(rhs);
+        }
+
+        SmallVector(SmallVector &&rhs)
+            : TAllocator(rhs)
+        {
+            operator=(std::move(rhs));
+        }
+
+        SmallVector &operator=(const SmallVector &rhs)
+        {
+            if (this != &rhs)
+            {
+                clear();
+                reserve(rhs.ItemCount);
+                for (uint32_t i = 0; i < rhs.ItemCount; i++)
+                {
+                    new (&Buffer[i]) T(rhs.Buffer[i]);
+                }
+                ItemCount = rhs.ItemCount;
+            }
+            return *this;
+        }
+
+        SmallVector &operator=(SmallVector &&rhs)
+        {
+            if (this != &rhs)
+            {
+                clear();
+                if (rhs.isInline())
+                {
+                    // Our inline items can't be stolen, move them one by one.
+                    reserve(rhs.ItemCount);
+                    relocateItems(Buffer, rhs.Buffer, rhs.ItemCount);
+                    ItemCount = rhs.ItemCount;
+                    rhs.ItemCount = 0;
+                }
+                else
+                {
+                    releaseBuffer();
+                    static_cast<TAllocator &>(*this) = rhs;
+                    Buffer = rhs.Buffer;
+                    ItemCount = rhs.ItemCount;
+                    MaxItemCount = rhs.MaxItemCount;
+                    rhs.Buffer = reinterpret_cast<T *>(rhs.InlineBuffer);
+                    rhs.ItemCount = 0;
+                    rhs.MaxItemCount = InlineCount;
+                }
+            }
+            return *this;
+        }
+
+        ~SmallVector()
+        {
+            clear();
+            releaseBuffer();
+        }
+
+        template <typename... TArgs>
+        T &add(TArgs &&... args)
+        {
+            if (ItemCount + 1 > MaxItemCount)
+            {
+                reserve(MaxItemCount * 2);
+            }
+
+            T *item = new (&Buffer[ItemCount]) T{std::forward<TArgs>(args)...};
+            ItemCount++;
+
+            return *item;
+        }
+
+        void reserve(uint32_t count)
+        {
+            if (count > MaxItemCount)
+            {
+                T *buffer = reinterpret_cast<T *>(TAllocator::allocate(sizeof(T) * count, alignof(T)));
+                relocateItems(buffer, Buffer, ItemCount);
+                releaseBuffer();
+                Buffer = buffer;
+                MaxItemCount = count;
+            }
+        }
+
+        void resize(uint32_t count)
+        {
+            reserve(count);
+            for (uint32_t i = ItemCount; i < count; i++)
+            {
+                new (&Buffer[i]) T{};
+            }
+
+            for (uint32_t i = count; i < ItemCount; i++)
+            {
+                Buffer[i].~T();
+            }
+            ItemCount = count;
+        }
+
+        void removeLast()
+        {
+            IB_ASSERT(ItemCount > 0, "Removing from an empty array!");
+            ItemCount--;
+            Buffer[ItemCount].~T();
+        }
+
+        // Moves our last item into our removed item's place, this doesn't preserve our order.
+        void removeSwap(uint32_t i)
+        {
+            IB_ASSERT(i < ItemCount, "Index out of range!");
+            if (i != ItemCount - 1)
+            {
+                Buffer[i] = std::move(Buffer[ItemCount - 1]);
+            }
+            removeLast();
+        }
+
+        // Destroys our items but keeps our memory around.
+        void clear()
+        {
+            for (uint32_t i = 0; i < ItemCount; i++)
+            {
+                Buffer[i].~T();
+            }
+            ItemCount = 0;
+        }
+
+        bool isInline() const { return Buffer == reinterpret_cast<T const *>(InlineBuffer); }
+        T *data() { return Buffer; }
+        T const *data() const { return Buffer; }
+        T *begin() { return Buffer; }
+        T *end() { return Buffer + ItemCount; }
+        T const *begin() const { return Buffer; }
+        T const *end() const { return Buffer + ItemCount; }
+        T &operator[](uint32_t i)
+        {
+            IB_ASSERT(i < ItemCount, "Index out of range!");
+            return Buffer[i];
+        }
+        T const &operator[](uint32_t i) const
+        {
+            IB_ASSERT(i < ItemCount, "Index out of range!");
+            return Buffer[i];
+        }
+        uint32_t count() const { return ItemCount; }
+        uint32_t capacity() const { return MaxItemCount; }
+
+    private:
+        void releaseBuffer()
+        {
+            if (!isInline())
+            {
+                TAllocator::deallocate(Buffer);
+                Buffer = reinterpret_cast<T *>(InlineBuffer);
+                MaxItemCount = InlineCount;
+            }
+        }
+
+        alignas(T) uint8_t InlineBuffer[sizeof(T) * InlineCount];
+        T *Buffer = reinterpret_cast<T *>(InlineBuffer);
+        uint32_t ItemCount = 0;
+        uint32_t MaxItemCount = InlineCount;
+    };
+
+    template <typename T>
+    uint64_t hashBits(T value)
+    {
+        static_assert(std::is_integral<T>::value || std::is_enum<T>::value, "Provide a hash functor for this key type.");
+        return static_cast<uint64_t>(value);
+    }
+
+    template <typename T>
+    uint64_t hashBits(T *value)
+    {
+        return static_cast<uint64_t>(reinterpret_cast<uintptr_t>(value));
+    }
+
+    // Default hash for integers, enums and pointers.
+    // Mixes all of our bits since our hash map uses both the low and high bits of our hash.
+    template <typename T>
+    struct Hash
+    {
+        uint64_t operator()(T const &value) const
+        {
+            uint64_t hash = hashBits(value);
+            hash ^= hash >> 33;
+            hash *= 0xff51afd7ed558ccdull;
+            hash ^= hash >> 33;
+            hash *= 0xc4ceb9fe1a85ec53ull;
+            hash ^= hash >> 33;
+            return hash;
+        }
+    };
+
+    template <typename TKey, typename TValue, typename THash = Hash<TKey>, typename TAllocator = TaggedAllocator<>>
+    class HashMap final : private TAllocator
+    {
+    public:
+        struct Entry
+        {
+            TKey Key;
+            TValue Value;
+        };
+
+        HashMap() = default;
+        explicit HashMap(TAllocator allocator)
+            : TAllocator(allocator)
+        {
+        }
+
+        HashMap(const HashMap &) = delete;
+        HashMap &operator=(const HashMap &) = delete;
+
+        HashMap(HashMap &&rhs)
+            : TAllocator(rhs)
+        {
+            operator=(std::move(rhs));
+        }
+
+        HashMap &operator=(HashMap &&rhs)
+        {
+            if (this != &rhs)
+            {
+                clear();
+                TAllocator::deallocate(Control);
+
+                static_cast<TAllocator &>(*this) = rhs;
+                Control = rhs.Control;
+                Entries = rhs.Entries;
+                Capacity = rhs.Capacity;
+                EntryCount = rhs.EntryCount;
+                DeletedCount = rhs.DeletedCount;
+                rhs.Control = nullptr;
+                rhs.Entries = nullptr;
+                rhs.Capacity = 0;
+                rhs.EntryCount = 0;
+                rhs.DeletedCount = 0;
+            }
+            return *this;
+        }
+
+        ~HashMap()
+        {
+            clear();
+            TAllocator::deallocate(Control);
+        }
+
+        TValue *find(TKey const &key)
+        {
+            uint32_t index = findIndex(key, THash{}(key));
+            return index != InvalidIndex ? &Entries[index].Value : nullptr;
+        }
+
+        TValue const *find(TKey const &key) const
+        {
+            uint32_t index = findIndex(key, THash{}(key));
+            return index != InvalidIndex ? &Entries[index].Value : nullptr;
+        }
+
+        // Key must not already be in our map.
+        template <typename... TArgs>
+        TValue &add(TKey const &key, TArgs &&... args)
+        {
+            uint64_t hash = THash{}(key);
+            IB_ASSERT(findIndex(key, hash) == InvalidIndex, "Key is already in our map!");
+            return addInternal(key, hash, std::forward<TArgs>(args)...);
+        }
+
+        TValue &findOrAdd(TKey const &key)
+        {
+            uint64_t hash = THash{}(key);
+            uint32_t index = findIndex(key, hash);
+            if (index != InvalidIndex)
+            {
+                return Entries[index].Value;
+            }
+            return addInternal(key, hash);
+        }
+
+        // Returns false if our key wasn't in our map.
+        bool remove(TKey const &key)
+        {
+            uint32_t index = findIndex(key, THash{}(key));
+            if (index == InvalidIndex)
+            {
+                return false;
+            }
+
+            Entries[index].~Entry();
+            Control[index] = DeletedControl;
+            EntryCount--;
+            DeletedCount++;
+            return true;
+        }
+
+        // Destroys our entries but keeps our memory around.
+        void clear()
+        {
+            for (uint32_t i = 0; i < Capacity; i++)
+            {
+                if (isFull(Control[i]))
+                {
+                    Entries[i].~Entry();
+                }
+            }
+
+            if (Control != nullptr)
+            {
+                memset(Control, EmptyControl, Capacity);
+            }
+            EntryCount = 0;
+            DeletedCount = 0;
+        }
+
+        // Makes sure we can hold count entries without having to grow.
+        void reserve(uint32_t count)
+        {
+            uint32_t capacity = Capacity == 0 ? GroupSize : Capacity;
+            while (count > maxLoad(capacity))
+            {
+                capacity *= 2;
+            }
+
+            if (capacity > Capacity)
+            {
+                rehash(capacity);
+            }
+        }
+
+        uint32_t count() const { return EntryCount; }
+
+        // Visits our entries in no particular order.
+        class Iterator
+        {
+        public:
+            Iterator(HashMap *map, uint32_t index)
+                : Map(map)
+                , Index(index)
+            {
+                skipEmpty();
+            }
+
+            Entry &operator*() const { return Map->Entries[Index]; }
+            Entry *operator->() const { return &Map->Entries[Index]; }
+            Iterator &operator++()
+            {
+                Index++;
+                skipEmpty();
+                return *this;
+            }
+            bool operator!=(Iterator const &rhs) const { return Index != rhs.Index; }
+
+        private:
+            void skipEmpty()
+            {
+                while (Index < Map->Capacity && !isFull(Map->Control[Index]))
+                {
+                    Index++;
+                }
+            }
+
+            HashMap *Map;
+            uint32_t Index;
+        };
+
+        Iterator begin() { return Iterator(this, 0); }
+        Iterator end() { return Iterator(this, Capacity); }
+
+    private:
+        static constexpr uint32_t GroupSize = 16;
+        static constexpr uint32_t InvalidIndex = UINT32_MAX;
+        static constexpr uint8_t EmptyControl = 0x80;
+        static constexpr uint8_t DeletedControl = 0xFE;
+
+        // We keep our load under 7/8ths, probing stays short while our groups waste little memory.
+        static uint32_t maxLoad(uint32_t capacity) { return capacity - capacity / 8; }
+        static bool isFull(uint8_t control) { return (control & 0x80) == 0; }
+        static uint8_t hashControl(uint64_t hash) { return static_cast<uint8_t>(hash >> 57); }
+
+        // Returns a bit for every control byte in our group that matches our value.
+        static uint32_t matchGroup(uint8_t const *group, uint8_t value)
+        {
+#ifdef IB_CONTAINERS_SSE2
+            __m128i controls = _mm_load_si128(reinterpret_cast<__m128i const *>(group));
+            __m128i matches = _mm_cmpeq_epi8(controls, _mm_set1_epi8(static_cast<char>(value)));
+            return static_cast<uint32_t>(_mm_movemask_epi8(matches));
+#else
+            uint32_t mask = 0;
+            for (uint32_t i = 0; i < GroupSize; i++)
+            {
+                mask |= group[i] == value ? 1u << i : 0u;
+            }
+            return mask;
+#endif // IB_CONTAINERS_SSE2
+        }
+
+        // Returns a bit for every empty or deleted control byte in our group.
+        static uint32_t matchAvailable(uint8_t const *group)
+        {
+#ifdef IB_CONTAINERS_SSE2
+            // Empty and deleted both have their high bit set.
+            __m128i controls = _mm_load_si128(reinterpret_cast<__m128i const *>(group));
+            return static_cast<uint32_t>(_mm_movemask_epi8(controls));
+#else
+            uint32_t mask = 0;
+            for (uint32_t i = 0; i < GroupSize; i++)
+            {
+                mask |= isFull(group[i]) ? 0u : 1u << i;
+            }
+            return mask;
+#endif // IB_CONTAINERS_SSE2
+        }
+
+        uint32_t findIndex(TKey const &key, uint64_t hash) const
+        {
+            if (Capacity == 0)
+            {
+                return InvalidIndex;
+            }
+
+            uint8_t control = hashControl(hash);
+            uint32_t groupMask = Capacity / GroupSize - 1;
+            uint32_t group = static_cast<uint32_t>(hash) & groupMask;
+            for (uint32_t probe = 1; probe <= groupMask + 1; probe++)
+            {
+                uint8_t const *groupControl = Control + group * GroupSize;
+                for (uint32_t matches = matchGroup(groupControl, control); matches != 0; matches &= matches - 1)
+                {
+                    uint32_t index = group * GroupSize + countTrailingZeros(matches);
+                    if (Entries[index].Key == key)
+                    {
+                        return index;
+                    }
+                }
+
+                // An empty slot ends our probe sequence, our key would have been placed here.
+                if (matchGroup(groupControl, EmptyControl) != 0)
+                {
+                    return InvalidIndex;
+                }
+
+                group = (group + probe) & groupMask;
+            }
+
+            return InvalidIndex;
+        }
+
+        uint32_t findAvailableIndex(uint64_t hash) const
+        {
+            uint32_t groupMask = Capacity / GroupSize - 1;
+            uint32_t group = static_cast<uint32_t>(hash) & groupMask;
+            for (uint32_t probe = 1;; probe++)
+            {
+                uint32_t available = matchAvailable(Control + group * GroupSize);
+                if (available != 0)
+                {
+                    return group * GroupSize + countTrailingZeros(available);
+                }
+
+                group = (group + probe) & groupMask;
+            }
+        }
+
+        template <typename... TArgs>
+        TValue &addInternal(TKey const &key, uint64_t hash, TArgs &&... args)
+        {
+            if (EntryCount + DeletedCount + 1 > maxLoad(Capacity))
+            {
+                // If most of our load is deleted entries, rehashing in place is enough to clean them up.
+                uint32_t capacity = Capacity == 0 ? GroupSize : Capacity;
+                rehash(EntryCount + 1 > capacity / 2 ? capacity * 2 : capacity);
+            }
+
+            uint32_t index = findAvailableIndex(hash);
+            if (Control[index] == DeletedControl)
+            {
+                DeletedCount--;
+            }
+
+            Control[index] = hashControl(hash);
+            Entry *entry = new (&Entries[index]) Entry{key, TValue{std::forward<TArgs>(args)...}};
+            EntryCount++;
+            return entry->Value;
+        }
+
+        void rehash(uint32_t capacity)
+        {
+            uint8_t *oldControl = Control;
+            Entry *oldEntries = Entries;
+            uint32_t oldCapacity = Capacity;
+
+            // Our control bytes and entries share an allocation, control bytes first.
+            size_t entriesOffset = (capacity + alignof(Entry) - 1) & ~(alignof(Entry) - 1);
+            size_t alignment = alignof(Entry) > GroupSize ? alignof(Entry) : GroupSize;
+            Control = reinterpret_cast<uint8_t *>(TAllocator::allocate(entriesOffset + sizeof(Entry) * capacity, alignment));
+            Entries = reinterpret_cast<Entry *>(Control + entriesOffset);
+            Capacity = capacity;
+            DeletedCount = 0;
+            memset(Control, EmptyControl, capacity);
+
+            for (uint32_t i = 0; i < oldCapacity; i++)
+            {
+                if (isFull(oldControl[i]))
+                {
+                    uint64_t hash = THash{}(oldEntries[i].Key);
+                    uint32_t index = findAvailableIndex(hash);
+                    Control[index] = hashControl(hash);
+                    relocateItems(&Entries[index], &oldEntries[i], 1);
+                }
+            }
+
+            TAllocator::deallocate(oldControl);
+        }
+
+        uint8_t *Control = nullptr;
+        Entry *Entries = nullptr;
+        uint32_t Capacity = 0; // Always a multiple of our group size and a power of 2
+        uint32_t EntryCount = 0;
+        uint32_t DeletedCount = 0;
+    };
+
+    struct SlotHandle
+    {
+        uint32_t Index = 0;
+        uint32_t Generation = 0; // 0 is never a valid generation
+    };
+
+    // Items are kept densely packed for iteration while our handles stay valid as items are removed.
+    // Removed handles are detected through their generation.
+    template <typename T, typename TAllocator = TaggedAllocator<>>
+    class SlotMap final
+    {
+    public:
+        SlotMap() = default;
+        explicit SlotMap(TAllocator allocator)
+            : Items(allocator)
+            , ItemSlots(allocator)
+            , Slots(allocator)
+        {
+        }
+
+        template <typename... TArgs>
+        SlotHandle add(TArgs &&... args)
+        {
+            uint32_t slotIndex;
+            if (FreeSlot != InvalidIndex)
+            {
+                slotIndex = FreeSlot;
+                FreeSlot = Slots[slotIndex].Index;
+            }
+            else
+            {
+                slotIndex = Slots.count();
+                Slots.add(Slot{InvalidIndex, 0});
+            }
+
+            Slot &slot = Slots[slotIndex];
+            slot.Index = Items.count();
+            slot.Generation++;
+            Items.add(std::forward<TArgs>(args)...);
+            ItemSlots.add(slotIndex);
+
+            return SlotHandle{slotIndex, slot.Generation};
+        }
+
+        // Returns nullptr if our handle was removed.
+        T *find(SlotHandle handle)
+        {
+            uint32_t index = findIndex(handle);
+            return index != InvalidIndex ? &Items[index] : nullptr;
+        }
+
+        T const *find(SlotHandle handle) const
+        {
+            uint32_t index = findIndex(handle);
+            return index != InvalidIndex ? &Items[index] : nullptr;
+        }
+
+        void remove(SlotHandle handle)
+        {
+            IB_ASSERT(find(handle) != nullptr, "Removing an invalid handle!");
+
+            Slot &slot = Slots[handle.Index];
+            uint32_t itemIndex = slot.Index;
+
+            // Keep our items packed by moving our last item into our removed item's place.
+            uint32_t lastSlot = ItemSlots[ItemSlots.count() - 1];
+            Items.removeSwap(itemIndex);
+            ItemSlots.removeSwap(itemIndex);
+            Slots[lastSlot].Index = itemIndex;
+
+            // Bumping our generation invalidates any outstanding handles.
+            slot.Generation++;
+            slot.Index = FreeSlot;
+            FreeSlot = handle.Index;
+        }
+
+        void clear()
+        {
+            for (uint32_t i = 0; i < ItemSlots.count(); i++)
+            {
+                Slot &slot = Slots[ItemSlots[i]];
+                slot.Generation++;
+                slot.Index = FreeSlot;
+                FreeSlot = ItemSlots[i];
+            }
+            Items.clear();
+            ItemSlots.clear();
+        }
+
+        void reserve(uint32_t count)
+        {
+            Items.reserve(count);
+            ItemSlots.reserve(count);
+            Slots.reserve(count);
+        }
+
+        T *data() { return Items.data(); }
+        T *begin() { return Items.begin(); }
+        T *end() { return Items.end(); }
+        T const *begin() const { return Items.begin(); }
+        T const *end() const { return Items.end(); }
+        uint32_t count() const { return Items.count(); }
+
+    private:
+        static constexpr uint32_t InvalidIndex = UINT32_MAX;
+
+        struct Slot
+        {
+            uint32_t Index; // Index of our item or our next free slot
+            uint32_t Generation;
+        };
+
+        // Returns the index of our handle's item, InvalidIndex if our handle was removed.
+        uint32_t findIndex(SlotHandle handle) const
+        {
+            if (handle.Index < Slots.count() && Slots[handle.Index].Generation == handle.Generation && handle.Generation != 0)
+            {
+                return Slots[handle.Index].Index;
+            }
+            return InvalidIndex;
+        }
+
+        DynamicArray<T, TAllocator> Items;
+        DynamicArray<uint32_t, TAllocator> ItemSlots; // Slot of each of our items
+        DynamicArray<Slot, TAllocator> Slots;
+        uint32_t FreeSlot = InvalidIndex;
+    };
+} // namespace IB
@@ -1,96 +1,19 @@
 #include "IBEntity.h"
 #include "IBAllocator.h"
+#include "IBContainers.h"
+
+#include <string.h>
 
 namespace IB
 {
     namespace
     {
-        template< typename T >
-        class DynamicArray final
-        {
-        public:
-            DynamicArray() = default;
-            DynamicArray(const DynamicArray& rhs)
-            {
-                operator=(rhs);
-            }
-
-            DynamicArray& operator=(const DynamicArray& rhs)
-            {
-                clear();
-                reserve(rhs.MaxItemCount);
-                for (uint32_t i = 0; i < rhs.ItemCount; i++)
-                {
-                    new(&(data()[i])) T(rhs[i]);
-                }
-                ItemCount = rhs.ItemCount;
-                return *this;
-            }
-
-            ~DynamicArray()
-            {
-                clear();
-            }
-
-            template< typename... TArgs >
-            T& add(TArgs&&... args)
-            {
-                if (ItemCount + 1 > MaxItemCount)
-                {
-                    uint32_t nextCount = MaxItemCount == 0 ? 1 : MaxItemCount * 2;
-                    reserve(nextCount);
-                }
-
-                T* item = new(&(data()[ItemCount])) T{ std::forward<TArgs>(args)... };
-                ItemCount++;
-
-                return *item;
-            }
-
-            void reserve(uint32_t count)
-            {
-                if (count > MaxItemCount)
-                {
-                    void* newBuffer = memoryAllocate(count * sizeof(T), alignof(T));
-                    // memcpy is OK here because we're creating an identical
-                    // bitwise copy of our object to another memory location.
-                    // This is not creating a copy, we're essentially moving our object's location in memory.
-                    // If we were creating a copy, we would want to use our copy constructor.
-                    memcpy(newBuffer, Buffer, ItemCount * sizeof(T));
-
-                    memoryFree(Buffer);
-                    Buffer = newBuffer;
-
-                    MaxItemCount = count;
-                }
-            }
-
-            void clear()
-            {
-                for (uint32_t i = 0; i < MaxItemCount; i++)
-                {
-                    data()[i].~T();
-                }
-                memoryFree(Buffer);
-                Buffer = nullptr;
-                ItemCount = 0;
-                MaxItemCount = 0;
-            }
-
-            T* data() const { return reinterpret_cast<T*>(Buffer); }
-            T& operator[](uint32_t i) const { return data()[i]; }
-            uint32_t count() const { return ItemCount; }
-        private:
-            void* Buffer = nullptr;
-            uint32_t ItemCount = 0;
-            uint32_t MaxItemCount = 0;
-        };
-
         struct Entity
         {
             struct Property
             {
                 Asset::FourCC Type;
+                Asset::StreamerIndex Streamer; // Looked up once when our property is added
                 PropertyHandle Handle;
             };
 
@@ -98,6 +21,24 @@ namespace IB
         };
 
         ThreadSafePool<Entity> ActiveEntities;
+
+        struct Cell
+        {
+            DynamicArray<Entity *> Entities;
+        };
+
+        ThreadSafePool<Cell> ActiveCells;
+
+        void unloadEntity(Entity *entity)
+        {
+            for (uint32_t i = 0; i < entity->Properties.count(); i++)
+            {
+                IB::Asset::unloadSubAssetThreadSafe(toAssetHandle(entity->Properties[i].Handle), entity->Properties[i].Streamer);
+            }
+
+            ActiveEntities.remove(*entity);
+        }
+
         class EntityAssetStreamer : public IB::Asset::IStreamer
         {
         public:
@@ -125,11 +66,14 @@ namespace IB
                         Entity::Property& entityProperty = entity.Properties.add();
 
                         fromBinary(&context->Stream, &entityProperty.Type);
+                        entityProperty.Streamer = IB::Asset::findStreamer(entityProperty.Type);
+                        IB::Asset::ContentHash contentHash;
+                        fromBinary(&context->Stream, &contentHash);
                         uint32_t offset;
                         fromBinary(&context->Stream, &offset);
 
                         // Passing pointer to dynamic array item is OK here. We've reserved the memory and will not resize until the load is complete.
-                        loadHandles[handleCount++] = IB::Asset::loadSubAssetAsync(context->Stream, entityProperty.Type, { 0 },
+                        loadHandles[handleCount++] = IB::Asset::loadSubAssetAsync(context->Stream, offset, entityProperty.Streamer, { 0 }, contentHash,
                             [](void *data, IB::Asset::AssetHandle asset)
                             {
                                 *reinterpret_cast<IB::PropertyHandle *>(data) = toPropertyHandle(asset);
@@ -154,36 +98,298 @@ namespace IB
                 {
                     toBinary(context->Stream, entity->Properties[i].Type);
 
+                    size_t hashOffset = context->Stream->Size;
+                    toBinary(context->Stream, IB::Asset::ContentHash{});
+                    size_t sizeOffset = context->Stream->Size;
                     uint32_t dummyWriteSize = 0;
                     toBinary(context->Stream, dummyWriteSize);
-                    uint32_t writeStart = flush(context->Stream);
-                    IB::Asset::saveSubAssetThreadSafe(context->Stream, entity->Properties[i].Type, toAssetHandle(entity->Properties[i].Handle));
-                    uint32_t writeEnd = flush(context->Stream);
+                    IB::Asset::saveSubAssetThreadSafe(context->Stream, entity->Properties[i].Streamer, toAssetHandle(entity->Properties[i].Handle));
 
-                    // Write our written size right before our sub asset.
-                    uint32_t writeSize = writeEnd - writeStart;
-                    IB::writeToFile(context->Stream->File, &writeSize, sizeof(uint32_t), writeStart - sizeof(uint32_t));
+                    // Patch our written size and content hash right before our sub asset.
+                    uint32_t writeSize = static_cast<uint32_t>(context->Stream->Size - sizeOffset - sizeof(uint32_t));
+                    patchBinary(context->Stream, sizeOffset, writeSize);
+                    patchBinary(context->Stream, hashOffset, IB::Asset::hashContent(context->Stream->Memory + sizeOffset + sizeof(uint32_t), writeSize));
                 }
             }
 
             void unloadThreadSafe(IB::Asset::AssetHandle assetHandle) override
             {
-                Entity* entity = reinterpret_cast<Entity*>(assetHandle.Value);
-                for (uint32_t i = 0; i < entity->Properties.count(); i++)
+                unloadEntity(reinterpret_cast<Entity*>(assetHandle.Value));
+            }
+        };
+
+        // Our cell's properties of a single type, handed to their streamer as one batch.
+        struct PropertyGroup
+        {
+            IB::Asset::BatchLoadContext Batch; // Loads our group's payloads
+            IB::JobHandle Handle; // Completes once our group's payloads are loaded
+            uint32_t PropertyCount;
+            uint32_t *EntityIndices;
+            uint32_t *PayloadIndices;
+        };
+
+        // Only lives until our cell is loaded.
+        struct CellLoad
+        {
+            Cell *LoadedCell;
+            DynamicArray<PropertyGroup> Groups;
+            uint32_t WaitedGroupCount;
+        };
+
+        class CellAssetStreamer : public IB::Asset::IStreamer
+        {
+        public:
+            IB::Asset::LoadContinuation loadAsync(IB::Asset::LoadContext *context) override
+            {
+                enum State
                 {
-                    IB::Asset::unloadSubAssetThreadSafe(toAssetHandle(entity->Properties[i].Handle), entity->Properties[i].Type);
+                    LoadProperties = 0,
+                    WaitForGroups
+                };
+
+                if (context->State == LoadProperties)
+                {
+                    uint32_t entityCount;
+                    fromBinary(&context->Stream, &entityCount);
+                    uint32_t groupCount;
+                    fromBinary(&context->Stream, &groupCount);
+
+                    Cell& cell = ActiveCells.add();
+                    cell.Entities.reserve(entityCount);
+                    for (uint32_t i = 0; i < entityCount; i++)
+                    {
+                        cell.Entities.add(&ActiveEntities.add());
+                    }
+
+                    CellLoad* cellLoad = allocate<CellLoad>();
+                    cellLoad->LoadedCell = &cell;
+                    cellLoad->WaitedGroupCount = 0;
+                    // Our batches reference our groups until they're loaded, we can't let our array move them.
+                    cellLoad->Groups.reserve(groupCount);
+
+                    for (uint32_t i = 0; i < groupCount; i++)
+                    {
+                        PropertyGroup& group = cellLoad->Groups.add();
+                        fromBinary(&context->Stream, &group.Batch.Type);
+                        fromBinary(&context->Stream, &group.PropertyCount);
+                        fromBinary(&context->Stream, &group.Batch.Count);
+                        uint32_t groupSize;
+                        fromBinary(&context->Stream, &groupSize);
+
+                        uint32_t propertyCount = group.PropertyCount;
+                        uint32_t payloadCount = group.Batch.Count;
+                        group.EntityIndices = allocateArray<uint32_t>(propertyCount);
+                        fromBinary(&context->Stream, group.EntityIndices, sizeof(uint32_t) * propertyCount);
+                        group.PayloadIndices = allocateArray<uint32_t>(propertyCount);
+                        fromBinary(&context->Stream, group.PayloadIndices, sizeof(uint32_t) * propertyCount);
+                        Asset::ContentHash* contentHashes = allocateArray<Asset::ContentHash>(payloadCount);
+                        fromBinary(&context->Stream, contentHashes, sizeof(Asset::ContentHash) * payloadCount);
+
+                        // Our shared payloads are loaded without a parent, the rest belong to a single property.
+                        Asset::AssetHandle* parentAssets = allocateArray<Asset::AssetHandle>(payloadCount);
+                        bool* payloadReferenced = allocateArray<bool>(payloadCount, false);
+                        for (uint32_t property = 0; property < propertyCount; property++)
+                        {
+                            IB_ASSERT(group.EntityIndices[property] < entityCount, "Our property belongs to an entity that isn't in our cell!");
+                            IB_ASSERT(group.PayloadIndices[property] < payloadCount, "Our property's payload isn't in our group!");
+
+                            uint32_t payload = group.PayloadIndices[property];
+                            if (payloadReferenced[payload])
+                            {
+                                parentAssets[payload] = { 0 };
+                            }
+                            else
+                            {
+                                parentAssets[payload] = { reinterpret_cast<uint64_t>(cell.Entities[group.EntityIndices[property]]) };
+                            }
+                            payloadReferenced[payload] = true;
+                        }
+                        deallocateArray(payloadReferenced, payloadCount);
+                        group.Batch.ParentAssets = parentAssets;
+                        group.Batch.Assets = allocateArray<Asset::AssetHandle>(payloadCount);
+                        group.Batch.ContentHashes = contentHashes;
+
+                        // Our properties' data stays in our cell's buffer, our streamers can reference it until we unload.
+                        size_t tableSize = sizeof(uint32_t) * 2 * propertyCount + sizeof(Asset::ContentHash) * payloadCount;
+                        group.Batch.Stream = context->Stream;
+                        advance(&context->Stream, groupSize - tableSize);
+
+                        group.Handle = IB::Asset::loadSubAssetBatchAsync(&group.Batch);
+                    }
+
+                    context->Data = reinterpret_cast<uint64_t>(cellLoad);
+                }
+
+                CellLoad* cellLoad = reinterpret_cast<CellLoad*>(context->Data);
+
+                // Our cell can have more property types than we can wait on at once, we wait on our groups in chunks.
+                uint32_t groupCount = cellLoad->Groups.count();
+                if (cellLoad->WaitedGroupCount < groupCount)
+                {
+                    IB::JobHandle loadHandles[IB::Asset::MaxDependencyCount];
+                    uint32_t waitCount = 0;
+                    for (; waitCount < IB::Asset::MaxDependencyCount && cellLoad->WaitedGroupCount < groupCount; waitCount++)
+                    {
+                        loadHandles[waitCount] = cellLoad->Groups[cellLoad->WaitedGroupCount++].Handle;
+                    }
+                    return IB::Asset::wait(loadHandles, waitCount, WaitForGroups);
+                }
+
+                Cell* cell = cellLoad->LoadedCell;
+                for (PropertyGroup& group : cellLoad->Groups)
+                {
+                    Asset::StreamerIndex streamer = IB::Asset::findStreamer(group.Batch.Type);
+                    uint32_t propertyCount = group.PropertyCount;
+                    uint32_t payloadCount = group.Batch.Count;
+
+                    // Each of our loaded payloads came with one user, the rest of its properties add their own.
+                    bool* payloadUsed = allocateArray<bool>(payloadCount, false);
+                    for (uint32_t property = 0; property < propertyCount; property++)
+                    {
+                        uint32_t payload = group.PayloadIndices[property];
+                        Asset::AssetHandle asset = group.Batch.Assets[payload];
+                        if (payloadUsed[payload])
+                        {
+                            IB::Asset::retainSubAssetThreadSafe(asset, streamer);
+                        }
+                        payloadUsed[payload] = true;
+
+                        Entity* entity = cell->Entities[group.EntityIndices[property]];
+                        entity->Properties.add(group.Batch.Type, streamer, toPropertyHandle(asset));
+                    }
+
+                    deallocateArray(payloadUsed, payloadCount);
+                    deallocateArray(group.EntityIndices, propertyCount);
+                    deallocateArray(group.PayloadIndices, propertyCount);
+                    deallocateArray(group.Batch.ParentAssets, payloadCount);
+                    deallocateArray(group.Batch.Assets, payloadCount);
+                    deallocateArray(group.Batch.ContentHashes, payloadCount);
                 }
+                deallocate(cellLoad);
 
-                ActiveEntities.remove(*entity);
+                return IB::Asset::complete({ reinterpret_cast<uint64_t>(cell) });
+            }
+
+            void saveThreadSafe(IB::Asset::SaveContext *context) override
+            {
+                Cell* cell = reinterpret_cast<Cell*>(context->Asset.Value);
+
+                // Our groups are written in the order we first see their type.
+                DynamicArray<Asset::FourCC> types;
+                for (Entity* entity : cell->Entities)
+                {
+                    for (Entity::Property& entityProperty : entity->Properties)
+                    {
+                        bool found = false;
+                        for (uint32_t i = 0; i < types.count() && !found; i++)
+                        {
+                            found = types[i].Value == entityProperty.Type.Value;
+                        }
+
+                        if (!found)
+                        {
+                            types.add(entityProperty.Type);
+                        }
+                    }
+                }
+
+                toBinary(context->Stream, cell->Entities.count());
+                toBinary(context->Stream, types.count());
+                for (Asset::FourCC type : types)
+                {
+                    Asset::StreamerIndex streamer = IB::Asset::findStreamer(type);
+                    bool sharePayloads = IB::Asset::sharesIdenticalAssets(streamer);
+
+                    DynamicArray<uint32_t> entityIndices;
+                    DynamicArray<uint32_t> payloadIndices;
+                    DynamicArray<Asset::ContentHash> contentHashes;
+                    DynamicArray<size_t> payloadOffsets;
+                    HashMap<uint64_t, uint32_t> payloadsByHash;
+                    Serialization::BufferStream payloads;
+                    for (uint32_t entityIndex = 0; entityIndex < cell->Entities.count(); entityIndex++)
+                    {
+                        for (Entity::Property& entityProperty : cell->Entities[entityIndex]->Properties)
+                        {
+                            if (entityProperty.Type.Value != type.Value)
+                            {
+                                continue;
+                            }
+
+                            size_t sizeOffset = payloads.Size;
+                            uint32_t dummyWriteSize = 0;
+                            toBinary(&payloads, dummyWriteSize);
+                            IB::Asset::saveSubAssetThreadSafe(&payloads, streamer, toAssetHandle(entityProperty.Handle));
+
+                            uint32_t writeSize = static_cast<uint32_t>(payloads.Size - sizeOffset - sizeof(uint32_t));
+                            patchBinary(&payloads, sizeOffset, writeSize);
+                            Asset::ContentHash contentHash = IB::Asset::hashContent(payloads.Memory + sizeOffset + sizeof(uint32_t), writeSize);
+
+                            // Our identical payloads are only written once if our streamer shares them when they're loaded.
+                            // Our hashes can collide, a payload is only shared if its bytes match as well.
+                            uint32_t* sharedPayload = sharePayloads ? payloadsByHash.find(contentHash.Value) : nullptr;
+                            bool identical = false;
+                            if (sharedPayload != nullptr)
+                            {
+                                size_t sharedOffset = payloadOffsets[*sharedPayload];
+                                uint32_t sharedSize;
+                                memcpy(&sharedSize, payloads.Memory + sharedOffset, sizeof(uint32_t));
+                                identical = sharedSize == writeSize && memcmp(payloads.Memory + sharedOffset + sizeof(uint32_t), payloads.Memory + sizeOffset + sizeof(uint32_t), writeSize) == 0;
+                            }
+
+                            if (identical)
+                            {
+                                payloads.Size = sizeOffset;
+                                payloadIndices.add(*sharedPayload);
+                            }
+                            else
+                            {
+                                if (sharedPayload == nullptr && sharePayloads)
+                                {
+                                    payloadsByHash.add(contentHash.Value, contentHashes.count());
+                                }
+                                payloadIndices.add(contentHashes.count());
+                                payloadOffsets.add(sizeOffset);
+                                // Our colliding payload is saved without its hash, it's loaded on its own instead of being shared.
+                                contentHashes.add(sharedPayload == nullptr ? contentHash : Asset::ContentHash{});
+                            }
+                            entityIndices.add(entityIndex);
+                        }
+                    }
+
+                    uint32_t propertyCount = entityIndices.count();
+                    uint32_t payloadCount = contentHashes.count();
+                    size_t tableSize = sizeof(uint32_t) * 2 * propertyCount + sizeof(Asset::ContentHash) * payloadCount;
+                    toBinary(context->Stream, type);
+                    toBinary(context->Stream, propertyCount);
+                    toBinary(context->Stream, payloadCount);
+                    toBinary(context->Stream, static_cast<uint32_t>(tableSize + payloads.Size));
+                    toBinary(context->Stream, entityIndices.data(), sizeof(uint32_t) * propertyCount);
+                    toBinary(context->Stream, payloadIndices.data(), sizeof(uint32_t) * propertyCount);
+                    toBinary(context->Stream, contentHashes.data(), sizeof(Asset::ContentHash) * payloadCount);
+                    toBinary(context->Stream, payloads.Memory, payloads.Size);
+                }
+            }
+
+            void unloadThreadSafe(IB::Asset::AssetHandle assetHandle) override
+            {
+                Cell* cell = reinterpret_cast<Cell*>(assetHandle.Value);
+                for (Entity* entity : cell->Entities)
+                {
+                    unloadEntity(entity);
+                }
+
+                ActiveCells.remove(*cell);
             }
         };
 
         EntityAssetStreamer EntityStreamer;
+        CellAssetStreamer CellStreamer;
     }
 
     void initEntitySystem()
     {
         Asset::addStreamer(Asset::toFourCC("ENTT"), &EntityStreamer);
+        Asset::addStreamer(Asset::toFourCC("CELL"), &CellStreamer);
     }
 
     void killEntitySystem()
@@ -200,7 +406,30 @@ namespace IB
     void addPropertyToEntity(EntityHandle entityHandle, Asset::FourCC type, PropertyHandle propertyHandle)
     {
         Entity* entity = reinterpret_cast<Entity*>(entityHandle.Value);
-        entity->Properties.add(type, propertyHandle);
+        entity->Properties.add(type, Asset::findStreamer(type), propertyHandle);
+    }
+
+    CellHandle createCell()
+    {
+        Cell& cell = ActiveCells.add();
+        return CellHandle{ reinterpret_cast<uint64_t>(&cell) };
+    }
+
+    void addEntityToCell(CellHandle cellHandle, EntityHandle entityHandle)
+    {
+        Cell* cell = reinterpret_cast<Cell*>(cellHandle.Value);
+        cell->Entities.add(reinterpret_cast<Entity*>(entityHandle.Value));
+    }
+
+    uint32_t cellEntityCount(CellHandle cellHandle)
+    {
+        return reinterpret_cast<Cell*>(cellHandle.Value)->Entities.count();
+    }
+
+    EntityHandle cellEntity(CellHandle cellHandle, uint32_t index)
+    {
+        Cell* cell = reinterpret_cast<Cell*>(cellHandle.Value);
+        return EntityHandle{ reinterpret_cast<uint64_t>(cell->Entities[index]) };
     }
 }
 
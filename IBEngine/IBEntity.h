@@ -15,14 +15,35 @@ namespace IB
         uint64_t Value;
     };
 
+    struct CellHandle
+    {
+        uint64_t Value;
+    };
+
     inline PropertyHandle toPropertyHandle(Asset::AssetHandle asset) { return { asset.Value }; }
     inline Asset::AssetHandle toAssetHandle(PropertyHandle property) { return { property.Value }; }
     inline EntityHandle toEntityHandle(Asset::AssetHandle asset) { return { asset.Value }; }
     inline Asset::AssetHandle toAssetHandle(EntityHandle entity) { return { entity.Value }; }
+    inline CellHandle toCellHandle(Asset::AssetHandle asset) { return { asset.Value }; }
+    inline Asset::AssetHandle toAssetHandle(CellHandle cell) { return { cell.Value }; }
 
     IB_API void initEntitySystem();
     IB_API void killEntitySystem();
     IB_API EntityHandle createEntity();
+    // Entities are saved as their list of properties. (ENTT)
+    // Layout: uint32_t PropertyCount, then per property: FourCC Type, ContentHash Hash, uint32_t Size, our property's data
     IB_API void addPropertyToEntity(EntityHandle entity, Asset::FourCC type, PropertyHandle propertyHandle);
+
+    // Cells are collections of entities that are loaded as a single asset. (CELL)
+    // Our entities' properties are stored grouped by type, every property streamer loads its cell's properties in one batch.
+    // Layout: uint32_t EntityCount, uint32_t GroupCount, our groups
+    // Group: FourCC Type, uint32_t PropertyCount, uint32_t PayloadCount, uint32_t Size,
+    //        uint32_t EntityIndices[PropertyCount], uint32_t PayloadIndices[PropertyCount], ContentHash ContentHashes[PayloadCount], our payloads
+    // Our group's size covers everything after it, every payload is prefixed by its uint32_t size.
+    // Properties whose streamer shares identical assets reference a single copy of their payload, every other property has its own.
+    IB_API CellHandle createCell();
+    IB_API void addEntityToCell(CellHandle cell, EntityHandle entity);
+    IB_API uint32_t cellEntityCount(CellHandle cell);
+    IB_API EntityHandle cellEntity(CellHandle cell, uint32_t index);
 }
 
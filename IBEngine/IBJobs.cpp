@@ -1,6 +1,7 @@
 #include "IBJobs.h"
 #include "IBPlatform.h"
 #include "IBLogging.h"
+#include "IBAllocator.h"
 
 #include <string.h>
 
@@ -146,6 +147,7 @@ namespace
         JobQueue Queue;
         IB::ThreadHandle Thread;
         IB::ThreadEvent SleepEvent;
+        uint64_t ExecutedJobCount = 0; // Only written by our worker
         bool Alive = false;
     };
     constexpr uint32_t MaxWorkerCount = 64;
@@ -162,6 +164,8 @@ namespace
         uint32_t WaitCounts[MaxWaitCount];
     } WaitList;
 
+    uint64_t CreatedJobCount = 0;
+
     Job* takeJob(IB::JobDesc desc)
     {
         Job *job = nullptr;
@@ -183,6 +187,7 @@ namespace
 
         // Our job is free to be written to at this point.
         IB_ASSERT(job != nullptr, "Failed to get a job from the job pool!");
+        IB::atomicAdd(&CreatedJobCount, 1);
         static_assert(sizeof(job->Data) == sizeof(desc.JobData), "Job description data size doesn't match job data size.");
         memcpy(job->Data, desc.JobData, sizeof(desc.JobData));
         job->QueueIndex = desc.QueueIndex;
@@ -362,6 +367,7 @@ namespace
             // As a result, it should behave correctly if the job completes before it is even put to sleep.
             // If putting to sleep has side effects in the future, the API might have to be re-thought
             IB::JobResult result = reinterpret_cast<IB::JobFunc *>(job->Func)(job->Data);
+            IB::volatileStore(&worker->ExecutedJobCount, worker->ExecutedJobCount + 1);
 
             // Queue management
             {
@@ -433,8 +439,9 @@ namespace IB
         for (uint32_t i = 0; i < WorkerCount; i++)
         {
             Workers[i].Alive = true;
-            Workers[i].Thread = createThread(&workerFunc, &Workers[i]);
+            // Our worker can go to sleep as soon as it starts, create our event first.
             Workers[i].SleepEvent = createThreadEvent();
+            Workers[i].Thread = createThread(&workerFunc, &Workers[i]);
         }
     }
 
@@ -501,4 +508,46 @@ namespace IB
         commitJob(job);
         return { (static_cast<uint64_t>(jobGeneration) << 32) | static_cast<uint32_t>(job - JobPool) };
     }
+
+    JobHandle readFileAsync(File file, void *buffer, size_t size, uint64_t offset, size_t *bytesRead)
+    {
+        // Our job doesn't do anything, it only exists to signal our waiting jobs once our read completes.
+        JobHandle readJob = reserveJob([]() { return JobResult::Complete; });
+
+        struct FileRead
+        {
+            JobHandle Job;
+            size_t *BytesRead;
+        };
+        FileRead *fileRead = allocate<FileRead>();
+        fileRead->Job = readJob;
+        fileRead->BytesRead = bytesRead;
+
+        auto onFileRead = [](void *data, size_t readSize)
+        {
+            FileRead *fileRead = reinterpret_cast<FileRead *>(data);
+            JobHandle job = fileRead->Job;
+            // Write our result before launching our job, our waiting jobs read it once our handle completes.
+            if (fileRead->BytesRead != nullptr)
+            {
+                *fileRead->BytesRead = readSize;
+            }
+            deallocate(fileRead);
+
+            launchJob(job);
+        };
+        readFileAsync(file, buffer, size, offset, onFileRead, fileRead);
+        return readJob;
+    }
+
+    JobStats jobStats()
+    {
+        JobStats stats = {};
+        stats.CreatedJobCount = volatileLoad(&CreatedJobCount);
+        for (uint32_t i = 0; i < WorkerCount; i++)
+        {
+            stats.ExecutedJobCount += volatileLoad(&Workers[i].ExecutedJobCount);
+        }
+        return stats;
+    }
 } // namespace IB
@@ -1,6 +1,7 @@
 #pragma once
 
 #include "IBEngineAPI.h"
+#include "IBPlatform.h"
 #include <stdint.h>
 #include <string.h>
 
@@ -94,6 +95,22 @@ namespace IB
     IB_API void launchJob(JobHandle handle);
     IB_API void continueJob(JobHandle handle, JobHandle* dependencies, uint32_t dependencyCount);
 
+    // Queues an asynchronous read of our file into our buffer.
+    // Our handle completes once our buffer has been filled, continue a job on it to consume our data.
+    // Our buffer and file need to survive until our handle completes.
+    // If bytesRead is provided, it's written with the number of bytes read before our handle completes.
+    // A failed read writes 0, compare it with our size to detect failed and short reads.
+    IB_API JobHandle readFileAsync(File file, void *buffer, size_t size, uint64_t offset, size_t *bytesRead = nullptr);
+
+    struct JobStats
+    {
+        uint64_t CreatedJobCount = 0; // Jobs taken from our pool, reserved jobs included
+        uint64_t ExecutedJobCount = 0; // Jobs that are re-entered after sleeping are counted every time they run
+    };
+
+    // Our counts are only approximate while our workers are running.
+    IB_API JobStats jobStats(); // Threadsafe
+
     // Utility API
 
     template <typename T>
@@ -18,6 +18,14 @@ namespace IB
     {
         return static_cast<uint8_t>(__popcnt64(value));
     }
+
+    // Undefined for a value of 0
+    inline uint32_t countTrailingZeros(uint32_t value)
+    {
+        unsigned long index;
+        _BitScanForward(&index, value);
+        return static_cast<uint32_t>(index);
+    }
 #endif // _MSC_VER
 
     // Windowing API
@@ -147,9 +155,28 @@ namespace IB
     // Releases reserved memory.
     IB_API void freeMemoryPages(void *pages);
 
+    struct MapMemoryOptions
+    {
+        enum
+        {
+            // Large pages are always committed and can't grow in place. Falls back to regular pages if unavailable.
+            LargePages = 0x01
+        };
+    };
+
     // When requesting large blocks of memory, consider using a memory mapping
-    IB_API void *mapLargeMemoryBlock(size_t size);   // Threadsafe
-    IB_API void unmapLargeMemoryBlock(void *memory); // Threadsafe as long as you don't unmap the same memory block.
+    // reservedSize reserves address space past the end of the block so that it can later grow in place.
+    IB_API void *mapLargeMemoryBlock(size_t size, size_t reservedSize = 0, uint32_t options = 0); // Threadsafe
+    IB_API void unmapLargeMemoryBlock(void *memory);                        // Threadsafe as long as you don't unmap the same memory block.
+    // Grows the block in place by committing more of its reservation.
+    // Returns false if the reservation can't fit the requested size.
+    IB_API bool resizeLargeMemoryBlock(void *memory, size_t size); // Threadsafe as long as you don't resize the same memory block.
+    // Returns the committed size of the block or 0 if the memory wasn't mapped with mapLargeMemoryBlock.
+    IB_API size_t largeMemoryBlockSize(void *memory); // Threadsafe
+    // Returns 0 if large pages aren't supported or we don't have the privilege to use them.
+    IB_API size_t largeMemoryPageSize(); // Threadsafe
+    // Physical memory currently used by our process.
+    IB_API size_t processResidentMemory(); // Threadsafe
 
     // Atomic API
 
@@ -160,6 +187,7 @@ namespace IB
     IB_API void *atomicCompareExchange(void *volatile *atomic, void *compare, void *exchange);
     IB_API uint64_t atomicOr(uint64_t volatile *atomic, uint64_t orValue);
     IB_API uint64_t atomicAnd(uint64_t volatile *atomic, uint64_t andValue);
+    IB_API uint64_t atomicAdd(uint64_t volatile *atomic, uint64_t value); // Returns our previous value
     inline uint32_t atomicIncrement(uint32_t *atomic) { return atomicIncrement(static_cast<uint32_t volatile *>(atomic)); }
     inline uint32_t atomicDecrement(uint32_t *atomic) { return atomicDecrement(static_cast<uint32_t volatile *>(atomic)); }
     inline uint32_t atomicCompareExchange(uint32_t *atomic, uint32_t compare, uint32_t exchange) { return atomicCompareExchange(static_cast<uint32_t volatile *>(atomic), compare, exchange); }
@@ -167,6 +195,7 @@ namespace IB
     inline void *atomicCompareExchange(void **atomic, void *compare, void *exchange) { return atomicCompareExchange(static_cast<void *volatile *>(atomic), compare, exchange); }
     inline uint64_t atomicOr(uint64_t *atomic, uint64_t orValue) { return atomicOr(static_cast<uint64_t volatile*>(atomic), orValue); }
     inline uint64_t atomicAnd(uint64_t *atomic, uint64_t andValue) { return atomicAnd(static_cast<uint64_t volatile*>(atomic), andValue); }
+    inline uint64_t atomicAdd(uint64_t *atomic, uint64_t value) { return atomicAdd(static_cast<uint64_t volatile*>(atomic), value); }
 
     // Threading API
     struct ThreadHandle
@@ -189,6 +218,14 @@ namespace IB
     IB_API void destroyThreadEvent(ThreadEvent threadEvent);
     IB_API void signalThreadEvent(ThreadEvent threadEvent);
     IB_API void waitOnThreadEvent(ThreadEvent threadEvent);
+    // Returns false if we timed out before our event was signaled.
+    IB_API bool waitOnThreadEvent(ThreadEvent threadEvent, uint32_t timeoutMilliseconds);
+
+    // Parks our thread while our value is still equal to undesiredValue, instead of spinning on it.
+    // We can wake up spuriously, check our value again after waking.
+    IB_API void waitOnAddress(uint32_t volatile *address, uint32_t undesiredValue); // Threadsafe
+    // Wakes every thread parked on our address, call it after changing our value.
+    IB_API void wakeOnAddress(uint32_t volatile *address); // Threadsafe
 
     // Not the ideal place for these, but good enough for now
     template <typename T>
@@ -212,6 +249,10 @@ namespace IB
 
     IB_API void debugBreak();
 
+    // Time API
+    IB_API uint64_t currentTimestamp(); // In ticks of timestampFrequency
+    IB_API uint64_t timestampFrequency(); // Ticks per second
+
     // File API
     struct File
     {
@@ -226,7 +267,9 @@ namespace IB
             Read = 0x01,
             Write = 0x02,
             Create = 0x04,
-            Overwrite = 0x08
+            Overwrite = 0x08,
+            // Our file can only be read with readFile and readFileAsync.
+            Asynchronous = 0x10
         };
     };
 
@@ -238,8 +281,39 @@ namespace IB
     IB_API void appendToFile(File file, void const *data, size_t size);
     IB_API size_t fileSize(File file);
     IB_API bool doesFileExist(char const *filepath);
+    // Replaces our destination with our source in one step, readers never see a partially written file.
+    IB_API bool replaceFile(char const *sourcePath, char const *destinationPath); // Threadsafe
+
+    // Reads at our offset without moving our file pointer, returns the number of bytes we've read.
+    IB_API size_t readFile(File file, void *buffer, size_t size, uint64_t offset); // Threadsafe
+
+    // Asynchronous reads are queued and issued by our I/O thread instead of page faulting on our workers.
+    // onFileRead is called from our I/O thread once our buffer is filled, keep it short and launch a job if you have work to do.
+    // bytesRead is 0 if our read failed.
+    using OnFileRead = void(void *data, size_t bytesRead);
+    IB_API void readFileAsync(File file, void *buffer, size_t size, uint64_t offset, OnFileRead *onFileRead, void *data); // Threadsafe, our file must have been opened with OpenFileOptions::Asynchronous
+    // How many reads our I/O thread keeps in flight at once, the rest wait in our queue.
+    IB_API void setFileReadQueueDepth(uint32_t depth); // Threadsafe
 
     // File system
     IB_API bool isDirectory(char const *path);
+    // Succeeds if our directory already exists, our parent directory must exist.
+    IB_API bool createDirectory(char const *path);
     IB_API void setWorkingDirectory(char const *path);
+    // Calls onFile for every file under our directory and its subdirectories.
+    // Our paths are relative to our directory and use '/' as a separator.
+    IB_API void enumerateDirectory(char const *path, void (*onFile)(void *data, char const *relativePath), void *data);
+
+    // Our directory watches collect the changes made to the files under our directory and its subdirectories.
+    struct DirectoryWatch
+    {
+        uintptr_t Value;
+    };
+    constexpr DirectoryWatch InvalidDirectoryWatch = DirectoryWatch{0};
+
+    IB_API DirectoryWatch watchDirectory(char const *path); // Returns InvalidDirectoryWatch if we failed to watch our directory.
+    IB_API void unwatchDirectory(DirectoryWatch watch);
+    // Calls onFileChanged for every file that was created, written or renamed since our last call, doesn't block.
+    // Our paths are relative to our directory and use '/' as a separator, a file can be reported more than once.
+    IB_API void consumeDirectoryChanges(DirectoryWatch watch, void (*onFileChanged)(void *data, char const *relativePath), void *data); // Threadsafe as long as you don't consume the same watch in another thread
 } // namespace IB
@@ -1,4 +1,5 @@
 #include "IBRenderer.h"
+#include "IBAllocator.h"
 #include "IBLogging.h"
 #include "IBPlatform.h"
 
@@ -201,6 +202,7 @@ namespace
             {
                 allocator->MemoryPools[i].HeadIndex = UINT32_MAX;
                 vkFreeMemory(device, allocator->MemoryPools[i].Memory, NULL);
+                IB::untrackMemory(IB::MemoryTag::RendererDevice, allocator->MemoryPools[i].Size);
             }
         }
     }
@@ -225,145 +227,151 @@ namespace
     {
         IB_ASSERT(memoryTypeIndex != UINT32_MAX, "Invalid memory type index.");
 
-        uint32_t foundPoolIndex = UINT32_MAX;
-        for (uint32_t i = 0; i < MaxAllocatorPools; i++)
+        VkDeviceSize allocationSize = size + (alignment - size % alignment);
+        // Fun little trick to round to next nearest power of 2 from https://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
+        // Reduce number by 1, will handle powers of 2
+        allocationSize--;
+        // Set all the lower bits to get a full set bit pattern giving us Pow2 - 1
+        allocationSize |= allocationSize >> 1;
+        allocationSize |= allocationSize >> 2;
+        allocationSize |= allocationSize >> 4;
+        allocationSize |= allocationSize >> 8;
+        allocationSize |= allocationSize >> 16;
+        // Add 1 to push to pow of 2
+        allocationSize++;
+
+        if (allocationSize > MaxAllocatorPoolSize)
         {
-            if (allocator->MemoryPools[i].MemoryType == memoryTypeIndex)
-            {
-                foundPoolIndex = i;
-                break;
-            }
+            IB_LOG(IB::LogLevel::Error, "Renderer", "Device allocation is larger than our memory pools.");
+            IB_ASSERT(false, "Failed to allocate a block.");
+            return Allocation{};
         }
 
-        if (foundPoolIndex == UINT32_MAX)
+        // Pools are never released until we destroy our allocator, our unused pools are always after our used pools.
+        // Look through every pool of our memory type and only create a new pool once they're all full.
+        for (uint32_t poolIndex = 0; poolIndex < MaxAllocatorPools; poolIndex++)
         {
-            for (unsigned int i = 0; i < MaxAllocatorPools; i++)
+            MemoryPool *memoryPool = &allocator->MemoryPools[poolIndex];
+            if (memoryPool->HeadIndex == UINT32_MAX)
             {
-                MemoryPool *memoryPool = &allocator->MemoryPools[i];
-                if (memoryPool->HeadIndex == UINT32_MAX)
+                memoryPool->Size = MaxAllocatorPoolSize;
+
+                // Our device memory counts towards our budget, give our other systems a chance to release theirs first.
+                if (!IB::trackMemory(IB::MemoryTag::RendererDevice, memoryPool->Size))
                 {
-                    memoryPool->Size = MaxAllocatorPoolSize;
+                    IB_LOG(IB::LogLevel::Warn, "Renderer", "Creating a device memory pool over our device memory budget.");
+                }
 
-                    VkMemoryAllocateInfo memoryAllocInfo = {};
-                    memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
-                    memoryAllocInfo.allocationSize = memoryPool->Size;
-                    memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
+                VkMemoryAllocateInfo memoryAllocInfo = {};
+                memoryAllocInfo.sType = VK_STRUCTURE_TYPE_MEMORY_ALLOCATE_INFO;
+                memoryAllocInfo.allocationSize = memoryPool->Size;
+                memoryAllocInfo.memoryTypeIndex = memoryTypeIndex;
 
-                    IB_VKCHECK(vkAllocateMemory(device, &memoryAllocInfo, NULL, &memoryPool->Memory));
+                IB_VKCHECK(vkAllocateMemory(device, &memoryAllocInfo, NULL, &memoryPool->Memory));
 
-                    IB_ASSERT(allocator->FreeBlockCount > 0, "No free blocks left!");
-                    uint32_t newBlockIndex = allocator->FreeBlocks[allocator->FreeBlockCount - 1];
-                    allocator->FreeBlockCount--;
+                IB_ASSERT(allocator->FreeBlockCount > 0, "No free blocks left!");
+                uint32_t newBlockIndex = allocator->FreeBlocks[allocator->FreeBlockCount - 1];
+                allocator->FreeBlockCount--;
 
-                    MemoryBlock *block = &allocator->BlockPool[newBlockIndex];
-                    block->Size = memoryPool->Size;
-                    block->Offset = 0;
-                    block->Allocated = false;
+                MemoryBlock *block = &allocator->BlockPool[newBlockIndex];
+                block->Size = memoryPool->Size;
+                block->Offset = 0;
+                block->Allocated = false;
+                block->NextIndex = UINT32_MAX;
 
-                    memoryPool->HeadIndex = newBlockIndex;
-                    memoryPool->NextId = 1;
-                    memoryPool->MemoryType = memoryTypeIndex;
+                memoryPool->HeadIndex = newBlockIndex;
+                memoryPool->NextId = 1;
+                memoryPool->MemoryType = memoryTypeIndex;
+            }
+            else if (memoryPool->MemoryType != memoryTypeIndex)
+            {
+                continue;
+            }
 
-                    foundPoolIndex = i;
-                    break;
+            // Look for a free block our size
+            for (uint32_t iter = memoryPool->HeadIndex; iter != UINT32_MAX; iter = allocator->BlockPool[iter].NextIndex)
+            {
+                MemoryBlock *memoryBlock = &allocator->BlockPool[iter];
+                if (!memoryBlock->Allocated && memoryBlock->Size == allocationSize)
+                {
+                    memoryBlock->Allocated = true;
+
+                    Allocation allocation = {};
+                    allocation.Memory = memoryPool->Memory;
+                    allocation.Offset = memoryBlock->Offset;
+                    allocation.Id = memoryBlock->Id;
+                    allocation.PoolIndex = poolIndex;
+                    return allocation;
                 }
             }
-        }
 
-        IB_ASSERT(foundPoolIndex != UINT32_MAX, "Failed to find a memory pool.");
+            // Couldn't find a block the right size, create one from our closest block
+            MemoryBlock *smallestBlock = NULL;
+            for (uint32_t iter = memoryPool->HeadIndex; iter != UINT32_MAX; iter = allocator->BlockPool[iter].NextIndex)
+            {
+                MemoryBlock *block = &allocator->BlockPool[iter];
 
-        VkDeviceSize allocationSize = size + (alignment - size % alignment);
-        // Fun little trick to round to next nearest power of 2 from https://graphics.stanford.edu/~seander/bithacks.html#RoundUpPowerOf2
-        // Reduce number by 1, will handle powers of 2
-        allocationSize--;
-        // Set all the lower bits to get a full set bit pattern giving us Pow2 - 1
-        allocationSize |= allocationSize >> 1;
-        allocationSize |= allocationSize >> 2;
-        allocationSize |= allocationSize >> 4;
-        allocationSize |= allocationSize >> 8;
-        allocationSize |= allocationSize >> 16;
-        // Add 1 to push to pow of 2
-        allocationSize++;
+                if (!block->Allocated && block->Size > allocationSize && (smallestBlock == NULL || block->Size < smallestBlock->Size))
+                {
+                    smallestBlock = block;
+                }
+            }
 
-        MemoryPool *memoryPool = &allocator->MemoryPools[foundPoolIndex];
-        // Look for a free block our size
-        for (uint32_t iter = memoryPool->HeadIndex; iter != UINT32_MAX; iter = allocator->BlockPool[iter].NextIndex)
-        {
-            MemoryBlock *memoryBlock = &allocator->BlockPool[iter];
-            if (!memoryBlock->Allocated && memoryBlock->Size == allocationSize)
+            MemoryBlock *iter = smallestBlock;
+            if (iter == NULL)
             {
-                memoryBlock->Allocated = true;
-
-                Allocation allocation = {};
-                allocation.Memory = memoryPool->Memory;
-                allocation.Offset = memoryBlock->Offset;
-                allocation.Id = memoryBlock->Id;
-                allocation.PoolIndex = foundPoolIndex;
-                return allocation;
+                // This pool is full, try our next one.
+                continue;
             }
-        }
 
-        // Couldn't find a block the right size, create one from our closest block
-        MemoryBlock *smallestBlock = NULL;
-        for (uint32_t iter = memoryPool->HeadIndex; iter != UINT32_MAX; iter = allocator->BlockPool[iter].NextIndex)
-        {
-            MemoryBlock *block = &allocator->BlockPool[iter];
 
-            if (smallestBlock == NULL || (block->Size > allocationSize && block->Size < smallestBlock->Size && !block->Allocated))
+            while (iter->Size > allocationSize && iter->Size / 2 > allocationSize)
             {
-                smallestBlock = block;
-            }
-        }
+                VkDeviceSize newBlockSize = iter->Size / 2;
 
-        MemoryBlock *iter = smallestBlock;
-        if (iter == NULL)
-        {
-            IB_ASSERT(false, "Failed to allocate a block.");
-            return Allocation{};
-        }
+                iter->Allocated = true;
+                IB_ASSERT(allocator->FreeBlockCount >= 2, "We should have at least 2 blocks free before we split.");
 
-        while (iter->Size > allocationSize && iter->Size / 2 > allocationSize)
-        {
-            VkDeviceSize newBlockSize = iter->Size / 2;
+                uint32_t leftIndex = allocator->FreeBlocks[allocator->FreeBlockCount - 1];
+                allocator->FreeBlockCount--;
 
-            iter->Allocated = true;
-            IB_ASSERT(allocator->FreeBlockCount >= 2, "We should have at least 2 blocks free before we split.");
+                MemoryBlock *left = &allocator->BlockPool[leftIndex];
+                left->Offset = iter->Offset;
+                left->Size = newBlockSize;
+                left->Id = memoryPool->NextId;
+                left->Allocated = false;
+                ++memoryPool->NextId;
 
-            uint32_t leftIndex = allocator->FreeBlocks[allocator->FreeBlockCount - 1];
-            allocator->FreeBlockCount--;
+                uint32_t rightIndex = allocator->FreeBlocks[allocator->FreeBlockCount - 1];
+                allocator->FreeBlockCount--;
 
-            MemoryBlock *left = &allocator->BlockPool[leftIndex];
-            left->Offset = iter->Offset;
-            left->Size = newBlockSize;
-            left->Id = memoryPool->NextId;
-            left->Allocated = false;
-            ++memoryPool->NextId;
+                MemoryBlock *right = &allocator->BlockPool[rightIndex];
+                right->Offset = iter->Offset + newBlockSize;
+                right->Size = newBlockSize;
+                right->Id = memoryPool->NextId;
+                right->Allocated = false;
+                ++memoryPool->NextId;
 
-            uint32_t rightIndex = allocator->FreeBlocks[allocator->FreeBlockCount - 1];
-            allocator->FreeBlockCount--;
+                left->NextIndex = rightIndex;
+                right->NextIndex = iter->NextIndex;
+                iter->NextIndex = leftIndex;
 
-            MemoryBlock *right = &allocator->BlockPool[rightIndex];
-            right->Offset = iter->Offset + newBlockSize;
-            right->Size = newBlockSize;
-            right->Id = memoryPool->NextId;
-            right->Allocated = false;
-            ++memoryPool->NextId;
+                iter = left;
+            }
 
-            left->NextIndex = rightIndex;
-            right->NextIndex = iter->NextIndex;
-            iter->NextIndex = leftIndex;
+            iter->Allocated = true;
 
-            iter = left;
+            Allocation allocation = {};
+            allocation.Memory = memoryPool->Memory;
+            allocation.Offset = iter->Offset;
+            allocation.Id = iter->Id;
+            allocation.PoolIndex = poolIndex;
+            return allocation;
         }
 
-        iter->Allocated = true;
-
-        Allocation allocation = {};
-        allocation.Memory = memoryPool->Memory;
-        allocation.Offset = iter->Offset;
-        allocation.Id = iter->Id;
-        allocation.PoolIndex = foundPoolIndex;
-        return allocation;
+        IB_LOG(IB::LogLevel::Error, "Renderer", "Ran out of device memory pools.");
+        IB_ASSERT(false, "Failed to allocate a block.");
+        return Allocation{};
     }
 
     void freeDeviceMemory(Allocator *allocator, Allocation allocation)
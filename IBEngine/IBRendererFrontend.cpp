@@ -137,7 +137,8 @@ namespace IB
     {
         Asset::addStreamer(Asset::toFourCC("MESH"), &MeshStreamer);
         Asset::addStreamer(Asset::toFourCC("SHDR"), &ShaderStreamer);
-        Asset::addStreamer(Asset::toFourCC("RNDR"), &RendererPropertyStreamer);
+        // Our renderer properties only reference their mesh, identical ones can be shared between entities.
+        Asset::addStreamer(Asset::toFourCC("RNDR"), &RendererPropertyStreamer, Asset::StreamerOptions::ShareIdenticalAssets);
 
         JobHandle jobHandle = Asset::loadResourceAsync("SampleForward.shdr", Asset::toFourCC("SHDR"), &GlobalShaderResource);
         InitJob = continueJob([window = *desc.Window]() {
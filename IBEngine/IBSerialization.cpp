@@ -46,6 +46,26 @@ namespace IB
             return static_cast<uint32_t>(fileSize(stream->File));
         }
 
+        void toBinary(BufferStream *stream, void const *data, size_t size)
+        {
+            if (stream->Size + size > stream->Capacity)
+            {
+                size_t capacity = stream->Capacity > 0 ? stream->Capacity * 2 : FileStream::BufferSize;
+                capacity = capacity > stream->Size + size ? capacity : stream->Size + size;
+                stream->Memory = reinterpret_cast<uint8_t *>(memoryReallocate(stream->Memory, capacity, alignof(uint64_t), MemoryTag::Assets));
+                stream->Capacity = capacity;
+            }
+
+            memcpy(stream->Memory + stream->Size, data, size);
+            stream->Size += size;
+        }
+
+        void patchBinary(BufferStream *stream, size_t offset, void const *data, size_t size)
+        {
+            IB_ASSERT(offset + size <= stream->Size, "Patching past the end of our stream!");
+            memcpy(stream->Memory + offset, data, size);
+        }
+
         void fromBinary(MemoryStream *stream, void *data, size_t size)
         {
             memcpy(data, stream->Memory, size);
@@ -5,6 +5,7 @@
 
 #include "IBEngineAPI.h"
 #include "IBPlatform.h"
+#include "IBAllocator.h"
 
 namespace IB
 {
@@ -39,6 +40,43 @@ namespace IB
             toBinary(stream, string, stringSize);
         }
 
+        // Our stream is built in memory and written out once it's complete.
+        // Sizes and offsets can be patched after the data that follows them has been written.
+        struct BufferStream
+        {
+            BufferStream() = default;
+            BufferStream(BufferStream const &) = delete;
+            BufferStream &operator=(BufferStream const &) = delete;
+            ~BufferStream() { memoryFree(Memory, MemoryTag::Assets); }
+
+            uint8_t *Memory = nullptr;
+            size_t Size = 0;
+            size_t Capacity = 0;
+        };
+
+        IB_API void toBinary(BufferStream *stream, void const *data, size_t size);
+        // Overwrites data that we've already written at our offset.
+        IB_API void patchBinary(BufferStream *stream, size_t offset, void const *data, size_t size);
+
+        template <typename T>
+        void toBinary(BufferStream *stream, T value)
+        {
+            toBinary(stream, &value, sizeof(T));
+        }
+
+        template <typename T>
+        void patchBinary(BufferStream *stream, size_t offset, T value)
+        {
+            patchBinary(stream, offset, &value, sizeof(T));
+        }
+
+        inline void toBinary(BufferStream *stream, char const *string)
+        {
+            uint32_t stringSize = static_cast<uint32_t>(strlen(string)) + 1;
+            toBinary(stream, stringSize);
+            toBinary(stream, string, stringSize);
+        }
+
         struct MemoryStream
         {
             MemoryStream() = default;
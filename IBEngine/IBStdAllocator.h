@@ -0,0 +1,183 @@
+#pragma once
+
+#include "IBAllocator.h"
+
+#include <stddef.h>
+#include <stdint.h>
+#include <stdlib.h>
+#include <new>
+
+#if (defined(_MSVC_LANG) ? _MSVC_LANG : __cplusplus) >= 201703L
+#include <memory_resource>
+#define IB_HAS_MEMORY_RESOURCE
+#endif
+
+/*
+## Standard Library Allocators
+Tool and editor code likes the standard library containers, these adapters route their memory through IBAllocator
+so that it shows up in our memory stats under its tag.
+
+- StdAllocator: Allocator for std containers. std::vector<int, IB::StdAllocator<int, IB::MemoryTag::Tools>>
+- MemoryResource/ScratchMemoryResource: std::pmr resources over our general allocator and over a scratch arena. (C++17 only)
+- IB_GLOBAL_NEW_DELETE: Replaces the global new and delete of a module.
+
+### Global new and delete
+Use IB_GLOBAL_NEW_DELETE(IB::MemoryTag::Tools) in a single source file of an executable.
+Replacing new and delete only affects the module that defines them, our DLLs keep using the CRT.
+Make sure memory allocated with new in one module isn't deleted in another.
+Our throwing new throws std::bad_alloc once we're out of memory or over our hard budget, or aborts if exceptions are disabled.
+StdAllocator and MemoryResource fail the same way, standard containers expect them to throw rather than return nullptr.
+Our nothrow new returns nullptr instead.
+*/
+
+namespace IB
+{
+    // Matches the alignment that the CRT gives to new.
+    constexpr size_t GlobalNewAlignment = 2 * sizeof(void *);
+
+    // Standard allocators and new must never return nullptr.
+    [[noreturn]] inline void failAllocation()
+    {
+#if defined(__cpp_exceptions) || defined(_CPPUNWIND)
+        throw std::bad_alloc();
+#else
+        abort();
+#endif
+    }
+
+    inline void *globalNew(size_t size, size_t alignment, MemoryTag tag)
+    {
+        void *memory = tryMemoryAllocate(size == 0 ? 1 : size, alignment, tag);
+        if (memory == nullptr)
+        {
+            failAllocation();
+        }
+        return memory;
+    }
+
+    inline void *globalNewNoThrow(size_t size, size_t alignment, MemoryTag tag) noexcept
+    {
+        return tryMemoryAllocate(size == 0 ? 1 : size, alignment, tag);
+    }
+
+    template <typename T, MemoryTag Tag = MemoryTag::General>
+    struct StdAllocator
+    {
+        using value_type = T;
+
+        template <typename U>
+        struct rebind
+        {
+            using other = StdAllocator<U, Tag>;
+        };
+
+        StdAllocator() = default;
+        template <typename U>
+        StdAllocator(StdAllocator<U, Tag> const &) {}
+
+        T *allocate(size_t count)
+        {
+            if (count > SIZE_MAX / sizeof(T))
+            {
+                failAllocation();
+            }
+            return reinterpret_cast<T *>(globalNew(sizeof(T) * count, alignof(T), Tag));
+        }
+
+        void deallocate(T *memory, size_t)
+        {
+            memoryFree(memory, Tag);
+        }
+    };
+
+    template <typename T, typename U, MemoryTag Tag>
+    bool operator==(StdAllocator<T, Tag> const &, StdAllocator<U, Tag> const &) { return true; }
+    template <typename T, typename U, MemoryTag Tag>
+    bool operator!=(StdAllocator<T, Tag> const &, StdAllocator<U, Tag> const &) { return false; }
+
+#ifdef IB_HAS_MEMORY_RESOURCE
+    class MemoryResource final : public std::pmr::memory_resource
+    {
+    public:
+        explicit MemoryResource(MemoryTag tag = MemoryTag::General)
+            : Tag(tag)
+        {
+        }
+
+    private:
+        void *do_allocate(size_t size, size_t alignment) override
+        {
+            return globalNew(size, alignment, Tag);
+        }
+
+        void do_deallocate(void *memory, size_t, size_t) override
+        {
+            memoryFree(memory, Tag);
+        }
+
+        // Our memory has to be freed with the tag it was allocated with, only our own resource can free it.
+        bool do_is_equal(std::pmr::memory_resource const &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        MemoryTag Tag;
+    };
+
+    // Deallocating is a no-op, our memory is released once our arena is reset.
+    class ScratchMemoryResource final : public std::pmr::memory_resource
+    {
+    public:
+        explicit ScratchMemoryResource(ScratchArena *arena)
+            : Arena(arena)
+        {
+        }
+
+    private:
+        void *do_allocate(size_t size, size_t alignment) override
+        {
+            return memoryAllocate(Arena, size == 0 ? 1 : size, alignment);
+        }
+
+        void do_deallocate(void *, size_t, size_t) override
+        {
+        }
+
+        bool do_is_equal(std::pmr::memory_resource const &other) const noexcept override
+        {
+            return this == &other;
+        }
+
+        ScratchArena *Arena;
+    };
+#endif // IB_HAS_MEMORY_RESOURCE
+} // namespace IB
+
+#ifdef __cpp_aligned_new
+#define IB_GLOBAL_ALIGNED_NEW_DELETE(tag)                                                                                                                                                    \
+    void *operator new(size_t size, std::align_val_t alignment) { return IB::globalNew(size, static_cast<size_t>(alignment), tag); }                                                         \
+    void *operator new[](size_t size, std::align_val_t alignment) { return IB::globalNew(size, static_cast<size_t>(alignment), tag); }                                                       \
+    void *operator new(size_t size, std::align_val_t alignment, std::nothrow_t const &) noexcept { return IB::globalNewNoThrow(size, static_cast<size_t>(alignment), tag); }                 \
+    void *operator new[](size_t size, std::align_val_t alignment, std::nothrow_t const &) noexcept { return IB::globalNewNoThrow(size, static_cast<size_t>(alignment), tag); }               \
+    void operator delete(void *memory, std::align_val_t) noexcept { IB::memoryFree(memory, tag); }                                                                                           \
+    void operator delete[](void *memory, std::align_val_t) noexcept { IB::memoryFree(memory, tag); }                                                                                         \
+    void operator delete(void *memory, size_t, std::align_val_t) noexcept { IB::memoryFree(memory, tag); }                                                                                   \
+    void operator delete[](void *memory, size_t, std::align_val_t) noexcept { IB::memoryFree(memory, tag); }                                                                                 \
+    void operator delete(void *memory, std::align_val_t, std::nothrow_t const &) noexcept { IB::memoryFree(memory, tag); }                                                                   \
+    void operator delete[](void *memory, std::align_val_t, std::nothrow_t const &) noexcept { IB::memoryFree(memory, tag); }
+#else
+#define IB_GLOBAL_ALIGNED_NEW_DELETE(tag)
+#endif // __cpp_aligned_new
+
+#define IB_GLOBAL_NEW_DELETE(tag)                                                                                                                        \
+    void *operator new(size_t size) { return IB::globalNew(size, IB::GlobalNewAlignment, tag); }                                                         \
+    void *operator new[](size_t size) { return IB::globalNew(size, IB::GlobalNewAlignment, tag); }                                                       \
+    void *operator new(size_t size, std::nothrow_t const &) noexcept { return IB::globalNewNoThrow(size, IB::GlobalNewAlignment, tag); }                 \
+    void *operator new[](size_t size, std::nothrow_t const &) noexcept { return IB::globalNewNoThrow(size, IB::GlobalNewAlignment, tag); }               \
+    void operator delete(void *memory) noexcept { IB::memoryFree(memory, tag); }                                                                         \
+    void operator delete[](void *memory) noexcept { IB::memoryFree(memory, tag); }                                                                       \
+    void operator delete(void *memory, size_t) noexcept { IB::memoryFree(memory, tag); }                                                                 \
+    void operator delete[](void *memory, size_t) noexcept { IB::memoryFree(memory, tag); }                                                               \
+    void operator delete(void *memory, std::nothrow_t const &) noexcept { IB::memoryFree(memory, tag); }                                                 \
+    void operator delete[](void *memory, std::nothrow_t const &) noexcept { IB::memoryFree(memory, tag); }                                               \
+    IB_GLOBAL_ALIGNED_NEW_DELETE(tag)
@@ -0,0 +1,91 @@
+#include "IBStringId.h"
+#include "IBAllocator.h"
+#include "IBPlatform.h"
+#include "IBLogging.h"
+
+#include <string.h>
+
+namespace
+{
+    // Entries are claimed by swapping in our id, the thread that claims an entry publishes its string afterwards.
+    struct InternedString
+    {
+        uint64_t Id;
+        char const *String;
+    };
+
+    constexpr uint32_t MaxInternedStringCount = 256 * 1024; // Must be a power of 2
+    InternedString InternedStrings[MaxInternedStringCount];
+
+    // Our entry's string might not be published yet if we've raced its interning thread.
+    char const *waitForString(InternedString *entry)
+    {
+        char const *string = IB::volatileLoad(&entry->String);
+        while (string == nullptr)
+        {
+            string = IB::volatileLoad(&entry->String);
+        }
+        IB::threadAcquire();
+        return string;
+    }
+} // namespace
+
+namespace IB
+{
+    StringId internString(char const *text)
+    {
+        StringId id = toStringId(text);
+        uint32_t tableMask = MaxInternedStringCount - 1;
+        uint32_t tableIndex = static_cast<uint32_t>(id.Value) & tableMask;
+        for (uint32_t probe = 0; probe < MaxInternedStringCount; probe++)
+        {
+            InternedString *entry = &InternedStrings[(tableIndex + probe) & tableMask];
+            uint64_t entryId = atomicCompareExchange(&entry->Id, 0, id.Value);
+            if (entryId == 0)
+            {
+                // We've claimed our entry, store our string.
+                size_t length = strlen(text);
+                char *string = reinterpret_cast<char *>(memoryAllocate(length + 1, 1));
+                memcpy(string, text, length + 1);
+
+                threadRelease();
+                volatileStore<char const *>(&entry->String, string);
+                return id;
+            }
+            else if (entryId == id.Value)
+            {
+                IB_ASSERT(strcmp(waitForString(entry), text) == 0, "StringId collision! Two different strings have the same id.");
+                return id;
+            }
+        }
+
+        IB_ASSERT(false, "Our intern table is full!");
+        return InvalidStringId;
+    }
+
+    char const *stringFromId(StringId id)
+    {
+        if (id == InvalidStringId)
+        {
+            return nullptr;
+        }
+
+        uint32_t tableMask = MaxInternedStringCount - 1;
+        uint32_t tableIndex = static_cast<uint32_t>(id.Value) & tableMask;
+        for (uint32_t probe = 0; probe < MaxInternedStringCount; probe++)
+        {
+            InternedString *entry = &InternedStrings[(tableIndex + probe) & tableMask];
+            uint64_t entryId = volatileLoad(&entry->Id);
+            if (entryId == id.Value)
+            {
+                return waitForString(entry);
+            }
+            else if (entryId == 0)
+            {
+                break;
+            }
+        }
+
+        return nullptr;
+    }
+} // namespace IB
@@ -0,0 +1,43 @@
+#pragma once
+
+#include "IBEngineAPI.h"
+#include <stdint.h>
+
+/*
+## String Ids
+A StringId is the 64 bit FNV-1a hash of a string.
+Ids can be computed at compile time from literals with toStringId, comparing ids doesn't touch our strings.
+
+internString stores our string once in our global intern table so that it can be retrieved from its id with stringFromId.
+Interning detects collisions, two different strings with the same id will assert instead of silently aliasing each other.
+Ids computed at compile time aren't in our table until their string has been interned at least once.
+*/
+
+namespace IB
+{
+    struct StringId
+    {
+        uint64_t Value = 0;
+    };
+    constexpr StringId InvalidStringId = {0};
+
+    // http://www.isthe.com/chongo/tech/comp/fnv/index.html
+    constexpr StringId toStringId(char const *text)
+    {
+        uint64_t hash = 0xcbf29ce484222325ull;
+        for (; *text != 0; text++)
+        {
+            hash = (hash ^ static_cast<uint8_t>(*text)) * 0x100000001b3ull;
+        }
+
+        // 0 is our invalid id
+        return StringId{hash != 0 ? hash : 1};
+    }
+
+    inline bool operator==(StringId left, StringId right) { return left.Value == right.Value; }
+    inline bool operator!=(StringId left, StringId right) { return left.Value != right.Value; }
+
+    IB_API StringId internString(char const *text); // Threadsafe, lock free
+    // Returns nullptr if our id's string was never interned.
+    IB_API char const *stringFromId(StringId id); // Threadsafe, lock free
+} // namespace IB
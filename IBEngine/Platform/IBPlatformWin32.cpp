@@ -4,7 +4,10 @@
 #define WIN32_LEAN_AND_MEAN
 #include <Windows.h>
 #include <sysinfoapi.h>
+#include <Psapi.h>
 #include <stdint.h>
+#include <stdio.h>
+#include <string.h>
 
 namespace
 {
@@ -233,8 +236,16 @@ namespace
         HANDLE FileHandle = NULL;
         HANDLE MapHandle = NULL;
         void *Mapping = nullptr;
+        size_t Size = 0; // Committed size, only used by memory mappings.
+        size_t ReservedSize = 0;
     };
 
+    size_t roundToPageSize(size_t size)
+    {
+        size_t const pageSize = IB::memoryPageSize();
+        return (size + pageSize - 1) / pageSize * pageSize;
+    }
+
     constexpr uint32_t MaxMemoryFileMappingCount = 1024;
     ActiveFileMapping ActiveMemoryFileMappings[MaxMemoryFileMappingCount];
 
@@ -256,6 +267,206 @@ namespace
         activeThread->Func(activeThread->Data);
         return 0;
     }
+
+    // Asynchronous File Reads
+
+    struct FileReadRequest
+    {
+        OVERLAPPED Overlapped = {}; // Our completions hand us our overlapped, keep it first so that we can get our request back from it.
+        HANDLE FileHandle = NULL;
+        void *Buffer = nullptr;
+        DWORD Size = 0;
+        IB::OnFileRead *OnFileRead = nullptr;
+        void *Data = nullptr;
+    };
+
+    constexpr uint32_t MaxFileReadRequests = 1024; // Queued and in flight
+    constexpr uint32_t MaxFileReadQueueDepth = 64;
+    constexpr ULONG_PTR SubmitFileReadsKey = 1;
+
+    struct FileReadQueue
+    {
+        FileReadRequest Requests[MaxFileReadRequests];
+        uint32_t FreeRequests[MaxFileReadRequests];
+        uint32_t FreeRequestCount = 0;
+        uint32_t QueuedRequests[MaxFileReadRequests]; // Ring buffer of requests waiting to be issued
+        uint32_t QueueStart = 0;
+        uint32_t QueuedCount = 0;
+        uint32_t Locked = 0;
+
+        uint32_t QueueDepth = 16;
+        uint32_t InFlightCount = 0; // Only touched by our I/O thread
+
+        HANDLE CompletionPort = NULL;
+        uint32_t State = 0; // Uninitialized, Initializing, Ready
+    };
+    FileReadQueue FileReads;
+
+    void lockFileReads()
+    {
+        while (IB::atomicCompareExchange(&FileReads.Locked, 0, 1) != 0)
+        {
+        }
+        IB::threadAcquire();
+    }
+
+    void unlockFileReads()
+    {
+        IB::threadRelease();
+        IB::volatileStore<uint32_t>(&FileReads.Locked, 0);
+    }
+
+    void freeFileReadRequest(FileReadRequest *request)
+    {
+        lockFileReads();
+        FileReads.FreeRequests[FileReads.FreeRequestCount++] = static_cast<uint32_t>(request - FileReads.Requests);
+        unlockFileReads();
+    }
+
+    void completeFileRead(FileReadRequest *request, size_t bytesRead)
+    {
+        // Copy our callback, our request can be reused as soon as we've freed it.
+        IB::OnFileRead *onFileRead = request->OnFileRead;
+        void *data = request->Data;
+        freeFileReadRequest(request);
+        onFileRead(data, bytesRead);
+    }
+
+    void fileReadThreadFunc(void *)
+    {
+        while (true)
+        {
+            // Issue as many of our queued reads as our queue depth allows.
+            while (FileReads.InFlightCount < IB::volatileLoad(&FileReads.QueueDepth))
+            {
+                FileReadRequest *request = nullptr;
+                lockFileReads();
+                if (FileReads.QueuedCount > 0)
+                {
+                    request = &FileReads.Requests[FileReads.QueuedRequests[FileReads.QueueStart]];
+                    FileReads.QueueStart = (FileReads.QueueStart + 1) % MaxFileReadRequests;
+                    FileReads.QueuedCount--;
+                }
+                unlockFileReads();
+
+                if (request == nullptr)
+                {
+                    break;
+                }
+
+                // Our read completes through our completion port even if it completes right away.
+                if (ReadFile(request->FileHandle, request->Buffer, request->Size, NULL, &request->Overlapped) == FALSE && GetLastError() != ERROR_IO_PENDING)
+                {
+                    completeFileRead(request, 0);
+                }
+                else
+                {
+                    FileReads.InFlightCount++;
+                }
+            }
+
+            DWORD bytesRead = 0;
+            ULONG_PTR key = 0;
+            OVERLAPPED *overlapped = nullptr;
+            BOOL result = GetQueuedCompletionStatus(FileReads.CompletionPort, &bytesRead, &key, &overlapped, INFINITE);
+            if (overlapped == nullptr)
+            {
+                // We've been asked to issue our queued reads.
+                continue;
+            }
+
+            FileReads.InFlightCount--;
+            completeFileRead(reinterpret_cast<FileReadRequest *>(overlapped), result == TRUE ? bytesRead : 0);
+        }
+    }
+
+    void initFileReads()
+    {
+        if (IB::volatileLoad(&FileReads.State) != 2)
+        {
+            if (IB::atomicCompareExchange(&FileReads.State, 0, 1) == 0)
+            {
+                for (uint32_t i = 0; i < MaxFileReadRequests; i++)
+                {
+                    FileReads.FreeRequests[i] = MaxFileReadRequests - i - 1;
+                }
+                FileReads.FreeRequestCount = MaxFileReadRequests;
+                FileReads.CompletionPort = CreateIoCompletionPort(INVALID_HANDLE_VALUE, NULL, 0, 1);
+                IB_ASSERT(FileReads.CompletionPort != NULL, "Failed to create our I/O completion port.");
+                IB::createThread(&fileReadThreadFunc, nullptr);
+
+                IB::threadRelease();
+                IB::volatileStore<uint32_t>(&FileReads.State, 2);
+            }
+
+            // Busy spin while another thread initializes our reads.
+            while (IB::volatileLoad(&FileReads.State) != 2)
+            {
+            }
+            IB::threadAcquire();
+        }
+    }
+
+    // relativePath holds the path of our current directory relative to our root and is shared by our recursion.
+    void enumerateDirectoryRecursive(char const *rootPath, char *relativePath, size_t relativePathLength, void (*onFile)(void *data, char const *relativePath), void *data)
+    {
+        char searchPath[MAX_PATH];
+        snprintf(searchPath, MAX_PATH, "%s/%s*", rootPath, relativePath);
+
+        WIN32_FIND_DATA findData;
+        HANDLE findHandle = FindFirstFile(searchPath, &findData);
+        if (findHandle == INVALID_HANDLE_VALUE)
+        {
+            return;
+        }
+
+        do
+        {
+            if (strcmp(findData.cFileName, ".") == 0 || strcmp(findData.cFileName, "..") == 0)
+            {
+                continue;
+            }
+
+            size_t nameLength = strlen(findData.cFileName);
+            if (relativePathLength + nameLength + 2 > MAX_PATH)
+            {
+                IB_LOG(IB::LogLevel::Warn, "Platform", "Skipping a path that's too long to enumerate.");
+                continue;
+            }
+
+            memcpy(relativePath + relativePathLength, findData.cFileName, nameLength + 1);
+            if ((findData.dwFileAttributes & FILE_ATTRIBUTE_DIRECTORY) != 0)
+            {
+                relativePath[relativePathLength + nameLength] = '/';
+                relativePath[relativePathLength + nameLength + 1] = '\0';
+                enumerateDirectoryRecursive(rootPath, relativePath, relativePathLength + nameLength + 1, onFile, data);
+            }
+            else
+            {
+                onFile(data, relativePath);
+            }
+        } while (FindNextFile(findHandle, &findData));
+
+        relativePath[relativePathLength] = '\0';
+        FindClose(findHandle);
+    }
+
+    // Our changes are collected by an overlapped ReadDirectoryChangesW that we reissue every time we consume it.
+    struct DirectoryWatcher
+    {
+        HANDLE Directory = INVALID_HANDLE_VALUE;
+        OVERLAPPED Overlapped = {};
+        alignas(DWORD) uint8_t Changes[32 * 1024];
+    };
+
+    constexpr uint32_t MaxDirectoryWatchers = 4;
+    DirectoryWatcher DirectoryWatchers[MaxDirectoryWatchers] = {};
+
+    bool readDirectoryChanges(DirectoryWatcher *watcher)
+    {
+        DWORD filter = FILE_NOTIFY_CHANGE_FILE_NAME | FILE_NOTIFY_CHANGE_LAST_WRITE | FILE_NOTIFY_CHANGE_SIZE;
+        return ReadDirectoryChangesW(watcher->Directory, watcher->Changes, sizeof(watcher->Changes), TRUE, filter, NULL, &watcher->Overlapped, NULL) != FALSE;
+    }
 } // namespace
 
 namespace IB
@@ -340,16 +551,91 @@ namespace IB
         IB_ASSERT(result == TRUE, "Failed to release memory!");
     }
 
-    void *mapLargeMemoryBlock(size_t size)
+    size_t largeMemoryPageSize()
+    {
+        // Large pages need the SeLockMemoryPrivilege ("Lock pages in memory") to be enabled for our process.
+        // Static initialization is threadsafe, we only try to enable it once.
+        static size_t const LargePageSize = []() -> size_t
+        {
+            HANDLE token = NULL;
+            if (OpenProcessToken(GetCurrentProcess(), TOKEN_ADJUST_PRIVILEGES | TOKEN_QUERY, &token) == FALSE)
+            {
+                return 0;
+            }
+
+            TOKEN_PRIVILEGES privileges = {};
+            privileges.PrivilegeCount = 1;
+            privileges.Privileges[0].Attributes = SE_PRIVILEGE_ENABLED;
+
+            bool enabled = false;
+            if (LookupPrivilegeValue(NULL, SE_LOCK_MEMORY_NAME, &privileges.Privileges[0].Luid) == TRUE)
+            {
+                // AdjustTokenPrivileges succeeds even if we don't hold the privilege, check our last error.
+                enabled = AdjustTokenPrivileges(token, FALSE, &privileges, 0, NULL, NULL) == TRUE && GetLastError() == ERROR_SUCCESS;
+            }
+            CloseHandle(token);
+
+            return enabled ? GetLargePageMinimum() : 0;
+        }();
+
+        return LargePageSize;
+    }
+
+    void *mapLargeMemoryBlock(size_t size, size_t reservedSize, uint32_t options)
     {
-        HANDLE fileMapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_COMMIT, static_cast<DWORD>(size >> 32), static_cast<DWORD>(size & 0xFFFFFFFF), NULL);
+        size = roundToPageSize(size);
+        reservedSize = reservedSize > size ? roundToPageSize(reservedSize) : size;
+
+        // Large page sections must be committed up front, we can't use them if we want to grow in place.
+        bool const useLargePages = (options & MapMemoryOptions::LargePages) != 0 && reservedSize == size && largeMemoryPageSize() != 0;
+
+        // If we're reserving more than we need, only reserve the section.
+        // Pages of a SEC_RESERVE section can be committed later through the view with VirtualAlloc,
+        // this is what allows resizeLargeMemoryBlock to grow the block without moving it.
+        DWORD const sectionFlags = reservedSize > size ? SEC_RESERVE : SEC_COMMIT;
+        HANDLE fileMapping = NULL;
+        bool largePageSection = false;
+        if (useLargePages)
+        {
+            size_t const largePageSize = largeMemoryPageSize();
+            size_t const largeSize = (size + largePageSize - 1) / largePageSize * largePageSize;
+            fileMapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | SEC_COMMIT | SEC_LARGE_PAGES, static_cast<DWORD>(largeSize >> 32), static_cast<DWORD>(largeSize & 0xFFFFFFFF), NULL);
+            if (fileMapping != NULL)
+            {
+                largePageSection = true;
+                size = largeSize;
+                reservedSize = largeSize;
+            }
+            // Otherwise we likely couldn't find enough contiguous physical memory, use regular pages.
+        }
+
+        if (fileMapping == NULL)
+        {
+            fileMapping = CreateFileMapping(INVALID_HANDLE_VALUE, NULL, PAGE_READWRITE | sectionFlags, static_cast<DWORD>(reservedSize >> 32), static_cast<DWORD>(reservedSize & 0xFFFFFFFF), NULL);
+        }
         void *map = nullptr;
 
         for (uint32_t i = 0; i < MaxMemoryFileMappingCount; i++)
         {
             if (atomicCompareExchange(&ActiveMemoryFileMappings[i].MapHandle, nullptr, fileMapping) == nullptr)
             {
-                map = MapViewOfFile(fileMapping, FILE_MAP_ALL_ACCESS, 0, 0, 0);
+                DWORD mapFlags = FILE_MAP_ALL_ACCESS;
+#ifdef FILE_MAP_LARGE_PAGES
+                if (largePageSection)
+                {
+                    mapFlags |= FILE_MAP_LARGE_PAGES;
+                }
+#endif // FILE_MAP_LARGE_PAGES
+                map = MapViewOfFile(fileMapping, mapFlags, 0, 0, 0);
+                if (map != nullptr && sectionFlags == SEC_RESERVE)
+                {
+                    LPVOID committed = VirtualAlloc(map, size, MEM_COMMIT, PAGE_READWRITE);
+                    IB_ASSERT(committed != NULL, "Failed to commit our reserved mapping!");
+                }
+
+                ActiveMemoryFileMappings[i].Size = size;
+                ActiveMemoryFileMappings[i].ReservedSize = reservedSize;
+                threadStoreStoreFence(); // Make sure our sizes are visible before our mapping can be found.
                 ActiveMemoryFileMappings[i].Mapping = map;
                 break;
             }
@@ -359,6 +645,61 @@ namespace IB
         return map;
     }
 
+    bool resizeLargeMemoryBlock(void *memory, size_t size)
+    {
+        for (uint32_t i = 0; i < MaxMemoryFileMappingCount; i++)
+        {
+            if (volatileLoad(&ActiveMemoryFileMappings[i].Mapping) == memory)
+            {
+                ActiveFileMapping *mapping = &ActiveMemoryFileMappings[i];
+
+                size = roundToPageSize(size);
+                if (size <= mapping->Size)
+                {
+                    // Mapped views can't be decommitted, shrinking simply keeps our pages around.
+                    return true;
+                }
+
+                if (size > mapping->ReservedSize)
+                {
+                    return false;
+                }
+
+                void *tail = reinterpret_cast<uint8_t *>(memory) + mapping->Size;
+                if (VirtualAlloc(tail, size - mapping->Size, MEM_COMMIT, PAGE_READWRITE) == NULL)
+                {
+                    return false;
+                }
+
+                mapping->Size = size;
+                return true;
+            }
+        }
+
+        return false;
+    }
+
+    size_t largeMemoryBlockSize(void *memory)
+    {
+        for (uint32_t i = 0; i < MaxMemoryFileMappingCount; i++)
+        {
+            if (volatileLoad(&ActiveMemoryFileMappings[i].Mapping) == memory)
+            {
+                return ActiveMemoryFileMappings[i].Size;
+            }
+        }
+
+        return 0;
+    }
+
+    size_t processResidentMemory()
+    {
+        PROCESS_MEMORY_COUNTERS counters = {};
+        BOOL result = GetProcessMemoryInfo(GetCurrentProcess(), &counters, sizeof(counters));
+        IB_ASSERT(result == TRUE, "Failed to query our process memory!");
+        return counters.WorkingSetSize;
+    }
+
     void unmapLargeMemoryBlock(void *memory)
     {
         for (uint32_t i = 0; i < MaxMemoryFileMappingCount; i++)
@@ -415,6 +756,11 @@ namespace IB
         return InterlockedAnd64NoFence(reinterpret_cast<int64_t volatile*>(atomic), andValue);
     }
 
+    uint64_t atomicAdd(uint64_t volatile *atomic, uint64_t value)
+    {
+        return InterlockedExchangeAdd64(reinterpret_cast<int64_t volatile*>(atomic), value);
+    }
+
     uint32_t processorCount()
     {
         SYSTEM_INFO systemInfo;
@@ -483,6 +829,24 @@ namespace IB
         IB_ASSERT(result != WAIT_FAILED, "Failed to wait on our event!");
     }
 
+    bool waitOnThreadEvent(ThreadEvent threadEvent, uint32_t timeoutMilliseconds)
+    {
+        DWORD result = WaitForSingleObject(reinterpret_cast<HANDLE>(threadEvent.Value), timeoutMilliseconds);
+        IB_ASSERT(result != WAIT_FAILED, "Failed to wait on our event!");
+        return result == WAIT_OBJECT_0;
+    }
+
+    void waitOnAddress(uint32_t volatile *address, uint32_t undesiredValue)
+    {
+        BOOL result = WaitOnAddress(address, &undesiredValue, sizeof(uint32_t), INFINITE);
+        IB_ASSERT(result, "Failed to wait on our address!");
+    }
+
+    void wakeOnAddress(uint32_t volatile *address)
+    {
+        WakeByAddressAll(const_cast<uint32_t *>(address));
+    }
+
     void threadStoreStoreFence()
     {
         // Assuminc x86-64 that already has store-store ordering
@@ -522,6 +886,20 @@ namespace IB
         DebugBreak();
     }
 
+    uint64_t currentTimestamp()
+    {
+        LARGE_INTEGER counter;
+        QueryPerformanceCounter(&counter);
+        return static_cast<uint64_t>(counter.QuadPart);
+    }
+
+    uint64_t timestampFrequency()
+    {
+        LARGE_INTEGER frequency;
+        QueryPerformanceFrequency(&frequency);
+        return static_cast<uint64_t>(frequency.QuadPart);
+    }
+
     File openFile(char const *filepath, uint32_t options)
     {
         DWORD access = 0;
@@ -535,6 +913,12 @@ namespace IB
             access |= GENERIC_WRITE;
         }
 
+        DWORD flags = FILE_ATTRIBUTE_NORMAL;
+        if ((options & OpenFileOptions::Asynchronous) != 0)
+        {
+            flags |= FILE_FLAG_OVERLAPPED;
+        }
+
         DWORD open = OPEN_EXISTING;
         if ((options & OpenFileOptions::Overwrite) != 0)
         {
@@ -545,12 +929,18 @@ namespace IB
             open = OPEN_ALWAYS;
         }
 
-        HANDLE fileHandle = CreateFile(filepath, access, FILE_SHARE_READ, NULL, open, FILE_ATTRIBUTE_NORMAL, NULL);
+        HANDLE fileHandle = CreateFile(filepath, access, FILE_SHARE_READ, NULL, open, flags, NULL);
         if (fileHandle == INVALID_HANDLE_VALUE)
         {
             return File{};
         }
 
+        if ((options & OpenFileOptions::Asynchronous) != 0)
+        {
+            initFileReads();
+            CreateIoCompletionPort(fileHandle, FileReads.CompletionPort, 0, 0);
+        }
+
         return File{reinterpret_cast<uintptr_t>(fileHandle)};
     }
 
@@ -633,11 +1023,99 @@ namespace IB
         return (static_cast<size_t>(high) << 32) | low;
     }
 
+    size_t readFile(File file, void *buffer, size_t size, uint64_t offset)
+    {
+        IB_ASSERT(size <= MAXDWORD, "Our read is too large!");
+        HANDLE fileHandle = reinterpret_cast<HANDLE>(file.Value);
+        HANDLE event = CreateEvent(NULL, TRUE, FALSE, NULL);
+
+        OVERLAPPED overlapped = {};
+        overlapped.Offset = static_cast<DWORD>(offset);
+        overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        // Setting the low bit of our event keeps our completion out of our I/O completion port.
+        overlapped.hEvent = reinterpret_cast<HANDLE>(reinterpret_cast<uintptr_t>(event) | 1);
+
+        DWORD bytesRead = 0;
+        if (ReadFile(fileHandle, buffer, static_cast<DWORD>(size), NULL, &overlapped) == TRUE || GetLastError() == ERROR_IO_PENDING)
+        {
+            if (GetOverlappedResult(fileHandle, &overlapped, &bytesRead, TRUE) == FALSE)
+            {
+                bytesRead = 0;
+            }
+        }
+
+        CloseHandle(event);
+        return bytesRead;
+    }
+
+    void readFileAsync(File file, void *buffer, size_t size, uint64_t offset, OnFileRead *onFileRead, void *data)
+    {
+        IB_ASSERT(size <= MAXDWORD, "Our read is too large!");
+        initFileReads();
+
+        uint32_t requestIndex = UINT32_MAX;
+        while (requestIndex == UINT32_MAX)
+        {
+            lockFileReads();
+            if (FileReads.FreeRequestCount > 0)
+            {
+                requestIndex = FileReads.FreeRequests[--FileReads.FreeRequestCount];
+            }
+            unlockFileReads();
+
+            if (requestIndex == UINT32_MAX)
+            {
+                // All of our requests are in use, give our I/O thread some time to complete them.
+                Sleep(0);
+            }
+        }
+
+        FileReadRequest *request = &FileReads.Requests[requestIndex];
+        *request = {};
+        request->Overlapped.Offset = static_cast<DWORD>(offset);
+        request->Overlapped.OffsetHigh = static_cast<DWORD>(offset >> 32);
+        request->FileHandle = reinterpret_cast<HANDLE>(file.Value);
+        request->Buffer = buffer;
+        request->Size = static_cast<DWORD>(size);
+        request->OnFileRead = onFileRead;
+        request->Data = data;
+
+        lockFileReads();
+        FileReads.QueuedRequests[(FileReads.QueueStart + FileReads.QueuedCount) % MaxFileReadRequests] = requestIndex;
+        FileReads.QueuedCount++;
+        unlockFileReads();
+
+        // Wake our I/O thread to issue our read.
+        PostQueuedCompletionStatus(FileReads.CompletionPort, 0, SubmitFileReadsKey, NULL);
+    }
+
+    void setFileReadQueueDepth(uint32_t depth)
+    {
+        IB_ASSERT(depth > 0, "We need to be able to issue at least one read.");
+        volatileStore(&FileReads.QueueDepth, depth < MaxFileReadQueueDepth ? depth : MaxFileReadQueueDepth);
+
+        // Our I/O thread might be able to issue more reads now.
+        if (volatileLoad(&FileReads.State) == 2)
+        {
+            PostQueuedCompletionStatus(FileReads.CompletionPort, 0, SubmitFileReadsKey, NULL);
+        }
+    }
+
     bool doesFileExist(char const *filepath)
     {
         return GetFileAttributes(filepath) != INVALID_FILE_ATTRIBUTES;
     }
 
+    bool createDirectory(char const *path)
+    {
+        return CreateDirectory(path, NULL) != FALSE || GetLastError() == ERROR_ALREADY_EXISTS;
+    }
+
+    bool replaceFile(char const *sourcePath, char const *destinationPath)
+    {
+        return MoveFileEx(sourcePath, destinationPath, MOVEFILE_REPLACE_EXISTING | MOVEFILE_WRITE_THROUGH) != FALSE;
+    }
+
     bool isDirectory(char const *path)
     {
         return (GetFileAttributes(path) & FILE_ATTRIBUTE_DIRECTORY) != 0;
@@ -647,6 +1125,109 @@ namespace IB
     {
         SetCurrentDirectory(path);
     }
+
+    void enumerateDirectory(char const *path, void (*onFile)(void *data, char const *relativePath), void *data)
+    {
+        char relativePath[MAX_PATH] = {};
+        enumerateDirectoryRecursive(path, relativePath, 0, onFile, data);
+    }
+
+    DirectoryWatch watchDirectory(char const *path)
+    {
+        for (uint32_t i = 0; i < MaxDirectoryWatchers; i++)
+        {
+            DirectoryWatcher *watcher = &DirectoryWatchers[i];
+            if (watcher->Directory != INVALID_HANDLE_VALUE)
+            {
+                continue;
+            }
+
+            watcher->Directory = CreateFile(path, FILE_LIST_DIRECTORY, FILE_SHARE_READ | FILE_SHARE_WRITE | FILE_SHARE_DELETE, NULL, OPEN_EXISTING, FILE_FLAG_BACKUP_SEMANTICS | FILE_FLAG_OVERLAPPED, NULL);
+            if (watcher->Directory == INVALID_HANDLE_VALUE)
+            {
+                return InvalidDirectoryWatch;
+            }
+
+            watcher->Overlapped = {};
+            if (!readDirectoryChanges(watcher))
+            {
+                CloseHandle(watcher->Directory);
+                watcher->Directory = INVALID_HANDLE_VALUE;
+                return InvalidDirectoryWatch;
+            }
+
+            return DirectoryWatch{i + 1};
+        }
+
+        IB_LOG(LogLevel::Error, "Platform", "Too many directory watches!");
+        return InvalidDirectoryWatch;
+    }
+
+    void unwatchDirectory(DirectoryWatch watch)
+    {
+        DirectoryWatcher *watcher = &DirectoryWatchers[watch.Value - 1];
+        CancelIo(watcher->Directory);
+
+        // Our buffer can't be reused until our cancelled read is done with it.
+        DWORD bytesTransferred = 0;
+        GetOverlappedResult(watcher->Directory, &watcher->Overlapped, &bytesTransferred, TRUE);
+        CloseHandle(watcher->Directory);
+        watcher->Directory = INVALID_HANDLE_VALUE;
+    }
+
+    void consumeDirectoryChanges(DirectoryWatch watch, void (*onFileChanged)(void *data, char const *relativePath), void *data)
+    {
+        DirectoryWatcher *watcher = &DirectoryWatchers[watch.Value - 1];
+
+        DWORD bytesTransferred = 0;
+        if (!GetOverlappedResult(watcher->Directory, &watcher->Overlapped, &bytesTransferred, FALSE))
+        {
+            if (GetLastError() != ERROR_IO_INCOMPLETE)
+            {
+                IB_LOG(LogLevel::Error, "Platform", "Failed to read our directory's changes.");
+            }
+            return;
+        }
+
+        if (bytesTransferred == 0)
+        {
+            IB_LOG(LogLevel::Warn, "Platform", "Too many changes to our directory, some of them were dropped.");
+        }
+
+        size_t offset = 0;
+        while (bytesTransferred > 0)
+        {
+            FILE_NOTIFY_INFORMATION const *change = reinterpret_cast<FILE_NOTIFY_INFORMATION const *>(watcher->Changes + offset);
+            if (change->Action == FILE_ACTION_ADDED || change->Action == FILE_ACTION_MODIFIED || change->Action == FILE_ACTION_RENAMED_NEW_NAME)
+            {
+                char relativePath[MAX_PATH];
+                int nameLength = static_cast<int>(change->FileNameLength / sizeof(WCHAR));
+                int pathLength = WideCharToMultiByte(CP_ACP, 0, change->FileName, nameLength, relativePath, MAX_PATH - 1, NULL, NULL);
+                if (pathLength > 0)
+                {
+                    relativePath[pathLength] = '\0';
+                    for (int i = 0; i < pathLength; i++)
+                    {
+                        relativePath[i] = relativePath[i] == '\\' ? '/' : relativePath[i];
+                    }
+                    onFileChanged(data, relativePath);
+                }
+            }
+
+            if (change->NextEntryOffset == 0)
+            {
+                break;
+            }
+            offset += change->NextEntryOffset;
+        }
+
+        // Our changes are buffered by our directory until we reissue our read, we don't miss the changes made in between.
+        watcher->Overlapped = {};
+        if (!readDirectoryChanges(watcher))
+        {
+            IB_LOG(LogLevel::Error, "Platform", "Failed to keep watching our directory.");
+        }
+    }
 } // namespace IB
 
 // Bridge
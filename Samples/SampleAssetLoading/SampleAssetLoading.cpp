@@ -35,6 +35,29 @@ public:
         return IB::Asset::complete({ ActiveTransforms++ });
     }
 
+    // Our transforms are tiny, a cell's worth of them is loaded on a single job.
+    IB::JobHandle loadBatchAsync(IB::Asset::BatchLoadContext const *context) override
+    {
+        return IB::launchJob([context]()
+        {
+            IB::Serialization::MemoryStream stream = context->Stream;
+            for (uint32_t i = 0; i < context->Count; i++)
+            {
+                uint32_t size;
+                fromBinary(&stream, &size);
+
+                IB::Mat3x4 localTransform;
+                fromBinary(&stream, &localTransform);
+
+                LocalTransforms[ActiveTransforms] = localTransform;
+                WorldTransforms[ActiveTransforms] = localTransform;
+                EntityMap[ActiveTransforms] = { static_cast<uint32_t>(context->ParentAssets[i].Value) };
+                context->Assets[i] = { ActiveTransforms++ };
+            }
+            return IB::JobResult::Complete;
+        });
+    }
+
     void saveThreadSafe(IB::Asset::SaveContext *context) override
     {
         IB::Mat3x4 transform = LocalTransforms[context->Asset.Value];
@@ -90,11 +113,13 @@ int main()
         IB::Asset::ResourceHandle meshAsset1;
         IB::Asset::ResourceHandle meshAsset2;
 
+        // Our first load interns our path, our second load can then use an id computed at compile time.
+        constexpr IB::StringId BoxPath = IB::toStringId("Box.msh");
         IB::Asset::loadResourceAsync("Box.msh", IB::Asset::toFourCC("MESH"), &meshAsset1);
-        IB::JobHandle meshJobHandle = IB::Asset::loadResourceAsync("Box.msh", IB::Asset::toFourCC("MESH"), &meshAsset2);
+        IB::JobHandle meshJobHandle = IB::Asset::loadResourceAsync(BoxPath, IB::Asset::toFourCC("MESH"), &meshAsset2);
         waitOnJob(meshJobHandle);
 
-        IB_ASSERT(meshAsset1.Hash == meshAsset2.Hash, "Loaded the same asset.");
+        IB_ASSERT(meshAsset1.Path == meshAsset2.Path, "Loaded the same asset.");
         IB::Asset::releaseResourceAsync(meshAsset2);
         IB::Asset::releaseResourceAsync(meshAsset1);
     }
@@ -131,7 +156,7 @@ int main()
         IB::Asset::ResourceHandle savedEntityResource;
         IB::JobHandle entityJobHandle = IB::Asset::loadResourceAsync("TestEntity.entt", IB::Asset::toFourCC("ENTT"), &savedEntityResource);
         waitOnJob(entityJobHandle);
-        IB_ASSERT(savedEntityResource.Hash == entityResource.Hash, "Failed to load the same asset!");
+        IB_ASSERT(savedEntityResource.Path == entityResource.Path, "Failed to load the same asset!");
 
         IB::Asset::releaseResourceAsync(entityResource);
         entityJobHandle = IB::Asset::releaseResourceAsync(savedEntityResource);
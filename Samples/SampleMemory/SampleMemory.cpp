@@ -1,8 +1,12 @@
 #define _HAS_EXCEPTIONS 0
 
 #include <IBEngine/IBAllocator.h>
+#include <IBEngine/IBContainers.h>
+#include <IBEngine/IBStdAllocator.h>
 #include <IBEngine/IBPlatform.h>
 #include <assert.h>
+#include <string.h>
+#include <vector>
 
 bool hasDuplicates(void** allocations, uint32_t count)
 {
@@ -133,9 +137,83 @@ int main()
         }
     }
 
+    // Trimming our retained memory
+    {
+        void *smallAllocations[1000];
+        void *mediumAllocations[100];
+        for (uint32_t loop = 0; loop < 2; loop++)
+        {
+            for (uint32_t i = 0; i < 1000; i++)
+            {
+                smallAllocations[i] = IB::memoryAllocate(64, 16);
+                memset(smallAllocations[i], 0xFF, 64);
+            }
+
+            for (uint32_t i = 0; i < 100; i++)
+            {
+                mediumAllocations[i] = IB::memoryAllocate(16 * 1024, 1024);
+                memset(mediumAllocations[i], 0xFF, 16 * 1024);
+            }
+
+            for (uint32_t i = 0; i < 1000; i++)
+            {
+                IB::memoryFree(smallAllocations[i]);
+            }
+
+            for (uint32_t i = 0; i < 100; i++)
+            {
+                IB::memoryFree(mediumAllocations[i]);
+            }
+
+            // Our next loop has to recommit everything we've trimmed.
+            IB::trimMemory();
+        }
+    }
+
     void *largeAllocation = IB::memoryAllocate(1024 * 1024 * 1024, 1024);
     IB::memoryFree(largeAllocation);
 
+    // Reallocations
+    {
+        // Grow through every tier and make sure our contents follow us.
+        uint8_t *memory = reinterpret_cast<uint8_t *>(IB::memoryReallocate(nullptr, 16, 16));
+        for (uint32_t i = 0; i < 16; i++)
+        {
+            memory[i] = static_cast<uint8_t>(i);
+        }
+
+        uint64_t allocationSize = 32;
+        for (uint32_t i = 0; i < 22; i++)
+        {
+            memory = reinterpret_cast<uint8_t *>(IB::memoryReallocate(memory, allocationSize, 16));
+            assert(reinterpret_cast<uintptr_t>(memory) % 16 == 0);
+            for (uint32_t j = 0; j < 16; j++)
+            {
+                assert(memory[j] == j);
+            }
+
+            allocationSize = allocationSize * 2;
+        }
+
+        // Shrink back down
+        for (uint32_t i = 0; i < 22; i++)
+        {
+            allocationSize = allocationSize / 2;
+            memory = reinterpret_cast<uint8_t *>(IB::memoryReallocate(memory, allocationSize, 16));
+            for (uint32_t j = 0; j < 16; j++)
+            {
+                assert(memory[j] == j);
+            }
+        }
+        IB::memoryFree(memory);
+
+        // A medium block with a free buddy should grow in place.
+        void *medium = IB::memoryAllocate(4096, 4096);
+        void *grown = IB::memoryReallocate(medium, 8192, 4096);
+        assert(reinterpret_cast<uintptr_t>(grown) % 4096 == 0);
+        IB::memoryFree(grown);
+    }
+
     struct TestObject
     {
         TestObject(int myInt) : MyInteger(myInt) {}
@@ -167,4 +245,159 @@ int main()
     }
 
     destroyBlockPool(&blockPool);
+
+    // Our pool blocks should respect our alignment even if our size isn't a multiple of it.
+    IB::BlockPool alignedPool = IB::createBlockPool(24, 16);
+    for (uint32_t i = 0; i < 1024; i++)
+    {
+        blocks[i] = IB::memoryAllocate(&alignedPool);
+        assert(reinterpret_cast<uintptr_t>(blocks[i]) % 16 == 0);
+    }
+    assert(!hasDuplicates(blocks, 1024));
+
+    for (uint32_t i = 0; i < 1024; i++)
+    {
+        IB::memoryFree(&alignedPool, blocks[i]);
+    }
+    destroyBlockPool(&alignedPool);
+
+    // Scratch arenas
+    {
+        IB::ScratchArena arena = IB::createScratchArena(1024);
+        for (uint32_t loop = 0; loop < 2; loop++)
+        {
+            // Our first loop spills over multiple chunks, our second loop should fit in our merged chunk.
+            for (uint32_t i = 0; i < 100; i++)
+            {
+                void *memory = IB::memoryAllocate(&arena, 64, 16);
+                assert(reinterpret_cast<uintptr_t>(memory) % 16 == 0);
+                memset(memory, 0xFF, 64);
+            }
+
+            IB::resetScratchArena(&arena);
+        }
+        IB::destroyScratchArena(&arena);
+    }
+
+    // Containers
+    {
+        IB::HashMap<uint32_t, uint32_t> map;
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            map.add(i, i * 2);
+        }
+
+        for (uint32_t i = 0; i < 10000; i += 2)
+        {
+            map.remove(i);
+        }
+
+        for (uint32_t i = 0; i < 10000; i++)
+        {
+            uint32_t *value = map.find(i);
+            assert(i % 2 == 0 ? value == nullptr : *value == i * 2);
+        }
+
+        IB::SmallVector<uint32_t, 4> smallVector;
+        for (uint32_t i = 0; i < 8; i++)
+        {
+            smallVector.add(i);
+            assert(smallVector.isInline() == (i < 4));
+        }
+
+        IB::SlotMap<TestObject> slotMap;
+        IB::SlotHandle first = slotMap.add(1);
+        IB::SlotHandle second = slotMap.add(2);
+        slotMap.remove(first);
+        assert(slotMap.find(first) == nullptr);
+        assert(slotMap.find(second)->MyInteger == 2);
+
+        // Our freed slot is reused with a new generation.
+        IB::SlotHandle third = slotMap.add(3);
+        assert(third.Index == first.Index && slotMap.find(first) == nullptr);
+    }
+
+    // Tagged and scratch containers
+    {
+        uint64_t toolsMemory = IB::memoryStats(IB::MemoryTag::Tools).AllocatedBytes;
+        {
+            IB::DynamicArray<uint32_t, IB::TaggedAllocator<IB::MemoryTag::Tools>> values;
+            values.resize(1000);
+            assert(IB::memoryStats(IB::MemoryTag::Tools).AllocatedBytes >= toolsMemory + sizeof(uint32_t) * 1000);
+        }
+        assert(IB::memoryStats(IB::MemoryTag::Tools).AllocatedBytes == toolsMemory);
+
+        IB::ScratchArena arena = IB::createScratchArena(1024, IB::MemoryTag::Tools);
+        {
+            IB::HashMap<uint32_t, uint32_t, IB::Hash<uint32_t>, IB::ScratchAllocator> map(IB::ScratchAllocator{&arena});
+            for (uint32_t i = 0; i < 1000; i++)
+            {
+                map.add(i, i * 2);
+            }
+            assert(*map.find(999) == 999 * 2);
+        }
+        IB::destroyScratchArena(&arena);
+    }
+
+    // Standard containers and memory tags
+    {
+        uint64_t toolsMemory = IB::memoryStats(IB::MemoryTag::Tools).AllocatedBytes;
+        {
+            std::vector<uint32_t, IB::StdAllocator<uint32_t, IB::MemoryTag::Tools>> values;
+            for (uint32_t i = 0; i < 1000; i++)
+            {
+                values.push_back(i);
+            }
+            assert(IB::memoryStats(IB::MemoryTag::Tools).AllocatedBytes >= toolsMemory + sizeof(uint32_t) * 1000);
+        }
+        // Our vector gave all of its memory back to our tag.
+        assert(IB::memoryStats(IB::MemoryTag::Tools).AllocatedBytes == toolsMemory);
+    }
+
+    // Memory budgets
+    {
+        struct AudioCache
+        {
+            void *Memory = nullptr;
+            uint32_t SoftPressureCount = 0;
+            uint32_t HardPressureCount = 0;
+        } audioCache;
+
+        auto onMemoryPressure = [](void *data, IB::MemoryTag, IB::MemoryPressure pressure, uint64_t)
+        {
+            AudioCache *cache = reinterpret_cast<AudioCache *>(data);
+            if (pressure == IB::MemoryPressure::Soft)
+            {
+                cache->SoftPressureCount++;
+            }
+            else
+            {
+                // Evict our cache to make room.
+                cache->HardPressureCount++;
+                IB::memoryFree(cache->Memory, IB::MemoryTag::Audio);
+                cache->Memory = nullptr;
+            }
+        };
+
+        IB::MemoryBudget budget;
+        budget.SoftLimit = 4 * 1024;
+        budget.HardLimit = 8 * 1024;
+        IB::setMemoryBudget(IB::MemoryTag::Audio, budget);
+        IB::registerMemoryPressureCallback(IB::MemoryTag::Audio, onMemoryPressure, &audioCache);
+
+        audioCache.Memory = IB::memoryAllocate(6 * 1024, 16, IB::MemoryTag::Audio);
+        assert(audioCache.SoftPressureCount == 1);
+
+        // Going over our hard limit evicts our cache.
+        void *stream = IB::tryMemoryAllocate(4 * 1024, 16, IB::MemoryTag::Audio);
+        assert(stream != nullptr && audioCache.HardPressureCount == 1 && audioCache.Memory == nullptr);
+
+        // Nothing left to evict, we stay under our hard limit.
+        assert(IB::tryMemoryAllocate(8 * 1024, 16, IB::MemoryTag::Audio) == nullptr);
+
+        IB::memoryFree(stream, IB::MemoryTag::Audio);
+        IB::unregisterMemoryPressureCallback(IB::MemoryTag::Audio, onMemoryPressure, &audioCache);
+        IB::setMemoryBudget(IB::MemoryTag::Audio, IB::MemoryBudget{});
+        assert(IB::memoryStats(IB::MemoryTag::Audio).AllocatedBytes == 0);
+    }
 }
@@ -9,6 +9,11 @@
 uint32_t volatile Counter = 0;
 int main()
 {
+    // We constantly allocate and free 1GB blocks below, let the allocator keep a few of them around.
+    IB::AllocatorPolicy policy = IB::allocatorPolicy();
+    policy.LargeBlockCacheBudget = 4ull * 1024 * 1024 * 1024;
+    IB::setAllocatorPolicy(policy);
+
     IB::initJobSystem();
 
     // Test simple jobs incrementing a global counter.
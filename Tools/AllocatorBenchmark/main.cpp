@@ -0,0 +1,730 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <IBEngine/IBAllocator.h>
+#include <IBEngine/IBPlatform.h>
+#include <IBEngine/IBLogging.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+#include <malloc.h>
+
+/*
+## Allocator Benchmark
+Headless benchmark for IB::memoryAllocate/IB::memoryFree and IB::BlockPool.
+Every benchmark is run against our allocator and against the system allocator for comparison.
+
+Usage: AllocatorBenchmark [trace file]
+
+For every benchmark, we report:
+- Throughput in millions of operations per second (an allocation and a free are both an operation)
+- Latency percentiles of our operations
+- Peak growth in resident memory over the benchmark
+- Fragmentation as our peak resident memory growth divided by the peak number of bytes we requested
+
+Traces can be captured from a running game with IB::beginAllocationTrace and IB::endAllocationTrace
+and passed on the command line to be replayed.
+*/
+
+namespace
+{
+    struct Allocator
+    {
+        char const *Name = nullptr;
+        void *(*Allocate)(size_t size, size_t alignment) = nullptr;
+        void *(*Reallocate)(void *memory, size_t size, size_t alignment) = nullptr;
+        void (*Free)(void *memory) = nullptr;
+    };
+
+    void *ibAllocate(size_t size, size_t alignment) { return IB::memoryAllocate(size, alignment); }
+    void *ibReallocate(void *memory, size_t size, size_t alignment) { return IB::memoryReallocate(memory, size, alignment); }
+    void ibFree(void *memory) { IB::memoryFree(memory); }
+
+    // We need alignment support, the aligned CRT functions are the system malloc with an alignment header.
+    void *systemAllocate(size_t size, size_t alignment) { return _aligned_malloc(size, alignment); }
+    void *systemReallocate(void *memory, size_t size, size_t alignment) { return _aligned_realloc(memory, size, alignment); }
+    void systemFree(void *memory) { _aligned_free(memory); }
+
+    constexpr uint32_t AllocatorCount = 2;
+    Allocator const Allocators[AllocatorCount] = {
+        {"IBAllocator", &ibAllocate, &ibReallocate, &ibFree},
+        {"malloc", &systemAllocate, &systemReallocate, &systemFree},
+    };
+
+    // Block pools only hand out blocks of a single size.
+    constexpr size_t PoolBlockSize = 64;
+    IB::BlockPool BenchmarkPool;
+    void *poolAllocate(size_t, size_t) { return IB::memoryAllocate(&BenchmarkPool); }
+    void poolFree(void *memory) { IB::memoryFree(&BenchmarkPool, memory); }
+
+    // Random numbers
+
+    uint64_t nextRandom(uint64_t *state)
+    {
+        // xorshift64
+        uint64_t value = *state;
+        value ^= value << 13;
+        value ^= value >> 7;
+        value ^= value << 17;
+        *state = value;
+        return value;
+    }
+
+    // Most of our allocations are small, skew our sizes to look like a game's allocations.
+    size_t randomAllocationSize(uint64_t *state)
+    {
+        uint64_t value = nextRandom(state);
+        uint64_t bucket = value % 100;
+        value = value >> 8;
+        if (bucket < 80)
+        {
+            return 8 + value % 512;
+        }
+        else if (bucket < 98)
+        {
+            return 512 + value % (64 * 1024);
+        }
+        else
+        {
+            return 64 * 1024 + value % (4 * 1024 * 1024);
+        }
+    }
+
+    // Measurements
+
+    struct Samples
+    {
+        uint32_t *Latencies = nullptr; // In ticks
+        uint32_t Count = 0;
+        uint32_t MaxCount = 0;
+    };
+
+    Samples createSamples(uint32_t maxCount)
+    {
+        // Keep our samples out of the allocators we're measuring.
+        Samples samples{};
+        samples.Latencies = reinterpret_cast<uint32_t *>(IB::mapLargeMemoryBlock(sizeof(uint32_t) * maxCount));
+        samples.MaxCount = maxCount;
+        return samples;
+    }
+
+    void destroySamples(Samples *samples)
+    {
+        IB::unmapLargeMemoryBlock(samples->Latencies);
+        *samples = {};
+    }
+
+    void recordSample(Samples *samples, uint64_t startTimestamp)
+    {
+        if (samples->Count < samples->MaxCount)
+        {
+            uint64_t ticks = IB::currentTimestamp() - startTimestamp;
+            samples->Latencies[samples->Count++] = ticks < UINT32_MAX ? static_cast<uint32_t>(ticks) : UINT32_MAX;
+        }
+    }
+
+    int compareLatencies(void const *left, void const *right)
+    {
+        uint32_t leftValue = *reinterpret_cast<uint32_t const *>(left);
+        uint32_t rightValue = *reinterpret_cast<uint32_t const *>(right);
+        return leftValue < rightValue ? -1 : (leftValue > rightValue ? 1 : 0);
+    }
+
+    struct Measurement
+    {
+        Samples Latencies;
+        uint64_t StartTimestamp = 0;
+        uint64_t EndTimestamp = 0;
+        size_t BaselineResidentBytes = 0;
+        size_t PeakResidentBytes = 0;
+        size_t PeakLiveBytes = 0;
+    };
+
+    void beginMeasurement(Measurement *measurement, uint32_t maxSampleCount)
+    {
+        // Don't let memory retained by a previous benchmark skew our resident memory.
+        IB::trimMemory();
+
+        measurement->Latencies = createSamples(maxSampleCount);
+        measurement->BaselineResidentBytes = IB::processResidentMemory();
+        measurement->PeakResidentBytes = measurement->BaselineResidentBytes;
+        measurement->PeakLiveBytes = 0;
+        measurement->StartTimestamp = IB::currentTimestamp();
+    }
+
+    void sampleResidentMemory(Measurement *measurement)
+    {
+        size_t residentBytes = IB::processResidentMemory();
+        measurement->PeakResidentBytes = residentBytes > measurement->PeakResidentBytes ? residentBytes : measurement->PeakResidentBytes;
+    }
+
+    void endMeasurement(Measurement *measurement, char const *benchmarkName, char const *allocatorName)
+    {
+        measurement->EndTimestamp = IB::currentTimestamp();
+
+        Samples *samples = &measurement->Latencies;
+        qsort(samples->Latencies, samples->Count, sizeof(uint32_t), &compareLatencies);
+
+        double const nanosecondsPerTick = 1000000000.0 / static_cast<double>(IB::timestampFrequency());
+        auto percentile = [samples, nanosecondsPerTick](double percent) -> double
+        {
+            if (samples->Count == 0)
+            {
+                return 0.0;
+            }
+
+            uint32_t index = static_cast<uint32_t>(static_cast<double>(samples->Count - 1) * percent);
+            return static_cast<double>(samples->Latencies[index]) * nanosecondsPerTick;
+        };
+
+        double seconds = static_cast<double>(measurement->EndTimestamp - measurement->StartTimestamp) / static_cast<double>(IB::timestampFrequency());
+        double operationsPerSecond = seconds > 0.0 ? static_cast<double>(samples->Count) / seconds : 0.0;
+
+        size_t residentGrowth = measurement->PeakResidentBytes - measurement->BaselineResidentBytes;
+        double fragmentation = measurement->PeakLiveBytes > 0 ? static_cast<double>(residentGrowth) / static_cast<double>(measurement->PeakLiveBytes) : 0.0;
+
+        printf("%-32s %-12s %10.2f %10.0f %10.0f %10.0f %12.0f %10.2f %8.2f\n",
+               benchmarkName, allocatorName,
+               operationsPerSecond / 1000000.0,
+               percentile(0.5), percentile(0.99), percentile(0.999), percentile(1.0),
+               static_cast<double>(residentGrowth) / (1024.0 * 1024.0),
+               fragmentation);
+
+        destroySamples(samples);
+    }
+
+    void printHeader()
+    {
+        printf("%-32s %-12s %10s %10s %10s %10s %12s %10s %8s\n",
+               "Benchmark", "Allocator", "Mops/s", "p50 ns", "p99 ns", "p99.9 ns", "max ns", "RSS MB", "Frag");
+    }
+
+    // Threading
+
+    uint32_t ReadyThreadCount = 0;
+    uint32_t StartThreads = 0;
+
+    // Make sure all our threads start hammering our allocator at the same time.
+    void waitForThreadStart()
+    {
+        IB::atomicIncrement(&ReadyThreadCount);
+        while (IB::volatileLoad(&StartThreads) == 0)
+        {
+        }
+    }
+
+    constexpr uint32_t MaxThreadCount = 64;
+    void runThreads(IB::ThreadFunc *threadFunc, void **threadData, uint32_t threadCount)
+    {
+        IB::volatileStore<uint32_t>(&ReadyThreadCount, 0);
+        IB::volatileStore<uint32_t>(&StartThreads, 0);
+
+        IB::ThreadHandle threads[MaxThreadCount];
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            threads[i] = IB::createThread(threadFunc, threadData[i]);
+        }
+
+        while (IB::volatileLoad(&ReadyThreadCount) != threadCount)
+        {
+        }
+        IB::volatileStore<uint32_t>(&StartThreads, 1);
+
+        IB::waitOnThreads(threads, threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            IB::destroyThread(threads[i]);
+        }
+    }
+
+    // Benchmarks
+
+    void sizeSweep(Allocator const &allocator)
+    {
+        constexpr uint32_t MaxAllocationCount = 10000;
+        static void *allocations[MaxAllocationCount];
+
+        size_t const sizes[] = {16, 64, 256, 512, 1024, 4 * 1024, 64 * 1024, 1024 * 1024, 4 * 1024 * 1024};
+        for (size_t size : sizes)
+        {
+            // Allocate roughly 256MB per size.
+            size_t allocationCount = 256 * 1024 * 1024 / size;
+            uint32_t count = static_cast<uint32_t>(allocationCount < MaxAllocationCount ? allocationCount : MaxAllocationCount);
+
+            Measurement measurement{};
+            beginMeasurement(&measurement, count * 2);
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint64_t start = IB::currentTimestamp();
+                allocations[i] = allocator.Allocate(size, 16);
+                recordSample(&measurement.Latencies, start);
+
+                // Touch our memory, resident memory only counts pages we've touched.
+                memset(allocations[i], 0, size);
+            }
+
+            measurement.PeakLiveBytes = size * count;
+            sampleResidentMemory(&measurement);
+
+            for (uint32_t i = 0; i < count; i++)
+            {
+                uint64_t start = IB::currentTimestamp();
+                allocator.Free(allocations[i]);
+                recordSample(&measurement.Latencies, start);
+            }
+
+            char benchmarkName[64];
+            sprintf(benchmarkName, "Size Sweep %zu bytes", size);
+            endMeasurement(&measurement, benchmarkName, allocator.Name);
+        }
+    }
+
+    struct ChurnContext
+    {
+        Allocator const *Alloc = nullptr;
+        Measurement *Measure = nullptr;
+        Samples Latencies;
+        uint64_t Seed = 0;
+        uint32_t OperationCount = 0;
+        size_t FixedSize = 0; // Use random sizes if 0
+        size_t PeakLiveBytes = 0;
+        bool SampleResidentMemory = false;
+    };
+
+    // Randomly allocate or free our slots to get allocations with random lifetimes.
+    void churn(ChurnContext *context)
+    {
+        constexpr uint32_t SlotCount = 4096;
+        void **slots = reinterpret_cast<void **>(IB::mapLargeMemoryBlock(sizeof(void *) * SlotCount));
+        size_t *slotSizes = reinterpret_cast<size_t *>(IB::mapLargeMemoryBlock(sizeof(size_t) * SlotCount));
+
+        size_t liveBytes = 0;
+        uint64_t random = context->Seed;
+        for (uint32_t i = 0; i < context->OperationCount; i++)
+        {
+            uint32_t slot = static_cast<uint32_t>(nextRandom(&random) % SlotCount);
+            if (slots[slot] == nullptr)
+            {
+                size_t size = context->FixedSize != 0 ? context->FixedSize : randomAllocationSize(&random);
+
+                uint64_t start = IB::currentTimestamp();
+                slots[slot] = context->Alloc->Allocate(size, 16);
+                recordSample(&context->Latencies, start);
+
+                // Only touch our first byte, touching everything would dominate our timings.
+                *reinterpret_cast<uint8_t *>(slots[slot]) = 0;
+
+                slotSizes[slot] = size;
+                liveBytes += size;
+                context->PeakLiveBytes = liveBytes > context->PeakLiveBytes ? liveBytes : context->PeakLiveBytes;
+            }
+            else
+            {
+                uint64_t start = IB::currentTimestamp();
+                context->Alloc->Free(slots[slot]);
+                recordSample(&context->Latencies, start);
+
+                slots[slot] = nullptr;
+                liveBytes -= slotSizes[slot];
+            }
+
+            if (context->SampleResidentMemory && i % 16384 == 0)
+            {
+                sampleResidentMemory(context->Measure);
+            }
+        }
+
+        for (uint32_t i = 0; i < SlotCount; i++)
+        {
+            if (slots[i] != nullptr)
+            {
+                context->Alloc->Free(slots[i]);
+            }
+        }
+
+        IB::unmapLargeMemoryBlock(slotSizes);
+        IB::unmapLargeMemoryBlock(slots);
+    }
+
+    void churnThread(void *data)
+    {
+        waitForThreadStart();
+        churn(reinterpret_cast<ChurnContext *>(data));
+    }
+
+    void runChurn(Allocator const &allocator, char const *benchmarkName, uint32_t threadCount, uint32_t operationCount, size_t fixedSize)
+    {
+        Measurement measurement{};
+        beginMeasurement(&measurement, 1);
+
+        ChurnContext contexts[MaxThreadCount];
+        void *threadData[MaxThreadCount];
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            contexts[i].Alloc = &allocator;
+            contexts[i].Measure = &measurement;
+            contexts[i].Latencies = createSamples(operationCount);
+            contexts[i].Seed = 0x9E3779B97F4A7C15ull * (i + 1);
+            contexts[i].OperationCount = operationCount;
+            contexts[i].FixedSize = fixedSize;
+            contexts[i].SampleResidentMemory = i == 0; // Only a single thread samples our process.
+            threadData[i] = &contexts[i];
+        }
+
+        measurement.StartTimestamp = IB::currentTimestamp();
+        runThreads(&churnThread, threadData, threadCount);
+
+        // Merge all our threads' samples.
+        destroySamples(&measurement.Latencies);
+        measurement.Latencies = createSamples(operationCount * threadCount);
+        for (uint32_t i = 0; i < threadCount; i++)
+        {
+            memcpy(measurement.Latencies.Latencies + measurement.Latencies.Count, contexts[i].Latencies.Latencies, contexts[i].Latencies.Count * sizeof(uint32_t));
+            measurement.Latencies.Count += contexts[i].Latencies.Count;
+            // Our threads don't peak at the same time, this is an upper bound.
+            measurement.PeakLiveBytes += contexts[i].PeakLiveBytes;
+            destroySamples(&contexts[i].Latencies);
+        }
+
+        endMeasurement(&measurement, benchmarkName, allocator.Name);
+    }
+
+    // Producers allocate and consumers free their allocations on another thread.
+    constexpr uint32_t QueueSize = 1024;
+    struct AllocationQueue
+    {
+        void *Allocations[QueueSize];
+        alignas(64) uint32_t Head = 0;
+        alignas(64) uint32_t Tail = 0;
+    };
+
+    struct ProducerConsumerContext
+    {
+        Allocator const *Alloc = nullptr;
+        AllocationQueue *Queue = nullptr;
+        Samples Latencies;
+        uint64_t Seed = 0;
+        uint32_t OperationCount = 0;
+        size_t PeakLiveBytes = 0;
+    };
+
+    void producerThread(void *data)
+    {
+        ProducerConsumerContext *context = reinterpret_cast<ProducerConsumerContext *>(data);
+        waitForThreadStart();
+
+        uint64_t random = context->Seed;
+        for (uint32_t i = 0; i < context->OperationCount; i++)
+        {
+            uint32_t head = context->Queue->Head;
+            // Wait for our consumer to make room.
+            while (head - IB::volatileLoad(&context->Queue->Tail) == QueueSize)
+            {
+            }
+
+            size_t size = randomAllocationSize(&random);
+            uint64_t start = IB::currentTimestamp();
+            void *memory = context->Alloc->Allocate(size, 16);
+            recordSample(&context->Latencies, start);
+            *reinterpret_cast<uint8_t *>(memory) = 0;
+
+            context->Queue->Allocations[head % QueueSize] = memory;
+            IB::threadRelease();
+            IB::volatileStore(&context->Queue->Head, head + 1);
+        }
+    }
+
+    void consumerThread(void *data)
+    {
+        ProducerConsumerContext *context = reinterpret_cast<ProducerConsumerContext *>(data);
+        waitForThreadStart();
+
+        for (uint32_t i = 0; i < context->OperationCount; i++)
+        {
+            uint32_t tail = context->Queue->Tail;
+            // Wait for our producer to give us an allocation.
+            while (IB::volatileLoad(&context->Queue->Head) == tail)
+            {
+            }
+            IB::threadAcquire();
+
+            void *memory = context->Queue->Allocations[tail % QueueSize];
+            uint64_t start = IB::currentTimestamp();
+            context->Alloc->Free(memory);
+            recordSample(&context->Latencies, start);
+
+            IB::threadRelease();
+            IB::volatileStore(&context->Queue->Tail, tail + 1);
+        }
+    }
+
+    void runProducerConsumer(Allocator const &allocator, uint32_t pairCount, uint32_t operationCount)
+    {
+        Measurement measurement{};
+        beginMeasurement(&measurement, 1);
+
+        AllocationQueue *queues = reinterpret_cast<AllocationQueue *>(IB::mapLargeMemoryBlock(sizeof(AllocationQueue) * pairCount));
+        ProducerConsumerContext contexts[MaxThreadCount];
+        void *threadData[MaxThreadCount];
+        IB::ThreadFunc *threadFuncs[MaxThreadCount];
+        for (uint32_t i = 0; i < pairCount; i++)
+        {
+            new (&queues[i]) AllocationQueue{};
+        }
+
+        for (uint32_t i = 0; i < pairCount * 2; i++)
+        {
+            contexts[i].Alloc = &allocator;
+            contexts[i].Queue = &queues[i / 2];
+            contexts[i].Latencies = createSamples(operationCount);
+            contexts[i].Seed = 0x9E3779B97F4A7C15ull * (i + 1);
+            contexts[i].OperationCount = operationCount;
+            threadData[i] = &contexts[i];
+            threadFuncs[i] = i % 2 == 0 ? &producerThread : &consumerThread;
+        }
+
+        // Our runThreads helper expects a single function, start our producers and consumers through a trampoline.
+        struct Trampoline
+        {
+            IB::ThreadFunc *Func;
+            void *Data;
+        };
+        Trampoline trampolines[MaxThreadCount];
+        void *trampolineData[MaxThreadCount];
+        for (uint32_t i = 0; i < pairCount * 2; i++)
+        {
+            trampolines[i] = Trampoline{threadFuncs[i], threadData[i]};
+            trampolineData[i] = &trampolines[i];
+        }
+
+        measurement.StartTimestamp = IB::currentTimestamp();
+        runThreads([](void *data) {
+            Trampoline *trampoline = reinterpret_cast<Trampoline *>(data);
+            trampoline->Func(trampoline->Data);
+        }, trampolineData, pairCount * 2);
+
+        destroySamples(&measurement.Latencies);
+        measurement.Latencies = createSamples(operationCount * pairCount * 2);
+        for (uint32_t i = 0; i < pairCount * 2; i++)
+        {
+            memcpy(measurement.Latencies.Latencies + measurement.Latencies.Count, contexts[i].Latencies.Latencies, contexts[i].Latencies.Count * sizeof(uint32_t));
+            measurement.Latencies.Count += contexts[i].Latencies.Count;
+            destroySamples(&contexts[i].Latencies);
+        }
+        sampleResidentMemory(&measurement);
+
+        IB::unmapLargeMemoryBlock(queues);
+        endMeasurement(&measurement, "Producer/Consumer", allocator.Name);
+    }
+
+    // Trace replay
+
+    // Addresses can be reused before our trace sees them freed when threads race,
+    // our map keeps duplicates and always frees the oldest allocation for an address.
+    struct ReplayEntry
+    {
+        uint64_t Address = 0;
+        void *Memory = nullptr;
+        size_t Size = 0;
+        uint32_t Sequence = 0;
+        uint32_t State = 0; // 0 = empty, 1 = live, 2 = removed
+    };
+
+    struct ReplayMap
+    {
+        ReplayEntry *Entries = nullptr;
+        uint64_t Mask = 0;
+        uint32_t NextSequence = 0;
+    };
+
+    uint64_t hashAddress(uint64_t address)
+    {
+        address ^= address >> 33;
+        address *= 0xFF51AFD7ED558CCDull;
+        address ^= address >> 33;
+        return address;
+    }
+
+    void insertReplayEntry(ReplayMap *map, uint64_t address, void *memory, size_t size)
+    {
+        uint64_t index = hashAddress(address) & map->Mask;
+        while (map->Entries[index].State == 1)
+        {
+            index = (index + 1) & map->Mask;
+        }
+        map->Entries[index] = ReplayEntry{address, memory, size, map->NextSequence++, 1};
+    }
+
+    ReplayEntry *removeReplayEntry(ReplayMap *map, uint64_t address)
+    {
+        ReplayEntry *oldest = nullptr;
+        for (uint64_t index = hashAddress(address) & map->Mask; map->Entries[index].State != 0; index = (index + 1) & map->Mask)
+        {
+            ReplayEntry *entry = &map->Entries[index];
+            if (entry->State == 1 && entry->Address == address && (oldest == nullptr || entry->Sequence < oldest->Sequence))
+            {
+                oldest = entry;
+            }
+        }
+
+        if (oldest != nullptr)
+        {
+            oldest->State = 2;
+        }
+        return oldest;
+    }
+
+    void replayTrace(Allocator const &allocator, IB::AllocationTraceEvent const *events, uint32_t eventCount)
+    {
+        // Every event inserts at most a single entry, make sure we never fill our map.
+        uint64_t capacity = 1;
+        while (capacity < static_cast<uint64_t>(eventCount) * 2)
+        {
+            capacity = capacity * 2;
+        }
+
+        ReplayMap map{};
+        map.Entries = reinterpret_cast<ReplayEntry *>(IB::mapLargeMemoryBlock(sizeof(ReplayEntry) * capacity));
+        map.Mask = capacity - 1;
+
+        Measurement measurement{};
+        beginMeasurement(&measurement, eventCount);
+
+        size_t liveBytes = 0;
+        for (uint32_t i = 0; i < eventCount; i++)
+        {
+            IB::AllocationTraceEvent const &event = events[i];
+            if (event.Type == IB::AllocationTraceEvent::Allocate)
+            {
+                uint64_t start = IB::currentTimestamp();
+                void *memory = allocator.Allocate(event.Size, event.Alignment);
+                recordSample(&measurement.Latencies, start);
+
+                insertReplayEntry(&map, event.Memory, memory, event.Size);
+                liveBytes += event.Size;
+            }
+            else if (event.Type == IB::AllocationTraceEvent::Free)
+            {
+                ReplayEntry *entry = removeReplayEntry(&map, event.Memory);
+                if (entry != nullptr)
+                {
+                    uint64_t start = IB::currentTimestamp();
+                    allocator.Free(entry->Memory);
+                    recordSample(&measurement.Latencies, start);
+                    liveBytes -= entry->Size;
+                }
+            }
+            else if (event.Type == IB::AllocationTraceEvent::Reallocate)
+            {
+                ReplayEntry *entry = removeReplayEntry(&map, event.PreviousMemory);
+                void *previousMemory = entry != nullptr ? entry->Memory : nullptr;
+                liveBytes -= entry != nullptr ? entry->Size : 0;
+
+                uint64_t start = IB::currentTimestamp();
+                void *memory = allocator.Reallocate(previousMemory, event.Size, event.Alignment);
+                recordSample(&measurement.Latencies, start);
+
+                insertReplayEntry(&map, event.Memory, memory, event.Size);
+                liveBytes += event.Size;
+            }
+
+            measurement.PeakLiveBytes = liveBytes > measurement.PeakLiveBytes ? liveBytes : measurement.PeakLiveBytes;
+            if (i % 16384 == 0)
+            {
+                sampleResidentMemory(&measurement);
+            }
+        }
+
+        // Release whatever our trace didn't free.
+        for (uint64_t i = 0; i < capacity; i++)
+        {
+            if (map.Entries[i].State == 1)
+            {
+                allocator.Free(map.Entries[i].Memory);
+            }
+        }
+
+        endMeasurement(&measurement, "Trace Replay", allocator.Name);
+        IB::unmapLargeMemoryBlock(map.Entries);
+    }
+} // namespace
+
+int main(int argc, char const *argv[])
+{
+    uint32_t threadCount = IB::processorCount();
+    threadCount = threadCount < MaxThreadCount ? threadCount : MaxThreadCount;
+
+    printHeader();
+
+    for (uint32_t i = 0; i < AllocatorCount; i++)
+    {
+        sizeSweep(Allocators[i]);
+    }
+
+    for (uint32_t i = 0; i < AllocatorCount; i++)
+    {
+        runChurn(Allocators[i], "Churn 1 Thread", 1, 1000000, 0);
+    }
+
+    for (uint32_t i = 0; i < AllocatorCount; i++)
+    {
+        char benchmarkName[64];
+        sprintf(benchmarkName, "Churn %u Threads", threadCount);
+        runChurn(Allocators[i], benchmarkName, threadCount, 250000, 0);
+    }
+
+    for (uint32_t i = 0; i < AllocatorCount; i++)
+    {
+        uint32_t pairCount = threadCount / 2 > 0 ? threadCount / 2 : 1;
+        runProducerConsumer(Allocators[i], pairCount, 250000);
+    }
+
+    // Block pools against our general allocators with a single block size.
+    {
+        BenchmarkPool = IB::createBlockPool(PoolBlockSize, 16);
+        Allocator poolAllocator{};
+        poolAllocator.Name = "BlockPool";
+        poolAllocator.Allocate = &poolAllocate;
+        poolAllocator.Free = &poolFree;
+
+        char benchmarkName[64];
+        sprintf(benchmarkName, "Churn %zu bytes", PoolBlockSize);
+        runChurn(poolAllocator, benchmarkName, 1, 1000000, PoolBlockSize);
+        for (uint32_t i = 0; i < AllocatorCount; i++)
+        {
+            runChurn(Allocators[i], benchmarkName, 1, 1000000, PoolBlockSize);
+        }
+
+        sprintf(benchmarkName, "Churn %zu bytes %u Threads", PoolBlockSize, threadCount);
+        runChurn(poolAllocator, benchmarkName, threadCount, 250000, PoolBlockSize);
+        for (uint32_t i = 0; i < AllocatorCount; i++)
+        {
+            runChurn(Allocators[i], benchmarkName, threadCount, 250000, PoolBlockSize);
+        }
+
+        IB::destroyBlockPool(&BenchmarkPool);
+    }
+
+    if (argc > 1)
+    {
+        IB::File traceFile = IB::openFile(argv[1], IB::OpenFileOptions::Read);
+        if (traceFile.Value == IB::InvalidFile.Value)
+        {
+            IB_LOG(IB::LogLevel::Error, "AllocatorBenchmark", "Failed to open our trace file.");
+            return 1;
+        }
+
+        uint32_t eventCount = static_cast<uint32_t>(IB::fileSize(traceFile) / sizeof(IB::AllocationTraceEvent));
+        if (eventCount > 0)
+        {
+            IB::AllocationTraceEvent const *events = reinterpret_cast<IB::AllocationTraceEvent const *>(IB::mapFile(traceFile));
+            for (uint32_t i = 0; i < AllocatorCount; i++)
+            {
+                replayTrace(Allocators[i], events, eventCount);
+            }
+            IB::unmapFile(traceFile);
+        }
+        IB::closeFile(traceFile);
+    }
+
+    return 0;
+}
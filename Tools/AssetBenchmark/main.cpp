@@ -0,0 +1,850 @@
+#define _CRT_SECURE_NO_WARNINGS
+#include <IBEngine/IBAsset.h>
+#include <IBEngine/IBEntity.h>
+#include <IBEngine/IBJobs.h>
+#include <IBEngine/IBAllocator.h>
+#include <IBEngine/IBContainers.h>
+#include <IBEngine/IBPlatform.h>
+#include <IBEngine/IBLogging.h>
+#include <IBEngine/IBSerialization.h>
+
+#include <stdio.h>
+#include <stdlib.h>
+#include <string.h>
+
+/*
+## Asset Benchmark
+Headless benchmark for IB::Asset. No window or renderer, our renderer's asset types are loaded by null streamers.
+
+Usage: AssetBenchmark [entity count] [properties per entity] [chain depth]
+
+We generate a synthetic content set under Assets/Compiled/Benchmark:
+- Meshes of sizes ranging from a few KB to a few MB, their data is read but never uploaded
+- Entities with our requested number of properties, each property references a mesh or the head of a chain
+- Chains of assets where every link depends on the next one, our deepest dependencies
+- A cell holding a copy of all of our entities, its properties are loaded in a single batch
+- The same cell with shared properties, its identical properties are stored and loaded once
+
+For every benchmark, we report:
+- Throughput in requested resources per second and in MB of asset data per second
+- Latency percentiles from our request to our resource's callback
+- Peak growth in resident memory and peak memory allocated under our Assets tag
+- Number of jobs created and executed by our job system
+*/
+
+namespace
+{
+    // Our asset loader reads from this path, relative to our working directory.
+    constexpr char const *CompiledPath = "../Assets/Compiled";
+    constexpr char const *BenchmarkDirectory = "Benchmark";
+
+    constexpr IB::Asset::FourCC MeshType = IB::Asset::toFourCC("MESH");
+    constexpr IB::Asset::FourCC EntityType = IB::Asset::toFourCC("ENTT");
+    constexpr IB::Asset::FourCC ChainType = IB::Asset::toFourCC("BCHN");
+    constexpr IB::Asset::FourCC ReferenceType = IB::Asset::toFourCC("BREF");
+    constexpr IB::Asset::FourCC SharedReferenceType = IB::Asset::toFourCC("BSRF"); // Same streamer, shares identical references
+    constexpr IB::Asset::FourCC CellType = IB::Asset::toFourCC("CELL");
+
+    // Every streamer counts its live assets, our unloads are complete once they're all back to 0.
+    uint32_t LiveAssetCount = 0;
+
+    // Stands in for our renderer's mesh streamer, our data is read from disk but never uploaded.
+    class NullMeshStreamer : public IB::Asset::IStreamer
+    {
+    public:
+        IB::Asset::LoadContinuation loadAsync(IB::Asset::LoadContext *context) override
+        {
+            // Touch our first bytes, a real streamer would at least read our header.
+            uint32_t vertexCount;
+            fromBinary(&context->Stream, &vertexCount);
+
+            IB::atomicIncrement(&LiveAssetCount);
+            return IB::Asset::complete({vertexCount});
+        }
+
+        void unloadThreadSafe(IB::Asset::AssetHandle) override
+        {
+            IB::atomicDecrement(&LiveAssetCount);
+        }
+    };
+
+    // Our links and references hold on to the resource they depend on.
+    struct Dependency
+    {
+        IB::Asset::ResourceHandle Resource = {};
+        bool HasResource = false;
+    };
+
+    // Our job is only written if we have a dependency to wait on.
+    Dependency *loadDependencyAsync(IB::Serialization::MemoryStream *stream, IB::Asset::FourCC type, IB::JobHandle *dependencyJob)
+    {
+        Dependency *dependency = IB::allocate<Dependency>();
+        IB::atomicIncrement(&LiveAssetCount);
+
+        uint32_t hasDependency;
+        fromBinary(stream, &hasDependency);
+        if (hasDependency != 0)
+        {
+            char const *path;
+            fromBinary(stream, &path);
+
+            dependency->HasResource = true;
+            *dependencyJob = IB::Asset::loadResourceAsync(path, type, &dependency->Resource);
+        }
+        return dependency;
+    }
+
+    IB::Asset::LoadContinuation loadDependency(IB::Asset::LoadContext *context, IB::Asset::FourCC type)
+    {
+        enum
+        {
+            LoadDependency = 0,
+            Complete
+        };
+
+        if (context->State == LoadDependency)
+        {
+            IB::JobHandle dependencyJob = {};
+            Dependency *dependency = loadDependencyAsync(&context->Stream, type, &dependencyJob);
+            context->Data = reinterpret_cast<uint64_t>(dependency);
+            if (!dependency->HasResource)
+            {
+                return IB::Asset::complete({context->Data});
+            }
+            return IB::Asset::wait(&dependencyJob, 1, Complete);
+        }
+        else
+        {
+            return IB::Asset::complete({context->Data});
+        }
+    }
+
+    void unloadDependency(IB::Asset::AssetHandle asset)
+    {
+        Dependency *dependency = reinterpret_cast<Dependency *>(asset.Value);
+        if (dependency->HasResource)
+        {
+            IB::Asset::releaseResourceAsync(dependency->Resource);
+        }
+        IB::deallocate(dependency);
+        IB::atomicDecrement(&LiveAssetCount);
+    }
+
+    class ChainStreamer : public IB::Asset::IStreamer
+    {
+    public:
+        IB::Asset::LoadContinuation loadAsync(IB::Asset::LoadContext *context) override
+        {
+            return loadDependency(context, ChainType);
+        }
+
+        void unloadThreadSafe(IB::Asset::AssetHandle asset) override
+        {
+            unloadDependency(asset);
+        }
+    };
+
+    // Entity property that references a mesh or a chain.
+    class ReferenceStreamer : public IB::Asset::IStreamer
+    {
+    public:
+        IB::Asset::LoadContinuation loadAsync(IB::Asset::LoadContext *context) override
+        {
+            // Our referenced type is only needed to start our load.
+            IB::Asset::FourCC type = {};
+            if (context->State == 0)
+            {
+                fromBinary(&context->Stream, &type);
+            }
+            return loadDependency(context, type);
+        }
+
+        // Our cells' references are all started right away and waited on by a single job.
+        IB::JobHandle loadBatchAsync(IB::Asset::BatchLoadContext const *context) override
+        {
+            IB::Serialization::MemoryStream stream = context->Stream;
+            IB::JobHandle *dependencyJobs = IB::allocateArray<IB::JobHandle>(context->Count);
+            uint32_t dependencyCount = 0;
+            for (uint32_t i = 0; i < context->Count; i++)
+            {
+                uint32_t size;
+                fromBinary(&stream, &size);
+                IB::Serialization::MemoryStream propertyStream = stream;
+                IB::Serialization::advance(&stream, size);
+
+                IB::Asset::FourCC type;
+                fromBinary(&propertyStream, &type);
+                Dependency *dependency = loadDependencyAsync(&propertyStream, type, &dependencyJobs[dependencyCount]);
+                dependencyCount += dependency->HasResource ? 1 : 0;
+                context->Assets[i] = {reinterpret_cast<uint64_t>(dependency)};
+            }
+
+            IB::JobHandle batchJob = dependencyCount > 0 ? IB::continueJob([]() { return IB::JobResult::Complete; }, dependencyJobs, dependencyCount)
+                                                         : IB::launchJob([]() { return IB::JobResult::Complete; });
+            IB::deallocateArray(dependencyJobs, context->Count);
+            return batchJob;
+        }
+
+        void unloadThreadSafe(IB::Asset::AssetHandle asset) override
+        {
+            unloadDependency(asset);
+        }
+    };
+
+    NullMeshStreamer MeshStreamer;
+    ChainStreamer LinkStreamer;
+    ReferenceStreamer PropertyStreamer;
+
+    // Random numbers
+
+    uint64_t nextRandom(uint64_t *state)
+    {
+        // xorshift64
+        uint64_t value = *state;
+        value ^= value << 13;
+        value ^= value >> 7;
+        value ^= value << 17;
+        *state = value;
+        return value;
+    }
+
+    // Most of our meshes are small, a few of them are large.
+    size_t randomMeshSize(uint64_t *state)
+    {
+        uint64_t value = nextRandom(state);
+        uint64_t bucket = value % 100;
+        value = value >> 8;
+        if (bucket < 70)
+        {
+            return 4 * 1024 + value % (64 * 1024);
+        }
+        else if (bucket < 95)
+        {
+            return 64 * 1024 + value % (1024 * 1024);
+        }
+        else
+        {
+            return 1024 * 1024 + value % (4 * 1024 * 1024);
+        }
+    }
+
+    // Content generation
+
+    struct ContentDesc
+    {
+        uint32_t EntityCount = 1000;
+        uint32_t PropertyCount = 8;
+        uint32_t MeshCount = 64;
+        uint32_t ChainCount = 32;
+        uint32_t ChainDepth = 16;
+    };
+
+    struct Content
+    {
+        IB::StringId *Entities = nullptr;
+        IB::StringId *ChainHeads = nullptr;
+        IB::Asset::FourCC *EntityTypes = nullptr; // Our batched loads need a type per path
+        IB::StringId Cell = {}; // Holds a copy of all of our entities
+        IB::StringId SharedCell = {}; // Our cell with shared references
+        uint64_t MeshBytes = 0;
+        uint64_t EntityBytes = 0; // Our entities and every asset they reference, the bytes read by loading all of our entities
+        uint64_t CellBytes = 0; // Our cell and every asset it references
+        uint64_t SharedCellBytes = 0;
+        uint64_t ChainBytes = 0;
+    };
+
+    // Returns the size of our asset.
+    uint64_t writeAsset(char const *relativePath, IB::Serialization::BufferStream const *stream)
+    {
+        char fullPath[255];
+        sprintf(fullPath, "%s/%s", CompiledPath, relativePath);
+
+        IB::File file = IB::openFile(fullPath, IB::OpenFileOptions::Create | IB::OpenFileOptions::Overwrite | IB::OpenFileOptions::Write);
+        IB_ASSERT(file.Value != IB::InvalidFile.Value, "Failed to create our benchmark asset!");
+        IB::appendToFile(file, stream->Memory, stream->Size);
+        IB::closeFile(file);
+
+        return stream->Size;
+    }
+
+    void writeReference(IB::Serialization::BufferStream *stream, char const *path)
+    {
+        IB::Serialization::toBinary(stream, path != nullptr ? 1u : 0u);
+        if (path != nullptr)
+        {
+            IB::Serialization::toBinary(stream, path);
+        }
+    }
+
+    // One group of cell properties, laid out like IB::CellAssetStreamer saves them.
+    struct CellGroup
+    {
+        bool SharePayloads = false;
+        IB::DynamicArray<uint32_t> EntityIndices;
+        IB::DynamicArray<uint32_t> PayloadIndices;
+        IB::DynamicArray<IB::Asset::ContentHash> ContentHashes;
+        IB::DynamicArray<size_t> PayloadOffsets; // Where each payload's size prefix is in Payloads
+        IB::HashMap<uint64_t, uint32_t> PayloadsByHash;
+        IB::Serialization::BufferStream Payloads;
+    };
+
+    void addCellProperty(CellGroup *group, uint32_t entityIndex, IB::Serialization::BufferStream const *payload)
+    {
+        IB::Asset::ContentHash contentHash = IB::Asset::hashContent(payload->Memory, payload->Size);
+        uint32_t *sharedPayload = group->SharePayloads ? group->PayloadsByHash.find(contentHash.Value) : nullptr;
+        bool identical = false;
+        if (sharedPayload != nullptr)
+        {
+            // Our hashes can collide, only share our payload if its bytes match as well.
+            size_t sharedOffset = group->PayloadOffsets[*sharedPayload];
+            uint32_t sharedSize;
+            memcpy(&sharedSize, group->Payloads.Memory + sharedOffset, sizeof(uint32_t));
+            identical = sharedSize == payload->Size && memcmp(group->Payloads.Memory + sharedOffset + sizeof(uint32_t), payload->Memory, payload->Size) == 0;
+        }
+
+        if (identical)
+        {
+            group->PayloadIndices.add(*sharedPayload);
+        }
+        else
+        {
+            if (sharedPayload == nullptr && group->SharePayloads)
+            {
+                group->PayloadsByHash.add(contentHash.Value, group->ContentHashes.count());
+            }
+            group->PayloadIndices.add(group->ContentHashes.count());
+            group->PayloadOffsets.add(group->Payloads.Size);
+            group->ContentHashes.add(sharedPayload == nullptr ? contentHash : IB::Asset::ContentHash{});
+            IB::Serialization::toBinary(&group->Payloads, static_cast<uint32_t>(payload->Size));
+            IB::Serialization::toBinary(&group->Payloads, payload->Memory, payload->Size);
+        }
+        group->EntityIndices.add(entityIndex);
+    }
+
+    // Returns the size of our cell.
+    uint64_t writeCell(char const *relativePath, IB::Asset::FourCC type, CellGroup const *group, uint32_t entityCount)
+    {
+        uint32_t propertyCount = group->EntityIndices.count();
+        uint32_t payloadCount = group->ContentHashes.count();
+        size_t tableSize = sizeof(uint32_t) * 2 * propertyCount + sizeof(IB::Asset::ContentHash) * payloadCount;
+
+        IB::Serialization::BufferStream cell;
+        IB::Serialization::toBinary(&cell, entityCount);
+        IB::Serialization::toBinary(&cell, propertyCount > 0 ? 1u : 0u);
+        if (propertyCount > 0)
+        {
+            IB::Serialization::toBinary(&cell, type);
+            IB::Serialization::toBinary(&cell, propertyCount);
+            IB::Serialization::toBinary(&cell, payloadCount);
+            IB::Serialization::toBinary(&cell, static_cast<uint32_t>(tableSize + group->Payloads.Size));
+            IB::Serialization::toBinary(&cell, group->EntityIndices.data(), sizeof(uint32_t) * propertyCount);
+            IB::Serialization::toBinary(&cell, group->PayloadIndices.data(), sizeof(uint32_t) * propertyCount);
+            IB::Serialization::toBinary(&cell, group->ContentHashes.data(), sizeof(IB::Asset::ContentHash) * payloadCount);
+            IB::Serialization::toBinary(&cell, group->Payloads.Memory, group->Payloads.Size);
+        }
+        return writeAsset(relativePath, &cell);
+    }
+
+    void meshPath(char *path, uint32_t index) { sprintf(path, "%s/Mesh%u.msh", BenchmarkDirectory, index); }
+    void chainPath(char *path, uint32_t chain, uint32_t link) { sprintf(path, "%s/Chain%u_%u.bchn", BenchmarkDirectory, chain, link); }
+    void entityPath(char *path, uint32_t index) { sprintf(path, "%s/Entity%u.entt", BenchmarkDirectory, index); }
+    void cellPath(char *path, char const *name) { sprintf(path, "%s/%s.cell", BenchmarkDirectory, name); }
+
+    Content generateContent(ContentDesc const &desc)
+    {
+        IB_ASSERT(desc.PropertyCount <= IB::Asset::MaxDependencyCount, "Our entities can't have that many properties!");
+
+        char directory[255];
+        sprintf(directory, "%s/%s", CompiledPath, BenchmarkDirectory);
+        bool created = IB::createDirectory(directory);
+        IB_ASSERT(created, "Failed to create our benchmark directory! Run from a directory next to our Assets directory.");
+
+        Content content = {};
+        content.Entities = IB::allocateArray<IB::StringId>(desc.EntityCount);
+        content.EntityTypes = IB::allocateArray<IB::Asset::FourCC>(desc.EntityCount);
+        content.ChainHeads = IB::allocateArray<IB::StringId>(desc.ChainCount);
+
+        // Our referenced assets are only loaded once, no matter how many entities reference them.
+        uint64_t *meshSizes = IB::allocateArray<uint64_t>(desc.MeshCount);
+        uint64_t *chainSizes = IB::allocateArray<uint64_t>(desc.ChainCount);
+        bool *meshReferenced = IB::allocateArray<bool>(desc.MeshCount);
+        bool *chainReferenced = IB::allocateArray<bool>(desc.ChainCount);
+
+        uint64_t random = 0x9E3779B97F4A7C15ull;
+        char path[255];
+        for (uint32_t i = 0; i < desc.MeshCount; i++)
+        {
+            size_t size = randomMeshSize(&random);
+            IB::Serialization::BufferStream stream;
+            for (size_t written = 0; written < size; written += sizeof(uint64_t))
+            {
+                IB::Serialization::toBinary(&stream, nextRandom(&random));
+            }
+
+            meshPath(path, i);
+            meshSizes[i] = writeAsset(path, &stream);
+            content.MeshBytes += meshSizes[i];
+        }
+
+        for (uint32_t chain = 0; chain < desc.ChainCount; chain++)
+        {
+            for (uint32_t link = 0; link < desc.ChainDepth; link++)
+            {
+                char nextPath[255];
+                chainPath(nextPath, chain, link + 1);
+
+                IB::Serialization::BufferStream stream;
+                writeReference(&stream, link + 1 < desc.ChainDepth ? nextPath : nullptr);
+
+                chainPath(path, chain, link);
+                chainSizes[chain] += writeAsset(path, &stream);
+            }
+            content.ChainBytes += chainSizes[chain];
+
+            chainPath(path, chain, 0);
+            content.ChainHeads[chain] = IB::internString(path);
+        }
+
+        // Our cells' properties are all references, they form a single group.
+        CellGroup cellGroup;
+        CellGroup sharedCellGroup;
+        sharedCellGroup.SharePayloads = true;
+        for (uint32_t i = 0; i < desc.EntityCount; i++)
+        {
+            IB::Serialization::BufferStream stream;
+            IB::Serialization::toBinary(&stream, desc.PropertyCount);
+            for (uint32_t property = 0; property < desc.PropertyCount; property++)
+            {
+                // Every fourth property references a chain, the rest reference our shared meshes.
+                bool isChain = property % 4 == 3 && desc.ChainCount > 0;
+                char referencePath[255];
+                if (isChain)
+                {
+                    uint32_t chain = static_cast<uint32_t>(nextRandom(&random) % desc.ChainCount);
+                    chainPath(referencePath, chain, 0);
+                    chainReferenced[chain] = true;
+                }
+                else
+                {
+                    uint32_t mesh = static_cast<uint32_t>(nextRandom(&random) % desc.MeshCount);
+                    meshPath(referencePath, mesh);
+                    meshReferenced[mesh] = true;
+                }
+
+                IB::Serialization::BufferStream reference;
+                IB::Serialization::toBinary(&reference, isChain ? ChainType : MeshType);
+                writeReference(&reference, referencePath);
+
+                IB::Serialization::toBinary(&stream, ReferenceType);
+                IB::Serialization::toBinary(&stream, IB::Asset::hashContent(reference.Memory, reference.Size));
+                IB::Serialization::toBinary(&stream, static_cast<uint32_t>(reference.Size));
+                IB::Serialization::toBinary(&stream, reference.Memory, reference.Size);
+
+                addCellProperty(&cellGroup, i, &reference);
+                addCellProperty(&sharedCellGroup, i, &reference);
+            }
+
+            entityPath(path, i);
+            content.EntityBytes += writeAsset(path, &stream);
+            content.Entities[i] = IB::internString(path);
+            content.EntityTypes[i] = EntityType;
+        }
+
+        cellPath(path, "Cell");
+        content.CellBytes = writeCell(path, ReferenceType, &cellGroup, desc.EntityCount);
+        content.Cell = IB::internString(path);
+
+        cellPath(path, "SharedCell");
+        content.SharedCellBytes = writeCell(path, SharedReferenceType, &sharedCellGroup, desc.EntityCount);
+        content.SharedCell = IB::internString(path);
+
+        uint64_t referencedBytes = 0;
+        for (uint32_t i = 0; i < desc.MeshCount; i++)
+        {
+            referencedBytes += meshReferenced[i] ? meshSizes[i] : 0;
+        }
+
+        for (uint32_t i = 0; i < desc.ChainCount; i++)
+        {
+            referencedBytes += chainReferenced[i] ? chainSizes[i] : 0;
+        }
+        content.EntityBytes += referencedBytes;
+        content.CellBytes += referencedBytes;
+        content.SharedCellBytes += referencedBytes;
+
+        IB::deallocateArray(meshSizes, desc.MeshCount);
+        IB::deallocateArray(chainSizes, desc.ChainCount);
+        IB::deallocateArray(meshReferenced, desc.MeshCount);
+        IB::deallocateArray(chainReferenced, desc.ChainCount);
+        return content;
+    }
+
+    void destroyContent(Content *content, ContentDesc const &desc)
+    {
+        IB::deallocateArray(content->Entities, desc.EntityCount);
+        IB::deallocateArray(content->EntityTypes, desc.EntityCount);
+        IB::deallocateArray(content->ChainHeads, desc.ChainCount);
+        *content = {};
+    }
+
+    // Measurements
+
+    // Signaled once all of our requests are complete, our waits also use it to wake up every millisecond.
+    IB::ThreadEvent CompletedEvent = {};
+
+    struct Samples
+    {
+        uint64_t *StartTimestamps = nullptr;
+        uint32_t *Latencies = nullptr; // In ticks
+        uint32_t Count = 0;
+        uint32_t MaxCount = 0;
+    };
+
+    Samples createSamples(uint32_t maxCount)
+    {
+        // Keep our samples out of the memory we're measuring.
+        Samples samples{};
+        samples.StartTimestamps = reinterpret_cast<uint64_t *>(IB::mapLargeMemoryBlock(sizeof(uint64_t) * maxCount));
+        samples.Latencies = reinterpret_cast<uint32_t *>(IB::mapLargeMemoryBlock(sizeof(uint32_t) * maxCount));
+        samples.MaxCount = maxCount;
+        return samples;
+    }
+
+    void destroySamples(Samples *samples)
+    {
+        IB::unmapLargeMemoryBlock(samples->StartTimestamps);
+        IB::unmapLargeMemoryBlock(samples->Latencies);
+        *samples = {};
+    }
+
+    int compareLatencies(void const *left, void const *right)
+    {
+        uint32_t leftValue = *reinterpret_cast<uint32_t const *>(left);
+        uint32_t rightValue = *reinterpret_cast<uint32_t const *>(right);
+        return leftValue < rightValue ? -1 : (leftValue > rightValue ? 1 : 0);
+    }
+
+    struct Measurement
+    {
+        Samples Latencies;
+        uint32_t RequestCount = 0;
+        uint32_t CompletedCount = 0;
+
+        uint64_t StartTimestamp = 0;
+        uint64_t EndTimestamp = 0;
+        size_t BaselineResidentBytes = 0;
+        size_t PeakResidentBytes = 0;
+        uint64_t PeakAssetBytes = 0;
+        IB::JobStats BaselineJobs = {};
+    };
+
+    void sampleMemory(Measurement *measurement)
+    {
+        size_t residentBytes = IB::processResidentMemory();
+        measurement->PeakResidentBytes = residentBytes > measurement->PeakResidentBytes ? residentBytes : measurement->PeakResidentBytes;
+
+        uint64_t assetBytes = IB::memoryStats(IB::MemoryTag::Assets).AllocatedBytes;
+        measurement->PeakAssetBytes = assetBytes > measurement->PeakAssetBytes ? assetBytes : measurement->PeakAssetBytes;
+    }
+
+    void beginMeasurement(Measurement *measurement, uint32_t requestCount)
+    {
+        // Don't let memory retained by a previous benchmark skew our resident memory.
+        IB::trimMemory();
+
+        *measurement = {};
+        measurement->Latencies = createSamples(requestCount);
+        measurement->RequestCount = requestCount;
+        measurement->BaselineResidentBytes = IB::processResidentMemory();
+        measurement->PeakResidentBytes = measurement->BaselineResidentBytes;
+        measurement->BaselineJobs = IB::jobStats();
+        measurement->StartTimestamp = IB::currentTimestamp();
+    }
+
+    struct Request
+    {
+        Measurement *Measure;
+        uint32_t Index;
+    };
+
+    void recordCompletion(Measurement *measurement, uint32_t index)
+    {
+        uint64_t ticks = IB::currentTimestamp() - measurement->Latencies.StartTimestamps[index];
+        measurement->Latencies.Latencies[index] = ticks < UINT32_MAX ? static_cast<uint32_t>(ticks) : UINT32_MAX;
+
+        if (IB::atomicIncrement(&measurement->CompletedCount) == measurement->RequestCount)
+        {
+            IB::signalThreadEvent(CompletedEvent);
+        }
+    }
+
+    // Our callbacks are called from our workers, wake up every millisecond to sample our memory as we wait.
+    void waitForRequests(Measurement *measurement)
+    {
+        while (IB::volatileLoad(&measurement->CompletedCount) != measurement->RequestCount)
+        {
+            IB::waitOnThreadEvent(CompletedEvent, 1);
+            sampleMemory(measurement);
+        }
+        IB::threadAcquire();
+    }
+
+    // Our unloads complete on our workers, wait until our streamers have released everything.
+    void waitForUnloads(Measurement *measurement)
+    {
+        while (IB::volatileLoad(&LiveAssetCount) != 0)
+        {
+            IB::waitOnThreadEvent(CompletedEvent, 1);
+            if (measurement != nullptr)
+            {
+                sampleMemory(measurement);
+            }
+        }
+    }
+
+    void endMeasurement(Measurement *measurement, char const *benchmarkName, uint64_t bytes)
+    {
+        measurement->EndTimestamp = IB::currentTimestamp();
+        sampleMemory(measurement);
+        IB::JobStats jobs = IB::jobStats();
+
+        Samples *samples = &measurement->Latencies;
+        samples->Count = measurement->CompletedCount;
+        qsort(samples->Latencies, samples->Count, sizeof(uint32_t), &compareLatencies);
+
+        double const millisecondsPerTick = 1000.0 / static_cast<double>(IB::timestampFrequency());
+        auto percentile = [samples, millisecondsPerTick](double percent) -> double
+        {
+            if (samples->Count == 0)
+            {
+                return 0.0;
+            }
+
+            uint32_t index = static_cast<uint32_t>(static_cast<double>(samples->Count - 1) * percent);
+            return static_cast<double>(samples->Latencies[index]) * millisecondsPerTick;
+        };
+
+        double seconds = static_cast<double>(measurement->EndTimestamp - measurement->StartTimestamp) / static_cast<double>(IB::timestampFrequency());
+        double requestsPerSecond = seconds > 0.0 ? static_cast<double>(samples->Count) / seconds : 0.0;
+        double megabytesPerSecond = seconds > 0.0 ? static_cast<double>(bytes) / (1024.0 * 1024.0) / seconds : 0.0;
+
+        printf("%-28s %10.0f %10.1f %9.2f %9.2f %9.2f %9.2f %9.1f %9.1f %10llu %10llu\n",
+               benchmarkName,
+               requestsPerSecond,
+               megabytesPerSecond,
+               seconds * 1000.0,
+               percentile(0.5), percentile(0.99), percentile(1.0),
+               static_cast<double>(measurement->PeakResidentBytes - measurement->BaselineResidentBytes) / (1024.0 * 1024.0),
+               static_cast<double>(measurement->PeakAssetBytes) / (1024.0 * 1024.0),
+               static_cast<unsigned long long>(jobs.CreatedJobCount - measurement->BaselineJobs.CreatedJobCount),
+               static_cast<unsigned long long>(jobs.ExecutedJobCount - measurement->BaselineJobs.ExecutedJobCount));
+
+        destroySamples(samples);
+    }
+
+    void printHeader()
+    {
+        printf("%-28s %10s %10s %9s %9s %9s %9s %9s %9s %10s %10s\n",
+               "Benchmark", "Loads/s", "MB/s", "Total ms", "p50 ms", "p99 ms", "max ms", "RSS MB", "Assets MB", "Jobs", "Executed");
+    }
+
+    // Benchmarks
+
+    void onResourceLoad(void *data, IB::Asset::ResourceHandle)
+    {
+        Request *request = reinterpret_cast<Request *>(data);
+        recordCompletion(request->Measure, request->Index);
+    }
+
+    // Requests every path, copiesPerPath times in a row. Our copies share a single load.
+    void loadEach(Measurement *measurement, IB::StringId const *paths, IB::Asset::FourCC type, uint32_t pathCount, uint32_t copiesPerPath, Request *requests)
+    {
+        for (uint32_t i = 0; i < pathCount * copiesPerPath; i++)
+        {
+            requests[i] = Request{measurement, i};
+            measurement->Latencies.StartTimestamps[i] = IB::currentTimestamp();
+            IB::Asset::loadResourceAsync(paths[i / copiesPerPath], type, &onResourceLoad, &requests[i]);
+        }
+    }
+
+    void releaseEach(IB::StringId const *paths, uint32_t pathCount, uint32_t copiesPerPath)
+    {
+        for (uint32_t i = 0; i < pathCount * copiesPerPath; i++)
+        {
+            IB::Asset::releaseResourceAsync(IB::Asset::ResourceHandle{paths[i / copiesPerPath]});
+        }
+    }
+
+    void runLoad(char const *benchmarkName, IB::StringId const *paths, IB::Asset::FourCC type, uint32_t pathCount, uint32_t copiesPerPath, uint64_t bytes)
+    {
+        uint32_t requestCount = pathCount * copiesPerPath;
+        Request *requests = IB::allocateArray<Request>(requestCount);
+
+        Measurement measurement{};
+        beginMeasurement(&measurement, requestCount);
+        loadEach(&measurement, paths, type, pathCount, copiesPerPath, requests);
+        waitForRequests(&measurement);
+        endMeasurement(&measurement, benchmarkName, bytes);
+
+        // Our unloads are measured on their own, every release is a single request.
+        char unloadName[64];
+        sprintf(unloadName, "%s Unload", benchmarkName);
+        beginMeasurement(&measurement, requestCount);
+        for (uint32_t i = 0; i < requestCount; i++)
+        {
+            measurement.Latencies.StartTimestamps[i] = IB::currentTimestamp();
+            IB::Asset::releaseResourceAsync(IB::Asset::ResourceHandle{paths[i / copiesPerPath]});
+            recordCompletion(&measurement, i);
+        }
+        waitForUnloads(&measurement);
+        endMeasurement(&measurement, unloadName, 0);
+
+        IB::deallocateArray(requests, requestCount);
+    }
+
+    void runBatchLoad(Content const &content, ContentDesc const &desc)
+    {
+        IB::Asset::ResourceHandle *resources = IB::allocateArray<IB::Asset::ResourceHandle>(desc.EntityCount);
+
+        // Our batch is a single request with a single handle.
+        Measurement measurement{};
+        beginMeasurement(&measurement, 1);
+        measurement.Latencies.StartTimestamps[0] = IB::currentTimestamp();
+
+        IB::JobHandle batchJob = IB::Asset::loadResourcesAsync(content.Entities, content.EntityTypes, desc.EntityCount, resources);
+        IB::continueJob([&measurement]() {
+            recordCompletion(&measurement, 0);
+            return IB::JobResult::Complete;
+        },
+                        &batchJob, 1);
+
+        waitForRequests(&measurement);
+        endMeasurement(&measurement, "Batch Load", content.EntityBytes);
+
+        releaseEach(content.Entities, desc.EntityCount, 1);
+        waitForUnloads(nullptr);
+        IB::deallocateArray(resources, desc.EntityCount);
+    }
+
+    void runCachedReload(Content const &content, ContentDesc const &desc)
+    {
+        IB::Asset::setResourceCacheBudget(UINT64_MAX);
+
+        // Fill our cache, our measured load shouldn't touch the disk.
+        Request *requests = IB::allocateArray<Request>(desc.EntityCount);
+        Measurement measurement{};
+        beginMeasurement(&measurement, desc.EntityCount);
+        loadEach(&measurement, content.Entities, EntityType, desc.EntityCount, 1, requests);
+        waitForRequests(&measurement);
+        releaseEach(content.Entities, desc.EntityCount, 1);
+        destroySamples(&measurement.Latencies);
+
+        beginMeasurement(&measurement, desc.EntityCount);
+        loadEach(&measurement, content.Entities, EntityType, desc.EntityCount, 1, requests);
+        waitForRequests(&measurement);
+        endMeasurement(&measurement, "Cached Reload", 0);
+
+        releaseEach(content.Entities, desc.EntityCount, 1);
+        IB::Asset::setResourceCacheBudget(0);
+        waitForUnloads(nullptr);
+        IB::deallocateArray(requests, desc.EntityCount);
+    }
+
+    // Our releases are queued and unloaded at our frame boundaries, one pass per frame until our queue is empty.
+    // Releasing an entity queues its properties' references, they're unloaded on our next pass.
+    void runDeferredUnload(Content const &content, ContentDesc const &desc)
+    {
+        Request *requests = IB::allocateArray<Request>(desc.EntityCount);
+        Measurement measurement{};
+        beginMeasurement(&measurement, desc.EntityCount);
+        loadEach(&measurement, content.Entities, EntityType, desc.EntityCount, 1, requests);
+        waitForRequests(&measurement);
+        destroySamples(&measurement.Latencies);
+
+        IB::Asset::setDeferredReleases(true);
+        beginMeasurement(&measurement, desc.EntityCount);
+        for (uint32_t i = 0; i < desc.EntityCount; i++)
+        {
+            measurement.Latencies.StartTimestamps[i] = IB::currentTimestamp();
+            IB::Asset::releaseResourceAsync(IB::Asset::ResourceHandle{content.Entities[i]});
+            recordCompletion(&measurement, i);
+        }
+
+        while (IB::Asset::processReleaseQueue() > 0)
+        {
+            sampleMemory(&measurement);
+        }
+        waitForUnloads(&measurement);
+        endMeasurement(&measurement, "Entity Deferred Unload", 0);
+
+        IB::Asset::setDeferredReleases(false);
+        IB::deallocateArray(requests, desc.EntityCount);
+    }
+
+    // Profiled on its own, our timings above don't pay for our profile.
+    void runProfiledLoad(Content const &content, ContentDesc const &desc)
+    {
+        constexpr char TimelinePath[] = "AssetBenchmark.timeline.json";
+        constexpr char SummaryPath[] = "AssetBenchmark.summary.txt";
+
+        Request *requests = IB::allocateArray<Request>(desc.EntityCount);
+        Measurement measurement{};
+        beginMeasurement(&measurement, desc.EntityCount);
+
+        IB::Asset::beginLoadProfile();
+        loadEach(&measurement, content.Entities, EntityType, desc.EntityCount, 1, requests);
+        waitForRequests(&measurement);
+        bool written = IB::Asset::endLoadProfile(TimelinePath, SummaryPath);
+        destroySamples(&measurement.Latencies);
+
+        releaseEach(content.Entities, desc.EntityCount, 1);
+        waitForUnloads(nullptr);
+        IB::deallocateArray(requests, desc.EntityCount);
+
+        if (written)
+        {
+            printf("\nEntity load profile written to %s and %s\n", TimelinePath, SummaryPath);
+        }
+    }
+} // namespace
+
+int main(int argc, char const *argv[])
+{
+    ContentDesc desc = {};
+    desc.EntityCount = argc > 1 ? static_cast<uint32_t>(atoi(argv[1])) : desc.EntityCount;
+    desc.PropertyCount = argc > 2 ? static_cast<uint32_t>(atoi(argv[2])) : desc.PropertyCount;
+    desc.ChainDepth = argc > 3 ? static_cast<uint32_t>(atoi(argv[3])) : desc.ChainDepth;
+
+    IB::Serialization::initSerialization();
+    IB::initJobSystem();
+    IB::initEntitySystem();
+
+    IB::Asset::addStreamer(MeshType, &MeshStreamer);
+    IB::Asset::addStreamer(ChainType, &LinkStreamer);
+    IB::Asset::addStreamer(ReferenceType, &PropertyStreamer);
+    IB::Asset::addStreamer(SharedReferenceType, &PropertyStreamer, IB::Asset::StreamerOptions::ShareIdenticalAssets);
+
+    CompletedEvent = IB::createThreadEvent();
+    Content content = generateContent(desc);
+    printf("%u entities, %u properties per entity, %u meshes (%.1f MB), %u chains of depth %u\n\n",
+           desc.EntityCount, desc.PropertyCount, desc.MeshCount, static_cast<double>(content.MeshBytes) / (1024.0 * 1024.0), desc.ChainCount, desc.ChainDepth);
+
+    printHeader();
+    runLoad("Entity Load", content.Entities, EntityType, desc.EntityCount, 1, content.EntityBytes);
+    runLoad("Duplicate Requests x4", content.Entities, EntityType, desc.EntityCount, 4, content.EntityBytes);
+    runLoad("Chain Load", content.ChainHeads, ChainType, desc.ChainCount, 1, content.ChainBytes);
+    runLoad("Cell Load", &content.Cell, CellType, 1, 1, content.CellBytes);
+    runLoad("Shared Cell Load", &content.SharedCell, CellType, 1, 1, content.SharedCellBytes);
+    runBatchLoad(content, desc);
+    runCachedReload(content, desc);
+    runDeferredUnload(content, desc);
+    runProfiledLoad(content, desc);
+
+    destroyContent(&content, desc);
+    IB::destroyThreadEvent(CompletedEvent);
+
+    IB::killEntitySystem();
+    IB::killJobSystem();
+    IB::Serialization::killSerialization();
+    return 0;
+}
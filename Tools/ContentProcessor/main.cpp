@@ -5,6 +5,10 @@
 #include <IBEngine/IBRendererFrontend.h>
 #include <IBEngine/IBSerialization.h>
 #include <IBEngine/IBAllocator.h>
+#include <IBEngine/IBStdAllocator.h>
+#include <IBEngine/IBAsset.h>
+#include <IBEngine/IBCompression.h>
+#include <IBEngine/IBContainers.h>
 
 #include <assimp/Importer.hpp>
 #include <assimp/scene.h>
@@ -14,6 +18,28 @@
 #include <wrl.h>
 #include <dxc/dxcapi.h>
 
+#include <algorithm>
+
+// Route our tool's allocations through our allocator, assimp and dxc live in their own modules and keep using the CRT.
+IB_GLOBAL_NEW_DELETE(IB::MemoryTag::Tools)
+
+// Our loads are bound by the bytes they read, rewrite our compiled file in its compressed form.
+// Our asset loader decompresses it as it's loaded.
+void compressCompiledFile(char const *compiledPath)
+{
+    IB::File file = IB::openFile(compiledPath, IB::OpenFileOptions::Read);
+    size_t size = IB::fileSize(file);
+    void *compressed = IB::memoryAllocate(IB::compressionBound(size), alignof(IB::CompressionHeader), IB::MemoryTag::Tools);
+    size_t compressedSize = IB::compress(IB::mapFile(file), size, compressed);
+    IB::unmapFile(file);
+    IB::closeFile(file);
+
+    file = IB::openFile(compiledPath, IB::OpenFileOptions::Overwrite | IB::OpenFileOptions::Write);
+    IB::writeToFile(file, compressed, compressedSize);
+    IB::closeFile(file);
+    IB::memoryFree(compressed, IB::MemoryTag::Tools);
+}
+
 void processMesh(char const *rawPath, char const *compiledPath)
 {
     Assimp::Importer importer;
@@ -69,6 +95,7 @@ void processMesh(char const *rawPath, char const *compiledPath)
     IB::Serialization::FileStream fileStream{ file };
     toBinary(&fileStream, asset);
     flush(&fileStream);
+    IB::closeFile(file);
 
     IB::deallocateArray(asset.Vertices, asset.VertexCount);
     IB::deallocateArray(asset.Indices, asset.IndexCount);
@@ -155,14 +182,253 @@ void processShader(char const *rawPath, char const *compiledPath)
     IB::Serialization::FileStream fileStream{ writeFile };
     toBinary(&fileStream, shaderAsset);
     flush(&fileStream);
+    IB::closeFile(writeFile);
 
     IB::unmapFile(shaderFile);
     IB::closeFile(shaderFile);
 }
 
+struct ArchiveSource
+{
+    char Path[255];
+    IB::Asset::ArchiveEntry Entry;
+    uint32_t LayoutOrder; // Assets that aren't in our load trace are laid out after the ones that are
+    IB::Asset::ContentHash ContentHash;
+    bool Duplicate; // Our data is stored once by an identical asset that was laid out before us
+};
+
+struct CompiledAssetType
+{
+    char const *Extension;
+    IB::Asset::FourCC Type;
+};
+
+constexpr CompiledAssetType CompiledAssetTypes[] =
+{
+    {".msh", IB::Asset::toFourCC("MESH")},
+    {".shdr", IB::Asset::toFourCC("SHDR")},
+    {".entt", IB::Asset::toFourCC("ENTT")},
+    {".cell", IB::Asset::toFourCC("CELL")},
+};
+
+// Our loads read each asset into a buffer with this alignment, keep our offsets aligned to match.
+constexpr uint32_t ArchiveAlignment = 16;
+
+uint64_t alignArchiveOffset(uint64_t offset, uint64_t alignment)
+{
+    return (offset + alignment - 1) / alignment * alignment;
+}
+
+bool haveSameContents(char const *compiledDirectory, ArchiveSource const &left, ArchiveSource const &right)
+{
+    if (left.Entry.Size != right.Entry.Size)
+    {
+        return false;
+    }
+
+    char leftPath[255];
+    sprintf(leftPath, "%s/%s", compiledDirectory, left.Path);
+    char rightPath[255];
+    sprintf(rightPath, "%s/%s", compiledDirectory, right.Path);
+
+    IB::File leftFile = IB::openFile(leftPath, IB::OpenFileOptions::Read);
+    IB::File rightFile = IB::openFile(rightPath, IB::OpenFileOptions::Read);
+    bool same = memcmp(IB::mapFile(leftFile), IB::mapFile(rightFile), static_cast<size_t>(left.Entry.Size)) == 0;
+    IB::unmapFile(leftFile);
+    IB::unmapFile(rightFile);
+    IB::closeFile(leftFile);
+    IB::closeFile(rightFile);
+    return same;
+}
+
+// Lays out our assets in the order that our trace first requested them.
+// Our loads read our archive front to back instead of seeking all over it.
+void applyLoadTrace(char const *tracePath, IB::DynamicArray<ArchiveSource> *sources)
+{
+    IB::File file = IB::openFile(tracePath, IB::OpenFileOptions::Read);
+    IB_ASSERT(file.Value != IB::InvalidFile.Value, "Failed to open our load trace!");
+
+    uint8_t const *traceData = reinterpret_cast<uint8_t const *>(IB::mapFile(file));
+    IB::Asset::LoadTraceHeader header;
+    memcpy(&header, traceData, sizeof(header));
+    IB_ASSERT(header.Magic == IB::Asset::LoadTraceMagic && header.Version == IB::Asset::LoadTraceVersion, "Load trace is invalid or was recorded by another version of our engine!");
+    IB_ASSERT(sizeof(header) + sizeof(IB::Asset::LoadTraceEntry) * header.EntryCount <= IB::fileSize(file), "Load trace is truncated!");
+
+    IB::Asset::LoadTraceEntry const *entries = reinterpret_cast<IB::Asset::LoadTraceEntry const *>(traceData + sizeof(header));
+    for (uint32_t i = 0; i < header.EntryCount; i++)
+    {
+        // Our sources are sorted by path id.
+        ArchiveSource *source = std::lower_bound(sources->begin(), sources->end(), entries[i].Path, [](ArchiveSource const &left, IB::StringId right)
+        {
+            return left.Entry.Path.Value < right.Value;
+        });
+
+        if (source != sources->end() && source->Entry.Path == entries[i].Path)
+        {
+            source->LayoutOrder = i < source->LayoutOrder ? i : source->LayoutOrder;
+        }
+    }
+
+    IB::unmapFile(file);
+    IB::closeFile(file);
+}
+
+void packageArchive(char const *compiledDirectory, char const *archivePath, char const *tracePath)
+{
+    struct PackageState
+    {
+        char const *CompiledDirectory;
+        IB::DynamicArray<ArchiveSource> Sources;
+    } state{compiledDirectory};
+
+    IB::enumerateDirectory(compiledDirectory, [](void *data, char const *relativePath)
+    {
+        PackageState *state = reinterpret_cast<PackageState *>(data);
+
+        char const *extension = strrchr(relativePath, '.');
+        if (extension == nullptr)
+        {
+            return;
+        }
+
+        for (CompiledAssetType const &assetType : CompiledAssetTypes)
+        {
+            if (strcmp(assetType.Extension, extension) == 0)
+            {
+                ArchiveSource source = {};
+                strncpy(source.Path, relativePath, sizeof(source.Path) - 1);
+                source.Entry.Path = IB::toStringId(relativePath);
+                source.Entry.Type = assetType.Type;
+                source.Entry.Alignment = ArchiveAlignment;
+                source.LayoutOrder = UINT32_MAX;
+
+                char fullPath[255];
+                sprintf(fullPath, "%s/%s", state->CompiledDirectory, relativePath);
+                IB::File file = IB::openFile(fullPath, IB::OpenFileOptions::Read);
+                source.Entry.Size = IB::fileSize(file);
+                if (source.Entry.Size > 0)
+                {
+                    source.ContentHash = IB::Asset::hashContent(IB::mapFile(file), static_cast<size_t>(source.Entry.Size));
+                    IB::unmapFile(file);
+                }
+                IB::closeFile(file);
+
+                state->Sources.add(source);
+                break;
+            }
+        }
+    }, &state);
+
+    // Our loader binary searches our table of contents by path id.
+    std::sort(state.Sources.begin(), state.Sources.end(), [](ArchiveSource const &left, ArchiveSource const &right)
+    {
+        return left.Entry.Path.Value < right.Entry.Path.Value;
+    });
+
+    for (uint32_t i = 1; i < state.Sources.count(); i++)
+    {
+        if (state.Sources[i - 1].Entry.Path == state.Sources[i].Entry.Path)
+        {
+            IB_LOG(IB::LogLevel::Error, "Content Processor", state.Sources[i - 1].Path);
+            IB_LOG(IB::LogLevel::Error, "Content Processor", state.Sources[i].Path);
+            IB_ASSERT(false, "Two asset paths have the same id!");
+            return;
+        }
+    }
+
+    if (tracePath != nullptr)
+    {
+        applyLoadTrace(tracePath, &state.Sources);
+    }
+
+    // Our table of contents stays sorted by path, our data is laid out in our trace's order.
+    IB::DynamicArray<uint32_t> layout;
+    layout.reserve(state.Sources.count());
+    for (uint32_t i = 0; i < state.Sources.count(); i++)
+    {
+        layout.add(i);
+    }
+
+    std::stable_sort(layout.begin(), layout.end(), [&state](uint32_t left, uint32_t right)
+    {
+        return state.Sources[left].LayoutOrder < state.Sources[right].LayoutOrder;
+    });
+
+    IB::Asset::ArchiveHeader header = {};
+    header.EntryCount = state.Sources.count();
+
+    // Identical assets are only stored once, every one of their entries points at the same data.
+    IB::HashMap<uint64_t, uint32_t> sourcesByContent;
+    uint64_t offset = sizeof(IB::Asset::ArchiveHeader) + sizeof(IB::Asset::ArchiveEntry) * state.Sources.count();
+    for (uint32_t sourceIndex : layout)
+    {
+        ArchiveSource &source = state.Sources[sourceIndex];
+        uint32_t *original = source.Entry.Size > 0 ? sourcesByContent.find(source.ContentHash.Value) : nullptr;
+        if (original != nullptr && haveSameContents(compiledDirectory, state.Sources[*original], source))
+        {
+            source.Entry.Offset = state.Sources[*original].Entry.Offset;
+            source.Duplicate = true;
+            continue;
+        }
+        else if (original == nullptr)
+        {
+            sourcesByContent.add(source.ContentHash.Value, sourceIndex);
+        }
+
+        offset = alignArchiveOffset(offset, source.Entry.Alignment);
+        source.Entry.Offset = offset;
+        offset += source.Entry.Size;
+    }
+
+    IB::File archive = IB::openFile(archivePath, IB::OpenFileOptions::Overwrite | IB::OpenFileOptions::Write);
+    IB_ASSERT(archive.Value != IB::InvalidFile.Value, "Failed to create archive!");
+
+    IB::appendToFile(archive, &header, sizeof(header));
+    for (ArchiveSource const &source : state.Sources)
+    {
+        IB::appendToFile(archive, &source.Entry, sizeof(source.Entry));
+    }
+
+    uint64_t archiveSize = sizeof(IB::Asset::ArchiveHeader) + sizeof(IB::Asset::ArchiveEntry) * state.Sources.count();
+    for (uint32_t sourceIndex : layout)
+    {
+        ArchiveSource const &source = state.Sources[sourceIndex];
+        if (source.Duplicate)
+        {
+            continue;
+        }
+
+        uint8_t const padding[ArchiveAlignment] = {};
+        IB_ASSERT(source.Entry.Offset - archiveSize <= sizeof(padding), "Our alignment is larger than our padding!");
+        if (source.Entry.Offset != archiveSize)
+        {
+            IB::appendToFile(archive, padding, static_cast<size_t>(source.Entry.Offset - archiveSize));
+        }
+
+        if (source.Entry.Size > 0)
+        {
+            char fullPath[255];
+            sprintf(fullPath, "%s/%s", compiledDirectory, source.Path);
+            IB::File file = IB::openFile(fullPath, IB::OpenFileOptions::Read);
+            IB::appendToFile(archive, IB::mapFile(file), static_cast<size_t>(source.Entry.Size));
+            IB::unmapFile(file);
+            IB::closeFile(file);
+        }
+        archiveSize = source.Entry.Offset + source.Entry.Size;
+    }
+
+    IB::closeFile(archive);
+}
+
 int main(int argc, char const *argv[])
 {
-    if (argc > 2)
+    // ContentProcessor -package <compiled directory> <archive path> [load trace path]
+    if (argc > 3 && strcmp(argv[1], "-package") == 0)
+    {
+        IB_ASSERT(IB::isDirectory(argv[2]), "Compiled path is not a directory!");
+        packageArchive(argv[2], argv[3], argc > 4 ? argv[4] : nullptr);
+    }
+    else if (argc > 3)
     {
         char const* rawDirectory = argv[1];
         char const* compiledDirectory = argv[2];
@@ -196,12 +462,14 @@ int main(int argc, char const *argv[])
             char compiledPath[255];
             sprintf(compiledPath, "%s/%.*s.msh", compiledDirectory, extensionIndex, relativePath);
             processMesh(rawPath, compiledPath);
+            compressCompiledFile(compiledPath);
         }
         else if (strcmp(".hlsl", relativePath + extensionIndex) == 0)
         {
             char compiledPath[255];
             sprintf(compiledPath, "%s/%.*s.shdr", compiledDirectory, extensionIndex, relativePath);
             processShader(rawPath, compiledPath);
+            compressCompiledFile(compiledPath);
         }
     }
 }